@@ -0,0 +1,891 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "magic_elf_lib.h"
+
+/*
+  Python module over the libmagic_elf C API.
+
+  Section contents, note descriptors and core memory come back as
+  memoryview objects pointing straight into the file mapping. Each one
+  keeps its Elf object alive, and close() refuses to unmap while any
+  are still held. Gzip compressed files are the exception: their
+  contents can be dropped from memory, so those are copied.
+*/
+
+typedef struct
+{
+  PyObject_HEAD
+  magic_elf_t *handle;
+  Py_ssize_t exports;
+} ElfObject;
+
+/* Read only buffer over part of an Elf mapping. */
+typedef struct
+{
+  PyObject_HEAD
+  ElfObject *owner;
+  const uint8_t *data;
+  Py_ssize_t length;
+} ViewObject;
+
+static PyTypeObject ElfType;
+static PyTypeObject ViewType;
+
+static PyTypeObject SectionType;
+static PyTypeObject SegmentType;
+static PyTypeObject SymbolType;
+static PyTypeObject NoteType;
+
+static PyStructSequence_Field section_fields[] =
+{
+  { "name", NULL },
+  { "type", NULL },
+  { "flags", NULL },
+  { "addr", NULL },
+  { "offset", NULL },
+  { "size", NULL },
+  { "link", NULL },
+  { "info", NULL },
+  { "addralign", NULL },
+  { "entsize", NULL },
+  { NULL, NULL }
+};
+
+static PyStructSequence_Field segment_fields[] =
+{
+  { "type", NULL },
+  { "flags", NULL },
+  { "offset", NULL },
+  { "vaddr", NULL },
+  { "paddr", NULL },
+  { "filesz", NULL },
+  { "memsz", NULL },
+  { "align", NULL },
+  { NULL, NULL }
+};
+
+static PyStructSequence_Field symbol_fields[] =
+{
+  { "name", NULL },
+  { "value", NULL },
+  { "size", NULL },
+  { "type", NULL },
+  { "binding", NULL },
+  { "shndx", NULL },
+  { NULL, NULL }
+};
+
+static PyStructSequence_Field note_fields[] =
+{
+  { "name", NULL },
+  { "type", NULL },
+  { "desc", NULL },
+  { NULL, NULL }
+};
+
+static PyStructSequence_Desc section_desc =
+  { "magic_elf.Section", NULL, section_fields, 10 };
+static PyStructSequence_Desc segment_desc =
+  { "magic_elf.Segment", NULL, segment_fields, 8 };
+static PyStructSequence_Desc symbol_desc =
+  { "magic_elf.Symbol", NULL, symbol_fields, 6 };
+static PyStructSequence_Desc note_desc =
+  { "magic_elf.Note", NULL, note_fields, 3 };
+
+static int view_getbuffer(PyObject *object, Py_buffer *buffer, int flags)
+{
+  ViewObject *view = (ViewObject *)object;
+
+  if (PyBuffer_FillInfo(
+        buffer,
+        object,
+        (void *)view->data,
+        view->length,
+        1,
+        flags) != 0)
+  {
+    return -1;
+  }
+
+  view->owner->exports++;
+
+  return 0;
+}
+
+static void view_releasebuffer(PyObject *object, Py_buffer *buffer)
+{
+  ((ViewObject *)object)->owner->exports--;
+}
+
+static void view_dealloc(ViewObject *view)
+{
+  Py_XDECREF(view->owner);
+  Py_TYPE(view)->tp_free((PyObject *)view);
+}
+
+static PyBufferProcs view_as_buffer =
+{
+  view_getbuffer,
+  view_releasebuffer
+};
+
+static PyTypeObject ViewType =
+{
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "magic_elf._View",
+  .tp_basicsize = sizeof(ViewObject),
+  .tp_dealloc = (destructor)view_dealloc,
+  .tp_as_buffer = &view_as_buffer,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+static PyObject *make_view(ElfObject *self, const uint8_t *data, uint64_t length)
+{
+  if (data == NULL)
+  {
+    PyErr_SetString(PyExc_ValueError, "range is not in the file");
+    return NULL;
+  }
+
+  if (magic_elf_is_compressed(self->handle))
+  {
+    return PyBytes_FromStringAndSize((const char *)data, length);
+  }
+
+  ViewObject *view = PyObject_New(ViewObject, &ViewType);
+
+  if (view == NULL) { return NULL; }
+
+  Py_INCREF(self);
+  view->owner = self;
+  view->data = data;
+  view->length = length;
+
+  PyObject *memoryview = PyMemoryView_FromObject((PyObject *)view);
+  Py_DECREF(view);
+
+  return memoryview;
+}
+
+static int check_open(ElfObject *self)
+{
+  if (self->handle != NULL) { return 0; }
+
+  PyErr_SetString(PyExc_ValueError, "Elf is closed");
+
+  return -1;
+}
+
+static PyObject *make_symbol(struct magic_elf_symbol *symbol)
+{
+  PyObject *result = PyStructSequence_New(&SymbolType);
+
+  if (result == NULL) { return NULL; }
+
+  PyStructSequence_SET_ITEM(result, 0, PyUnicode_DecodeUTF8(
+    symbol->name, strlen(symbol->name), "surrogateescape"));
+  PyStructSequence_SET_ITEM(result, 1, PyLong_FromUnsignedLongLong(symbol->value));
+  PyStructSequence_SET_ITEM(result, 2, PyLong_FromUnsignedLongLong(symbol->size));
+  PyStructSequence_SET_ITEM(result, 3, PyLong_FromLong(symbol->type));
+  PyStructSequence_SET_ITEM(result, 4, PyLong_FromLong(symbol->binding));
+  PyStructSequence_SET_ITEM(result, 5, PyLong_FromLong(symbol->shndx));
+
+  return result;
+}
+
+static PyObject *make_section(struct magic_elf_section *section)
+{
+  PyObject *result = PyStructSequence_New(&SectionType);
+
+  if (result == NULL) { return NULL; }
+
+  PyStructSequence_SET_ITEM(result, 0, PyUnicode_DecodeUTF8(
+    section->name, strlen(section->name), "surrogateescape"));
+  PyStructSequence_SET_ITEM(result, 1, PyLong_FromUnsignedLong(section->type));
+  PyStructSequence_SET_ITEM(result, 2, PyLong_FromUnsignedLongLong(section->flags));
+  PyStructSequence_SET_ITEM(result, 3, PyLong_FromUnsignedLongLong(section->addr));
+  PyStructSequence_SET_ITEM(result, 4, PyLong_FromUnsignedLongLong(section->offset));
+  PyStructSequence_SET_ITEM(result, 5, PyLong_FromUnsignedLongLong(section->size));
+  PyStructSequence_SET_ITEM(result, 6, PyLong_FromUnsignedLong(section->link));
+  PyStructSequence_SET_ITEM(result, 7, PyLong_FromUnsignedLong(section->info));
+  PyStructSequence_SET_ITEM(result, 8, PyLong_FromUnsignedLongLong(section->addralign));
+  PyStructSequence_SET_ITEM(result, 9, PyLong_FromUnsignedLongLong(section->entsize));
+
+  return result;
+}
+
+static int find_thread(ElfObject *self, long pid)
+{
+  const int count = magic_elf_get_thread_count(self->handle);
+
+  for (int thread = 0; thread < count; thread++)
+  {
+    if (magic_elf_get_thread_pid(self->handle, thread) == pid) { return thread; }
+  }
+
+  PyErr_Format(PyExc_KeyError, "no thread with pid %ld", pid);
+
+  return -1;
+}
+
+static int elf_init(ElfObject *self, PyObject *args, PyObject *kwargs)
+{
+  static char *keywords[] = { "filename", "writable", NULL };
+  PyObject *path;
+  int writable = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O&|p", keywords,
+        PyUnicode_FSConverter, &path, &writable))
+  {
+    return -1;
+  }
+
+  if (self->exports != 0)
+  {
+    PyErr_SetString(PyExc_BufferError, "memoryviews of this Elf are still in use");
+    Py_DECREF(path);
+    return -1;
+  }
+
+  if (self->handle != NULL) { magic_elf_close(self->handle); }
+
+  const char *filename = PyBytes_AS_STRING(path);
+
+  Py_BEGIN_ALLOW_THREADS
+  self->handle = writable ?
+    magic_elf_open_writable(filename) :
+    magic_elf_open(filename);
+  Py_END_ALLOW_THREADS
+
+  if (self->handle == NULL)
+  {
+    PyErr_Format(PyExc_OSError, "cannot open %s", filename);
+    Py_DECREF(path);
+    return -1;
+  }
+
+  Py_DECREF(path);
+
+  return 0;
+}
+
+static void elf_dealloc(ElfObject *self)
+{
+  if (self->handle != NULL) { magic_elf_close(self->handle); }
+
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *elf_close(ElfObject *self, PyObject *unused)
+{
+  if (self->exports != 0)
+  {
+    PyErr_SetString(PyExc_BufferError, "memoryviews of this Elf are still in use");
+    return NULL;
+  }
+
+  if (self->handle != NULL)
+  {
+    magic_elf_close(self->handle);
+    self->handle = NULL;
+  }
+
+  Py_RETURN_NONE;
+}
+
+static PyObject *elf_enter(ElfObject *self, PyObject *unused)
+{
+  Py_INCREF(self);
+  return (PyObject *)self;
+}
+
+static PyObject *elf_exit(ElfObject *self, PyObject *args)
+{
+  return elf_close(self, NULL);
+}
+
+static PyObject *elf_get_header(ElfObject *self, void *which)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  switch ((intptr_t)which)
+  {
+    case 0:  return PyLong_FromLong(magic_elf_get_class(self->handle));
+    case 1:  return PyLong_FromLong(magic_elf_get_type(self->handle));
+    case 2:  return PyLong_FromLong(magic_elf_get_machine(self->handle));
+    default: return PyLong_FromUnsignedLongLong(magic_elf_get_entry(self->handle));
+  }
+}
+
+static PyObject *elf_sections(ElfObject *self, PyObject *unused)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  const int count = magic_elf_get_section_count(self->handle);
+  PyObject *list = PyList_New(count);
+
+  if (list == NULL) { return NULL; }
+
+  for (int n = 0; n < count; n++)
+  {
+    struct magic_elf_section section;
+
+    magic_elf_get_section(self->handle, n, &section);
+
+    PyObject *item = make_section(&section);
+
+    if (item == NULL) { Py_DECREF(list); return NULL; }
+
+    PyList_SET_ITEM(list, n, item);
+  }
+
+  return list;
+}
+
+static PyObject *elf_section_data(ElfObject *self, PyObject *key)
+{
+  struct magic_elf_section section;
+  int err;
+
+  if (check_open(self) != 0) { return NULL; }
+
+  if (PyLong_Check(key))
+  {
+    err = magic_elf_get_section(self->handle, PyLong_AsLong(key), &section);
+  }
+    else
+  {
+    const char *name = PyUnicode_AsUTF8(key);
+
+    if (name == NULL) { return NULL; }
+
+    err = magic_elf_find_section(self->handle, name, &section);
+  }
+
+  if (err != 0)
+  {
+    PyErr_SetString(PyExc_KeyError, "no such section");
+    return NULL;
+  }
+
+  // SHT_NOBITS has no bytes in the file.
+  if (section.type == 8) { section.size = 0; }
+
+  return make_view(self,
+    magic_elf_get_data(self->handle, section.offset, section.size),
+    section.size);
+}
+
+static PyObject *elf_segments(ElfObject *self, PyObject *unused)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  const int count = magic_elf_get_segment_count(self->handle);
+  PyObject *list = PyList_New(count);
+
+  if (list == NULL) { return NULL; }
+
+  for (int n = 0; n < count; n++)
+  {
+    struct magic_elf_segment segment;
+
+    magic_elf_get_segment(self->handle, n, &segment);
+
+    PyObject *item = PyStructSequence_New(&SegmentType);
+
+    if (item == NULL) { Py_DECREF(list); return NULL; }
+
+    PyStructSequence_SET_ITEM(item, 0, PyLong_FromUnsignedLong(segment.type));
+    PyStructSequence_SET_ITEM(item, 1, PyLong_FromUnsignedLong(segment.flags));
+    PyStructSequence_SET_ITEM(item, 2, PyLong_FromUnsignedLongLong(segment.offset));
+    PyStructSequence_SET_ITEM(item, 3, PyLong_FromUnsignedLongLong(segment.vaddr));
+    PyStructSequence_SET_ITEM(item, 4, PyLong_FromUnsignedLongLong(segment.paddr));
+    PyStructSequence_SET_ITEM(item, 5, PyLong_FromUnsignedLongLong(segment.filesz));
+    PyStructSequence_SET_ITEM(item, 6, PyLong_FromUnsignedLongLong(segment.memsz));
+    PyStructSequence_SET_ITEM(item, 7, PyLong_FromUnsignedLongLong(segment.align));
+
+    PyList_SET_ITEM(list, n, item);
+  }
+
+  return list;
+}
+
+static PyObject *elf_symbols(ElfObject *self, PyObject *unused)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  const int64_t count = magic_elf_get_symbol_count(self->handle);
+  PyObject *list = PyList_New(count);
+
+  if (list == NULL) { return NULL; }
+
+  for (int64_t n = 0; n < count; n++)
+  {
+    struct magic_elf_symbol symbol;
+
+    magic_elf_get_symbol(self->handle, n, &symbol);
+
+    PyObject *item = make_symbol(&symbol);
+
+    if (item == NULL) { Py_DECREF(list); return NULL; }
+
+    PyList_SET_ITEM(list, n, item);
+  }
+
+  return list;
+}
+
+static PyObject *elf_find_symbol(ElfObject *self, PyObject *args)
+{
+  const char *name;
+  struct magic_elf_symbol symbol;
+
+  if (check_open(self) != 0) { return NULL; }
+  if (!PyArg_ParseTuple(args, "s", &name)) { return NULL; }
+
+  if (magic_elf_find_symbol(self->handle, name, &symbol) != 0)
+  {
+    Py_RETURN_NONE;
+  }
+
+  return make_symbol(&symbol);
+}
+
+static PyObject *elf_find_symbols(ElfObject *self, PyObject *names)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  PyObject *sequence = PySequence_Fast(names, "find_symbols() takes a sequence of names");
+
+  if (sequence == NULL) { return NULL; }
+
+  const Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+  PyObject *list = PyList_New(count);
+
+  if (list == NULL) { Py_DECREF(sequence); return NULL; }
+
+  for (Py_ssize_t n = 0; n < count; n++)
+  {
+    const char *name = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(sequence, n));
+    struct magic_elf_symbol symbol;
+    PyObject *item;
+
+    if (name == NULL) { Py_DECREF(list); Py_DECREF(sequence); return NULL; }
+
+    if (magic_elf_find_symbol(self->handle, name, &symbol) == 0)
+    {
+      item = make_symbol(&symbol);
+
+      if (item == NULL) { Py_DECREF(list); Py_DECREF(sequence); return NULL; }
+    }
+      else
+    {
+      Py_INCREF(Py_None);
+      item = Py_None;
+    }
+
+    PyList_SET_ITEM(list, n, item);
+  }
+
+  Py_DECREF(sequence);
+
+  return list;
+}
+
+static PyObject *find_address(ElfObject *self, uint64_t address)
+{
+  struct magic_elf_symbol symbol;
+  uint64_t offset;
+
+  if (magic_elf_find_address(self->handle, address, &symbol, &offset) != 0)
+  {
+    Py_RETURN_NONE;
+  }
+
+  PyObject *item = make_symbol(&symbol);
+
+  if (item == NULL) { return NULL; }
+
+  return Py_BuildValue("(NK)", item, (unsigned long long)offset);
+}
+
+static PyObject *elf_find_address(ElfObject *self, PyObject *args)
+{
+  unsigned long long address;
+
+  if (check_open(self) != 0) { return NULL; }
+  if (!PyArg_ParseTuple(args, "K", &address)) { return NULL; }
+
+  return find_address(self, address);
+}
+
+static PyObject *elf_find_addresses(ElfObject *self, PyObject *addresses)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  PyObject *sequence =
+    PySequence_Fast(addresses, "find_addresses() takes a sequence of addresses");
+
+  if (sequence == NULL) { return NULL; }
+
+  const Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+  PyObject *list = PyList_New(count);
+
+  if (list == NULL) { Py_DECREF(sequence); return NULL; }
+
+  for (Py_ssize_t n = 0; n < count; n++)
+  {
+    const uint64_t address =
+      PyLong_AsUnsignedLongLongMask(PySequence_Fast_GET_ITEM(sequence, n));
+    PyObject *item = NULL;
+
+    if (!PyErr_Occurred()) { item = find_address(self, address); }
+
+    if (item == NULL) { Py_DECREF(list); Py_DECREF(sequence); return NULL; }
+
+    PyList_SET_ITEM(list, n, item);
+  }
+
+  Py_DECREF(sequence);
+
+  return list;
+}
+
+static PyObject *elf_address_to_offset(ElfObject *self, PyObject *args)
+{
+  unsigned long long address;
+
+  if (check_open(self) != 0) { return NULL; }
+  if (!PyArg_ParseTuple(args, "K", &address)) { return NULL; }
+
+  const int64_t offset = magic_elf_address_to_offset(self->handle, address);
+
+  if (offset < 0) { Py_RETURN_NONE; }
+
+  return PyLong_FromLongLong(offset);
+}
+
+static PyObject *elf_notes(ElfObject *self, PyObject *unused)
+{
+  struct magic_elf_note_iter iter;
+  struct magic_elf_note note;
+
+  if (check_open(self) != 0) { return NULL; }
+
+  PyObject *list = PyList_New(0);
+
+  if (list == NULL) { return NULL; }
+
+  magic_elf_note_begin(self->handle, &iter);
+
+  while (magic_elf_note_next(self->handle, &iter, &note) == 0)
+  {
+    PyObject *item = PyStructSequence_New(&NoteType);
+    PyObject *desc = make_view(self, note.desc, note.descsz);
+
+    if (item == NULL || desc == NULL)
+    {
+      Py_XDECREF(item);
+      Py_XDECREF(desc);
+      Py_DECREF(list);
+      return NULL;
+    }
+
+    PyStructSequence_SET_ITEM(item, 0, PyUnicode_DecodeUTF8(
+      note.name, strlen(note.name), "surrogateescape"));
+    PyStructSequence_SET_ITEM(item, 1, PyLong_FromUnsignedLong(note.type));
+    PyStructSequence_SET_ITEM(item, 2, desc);
+
+    if (PyList_Append(list, item) != 0)
+    {
+      Py_DECREF(item);
+      Py_DECREF(list);
+      return NULL;
+    }
+
+    Py_DECREF(item);
+  }
+
+  return list;
+}
+
+static PyObject *elf_threads(ElfObject *self, PyObject *unused)
+{
+  if (check_open(self) != 0) { return NULL; }
+
+  const int count = magic_elf_get_thread_count(self->handle);
+  PyObject *list = PyList_New(count);
+
+  if (list == NULL) { return NULL; }
+
+  for (int n = 0; n < count; n++)
+  {
+    PyList_SET_ITEM(list, n,
+      PyLong_FromLong(magic_elf_get_thread_pid(self->handle, n)));
+  }
+
+  return list;
+}
+
+static PyObject *elf_get_registers(ElfObject *self, PyObject *args)
+{
+  long pid;
+  PyObject *names;
+
+  if (check_open(self) != 0) { return NULL; }
+  if (!PyArg_ParseTuple(args, "lO", &pid, &names)) { return NULL; }
+
+  const int thread = find_thread(self, pid);
+
+  if (thread < 0) { return NULL; }
+
+  PyObject *sequence =
+    PySequence_Fast(names, "get_registers() takes a sequence of names");
+
+  if (sequence == NULL) { return NULL; }
+
+  PyObject *result = PyDict_New();
+
+  for (Py_ssize_t n = 0; result != NULL && n < PySequence_Fast_GET_SIZE(sequence); n++)
+  {
+    PyObject *key = PySequence_Fast_GET_ITEM(sequence, n);
+    const char *name = PyUnicode_AsUTF8(key);
+    uint64_t value;
+
+    if (name == NULL)
+    {
+      Py_CLEAR(result);
+      break;
+    }
+
+    if (magic_elf_get_register(self->handle, thread, name, &value) != 0)
+    {
+      PyErr_Format(PyExc_KeyError, "unknown register %s", name);
+      Py_CLEAR(result);
+      break;
+    }
+
+    PyObject *item = PyLong_FromUnsignedLongLong(value);
+
+    if (item == NULL || PyDict_SetItem(result, key, item) != 0)
+    {
+      Py_XDECREF(item);
+      Py_CLEAR(result);
+      break;
+    }
+
+    Py_DECREF(item);
+  }
+
+  Py_DECREF(sequence);
+
+  return result;
+}
+
+static PyObject *elf_set_registers(ElfObject *self, PyObject *args)
+{
+  long pid;
+  PyObject *registers;
+
+  if (check_open(self) != 0) { return NULL; }
+
+  if (!PyArg_ParseTuple(args, "lO!", &pid, &PyDict_Type, &registers))
+  {
+    return NULL;
+  }
+
+  const int thread = find_thread(self, pid);
+
+  if (thread < 0) { return NULL; }
+
+  const Py_ssize_t count = PyDict_Size(registers);
+  const char **names = PyMem_New(const char *, count);
+  uint64_t *values = PyMem_New(uint64_t, count);
+  PyObject *key;
+  PyObject *item;
+  Py_ssize_t position = 0;
+  Py_ssize_t n = 0;
+  int err = 0;
+
+  if (names == NULL || values == NULL)
+  {
+    PyMem_Free(names);
+    PyMem_Free(values);
+    return PyErr_NoMemory();
+  }
+
+  while (PyDict_Next(registers, &position, &key, &item))
+  {
+    names[n] = PyUnicode_AsUTF8(key);
+    values[n] = PyLong_AsUnsignedLongLongMask(item);
+
+    if (names[n] == NULL || PyErr_Occurred()) { err = -1; break; }
+
+    n++;
+  }
+
+  if (err == 0 &&
+      magic_elf_set_registers(self->handle, thread, names, values, count) != 0)
+  {
+    PyErr_SetString(PyExc_ValueError,
+      "cannot set registers (unknown name or not opened writable)");
+    err = -1;
+  }
+
+  PyMem_Free(names);
+  PyMem_Free(values);
+
+  if (err != 0) { return NULL; }
+
+  Py_RETURN_NONE;
+}
+
+static PyObject *elf_read_memory(ElfObject *self, PyObject *args)
+{
+  unsigned long long address;
+  unsigned long long length;
+
+  if (check_open(self) != 0) { return NULL; }
+  if (!PyArg_ParseTuple(args, "KK", &address, &length)) { return NULL; }
+
+  return make_view(self,
+    magic_elf_get_memory(self->handle, address, length),
+    length);
+}
+
+static PyObject *elf_data(ElfObject *self, PyObject *args)
+{
+  unsigned long long offset;
+  unsigned long long length;
+
+  if (check_open(self) != 0) { return NULL; }
+  if (!PyArg_ParseTuple(args, "KK", &offset, &length)) { return NULL; }
+
+  return make_view(self,
+    magic_elf_get_data(self->handle, offset, length),
+    length);
+}
+
+static PyMethodDef elf_methods[] =
+{
+  { "close", (PyCFunction)elf_close, METH_NOARGS,
+    "Unmap the file." },
+  { "__enter__", (PyCFunction)elf_enter, METH_NOARGS, NULL },
+  { "__exit__", (PyCFunction)elf_exit, METH_VARARGS, NULL },
+  { "sections", (PyCFunction)elf_sections, METH_NOARGS,
+    "List of Section tuples." },
+  { "section_data", (PyCFunction)elf_section_data, METH_O,
+    "section_data(name or index) -> memoryview of the section." },
+  { "segments", (PyCFunction)elf_segments, METH_NOARGS,
+    "List of Segment (program header) tuples." },
+  { "symbols", (PyCFunction)elf_symbols, METH_NOARGS,
+    "List of Symbol tuples from .symtab (or .dynsym)." },
+  { "find_symbol", (PyCFunction)elf_find_symbol, METH_VARARGS,
+    "find_symbol(name) -> Symbol or None." },
+  { "find_symbols", (PyCFunction)elf_find_symbols, METH_O,
+    "find_symbols(names) -> list of Symbol or None." },
+  { "find_address", (PyCFunction)elf_find_address, METH_VARARGS,
+    "find_address(address) -> (Symbol, offset) or None." },
+  { "find_addresses", (PyCFunction)elf_find_addresses, METH_O,
+    "find_addresses(addresses) -> list of (Symbol, offset) or None." },
+  { "address_to_offset", (PyCFunction)elf_address_to_offset, METH_VARARGS,
+    "address_to_offset(address) -> file offset or None." },
+  { "notes", (PyCFunction)elf_notes, METH_NOARGS,
+    "List of Note tuples, desc is a memoryview." },
+  { "threads", (PyCFunction)elf_threads, METH_NOARGS,
+    "Pids of the threads in a core file." },
+  { "get_registers", (PyCFunction)elf_get_registers, METH_VARARGS,
+    "get_registers(pid, names) -> dict of register values." },
+  { "set_registers", (PyCFunction)elf_set_registers, METH_VARARGS,
+    "set_registers(pid, dict) writes registers (file opened writable)." },
+  { "read_memory", (PyCFunction)elf_read_memory, METH_VARARGS,
+    "read_memory(address, length) -> memoryview of core memory." },
+  { "data", (PyCFunction)elf_data, METH_VARARGS,
+    "data(offset, length) -> memoryview of the file." },
+  { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef elf_getset[] =
+{
+  { "elf_class", (getter)elf_get_header, NULL, "1 = 32 bit, 2 = 64 bit", (void *)0 },
+  { "type", (getter)elf_get_header, NULL, "e_type", (void *)1 },
+  { "machine", (getter)elf_get_header, NULL, "e_machine", (void *)2 },
+  { "entry", (getter)elf_get_header, NULL, "e_entry", (void *)3 },
+  { NULL }
+};
+
+static PyTypeObject ElfType =
+{
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "magic_elf.Elf",
+  .tp_doc = "Elf(filename, writable=False)",
+  .tp_basicsize = sizeof(ElfObject),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+  .tp_init = (initproc)elf_init,
+  .tp_dealloc = (destructor)elf_dealloc,
+  .tp_methods = elf_methods,
+  .tp_getset = elf_getset,
+};
+
+static struct PyModuleDef magic_elf_module =
+{
+  PyModuleDef_HEAD_INIT,
+  "magic_elf",
+  "Python bindings for libmagic_elf.",
+  -1,
+  NULL
+};
+
+PyMODINIT_FUNC PyInit_magic_elf(void)
+{
+  if (PyType_Ready(&ElfType) < 0 || PyType_Ready(&ViewType) < 0)
+  {
+    return NULL;
+  }
+
+  if (PyStructSequence_InitType2(&SectionType, &section_desc) < 0 ||
+      PyStructSequence_InitType2(&SegmentType, &segment_desc) < 0 ||
+      PyStructSequence_InitType2(&SymbolType, &symbol_desc) < 0 ||
+      PyStructSequence_InitType2(&NoteType, &note_desc) < 0)
+  {
+    return NULL;
+  }
+
+  PyObject *module = PyModule_Create(&magic_elf_module);
+
+  if (module == NULL) { return NULL; }
+
+  Py_INCREF(&ElfType);
+
+  if (PyModule_AddObject(module, "Elf", (PyObject *)&ElfType) < 0)
+  {
+    Py_DECREF(&ElfType);
+    Py_DECREF(module);
+    return NULL;
+  }
+
+  PyModule_AddObject(module, "Section", (PyObject *)&SectionType);
+  PyModule_AddObject(module, "Segment", (PyObject *)&SegmentType);
+  PyModule_AddObject(module, "Symbol", (PyObject *)&SymbolType);
+  PyModule_AddObject(module, "Note", (PyObject *)&NoteType);
+
+  return module;
+}
+
@@ -0,0 +1,21 @@
+#!/usr/bin/env python3
+
+# Build with "make python" from the top directory (or "make lib" and
+# then "python3 setup.py build_ext --inplace" here).
+
+from setuptools import setup, Extension
+
+setup(
+  name = "magic_elf",
+  version = "2024.01.11",
+  description = "Python bindings for libmagic_elf",
+  ext_modules = [
+    Extension(
+      "magic_elf",
+      sources = [ "magic_elf_module.c" ],
+      include_dirs = [ "../src" ],
+      extra_objects = [ "../build/libmagic_elf.a" ],
+      libraries = [ "stdc++", "z" ],
+      extra_link_args = [ "-pthread" ])
+  ])
+
@@ -1,6 +1,6 @@
 #!/usr/bin/env python3
 
-import sys, os
+import sys, os, shutil
 
 if len(sys.argv) != 3:
   print("Usage: python3 modify_java_core.py <hs_err_pid.log> <corefile>")
@@ -38,16 +38,31 @@ for line in fp:
 
 fp.close()
 
-#os.system("cp " + core + " " + core + ".modified")
+# FIXME: Should probably add these other registers to the list.
+skip = [ "EFLAGS", "CSGSFS", "ERR", "TRAPNO" ]
+
+values = { }
 
 for register in registers:
-  # FIXME: Should probably add these other registers to the list.
-  if register in [ "EFLAGS", "CSGSFS", "ERR", "TRAPNO" ]: continue
+  if register in skip: continue
+  values[register.lower()] = int(registers[register], 16)
+
+try:
+  sys.path.append(os.path.join(os.path.dirname(__file__), "..", "python"))
+  import magic_elf
+except ImportError:
+  # Without the Python module (make python) just show the commands.
+  for register in values:
+    print("magic_elf -modify_core " + tid + " " + register + " " + \
+      hex(values[register]) + " " + core + ".modified")
+  sys.exit(0)
+
+shutil.copyfile(core, core + ".modified")
 
-  value = registers[register]
-  register = register.lower()
-  #print(register + " " + registers[register])
+elf = magic_elf.Elf(core + ".modified", writable=True)
+elf.set_registers(int(tid, 0), values)
 
-  #os.system("magic_elf -modify_core " + tid + " " + register + " " + value + " " + core + ".modified")
-  print("magic_elf -modify_core " + tid + " " + register + " " + value + " " + core + ".modified")
+for register, value in elf.get_registers(int(tid, 0), list(values)).items():
+  print("%8s 0x%016x" % (register, value))
 
+elf.close()
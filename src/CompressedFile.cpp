@@ -0,0 +1,539 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <string>
+#include <zlib.h>
+
+#include "CompressedFile.h"
+
+thread_local CompressedFile::Pin *CompressedFile::pins = nullptr;
+
+CompressedFile::Pin::Pin(CompressedFile *file) :
+  file     { file },
+  previous { nullptr }
+{
+  if (file == nullptr) { return; }
+
+  previous = pins;
+  pins = this;
+}
+
+CompressedFile::Pin::~Pin()
+{
+  if (file == nullptr) { return; }
+
+  pins = previous;
+
+  std::lock_guard<std::mutex> lock(file->mutex);
+
+  for (int chunk : chunks) { file->pin_count[chunk]--; }
+
+  file->trim();
+}
+
+CompressedFile::CompressedFile() :
+  fd              { -1 },
+  index           { nullptr },
+  view            { nullptr },
+  length          { 0 },
+  clock           { 0 },
+  chunks_inflated { 0 }
+{
+}
+
+CompressedFile::~CompressedFile()
+{
+  if (view != nullptr) { munmap(view, length); }
+  if (index != nullptr) { fclose(index); }
+  if (fd != -1) { close(fd); }
+}
+
+bool CompressedFile::is_compressed(const char *filename)
+{
+  uint8_t magic[2];
+
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) { return false; }
+
+  bool is_gzip =
+    fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+    magic[0] == 0x1f && magic[1] == 0x8b;
+
+  fclose(fp);
+
+  return is_gzip;
+}
+
+int CompressedFile::open(const char *filename)
+{
+  struct stat stat_buf;
+
+  fd = ::open(filename, O_RDONLY);
+
+  if (fd == -1) { return -1; }
+  fstat(fd, &stat_buf);
+
+  std::string index_filename = std::string(filename) + ".idx";
+
+  index = fopen(index_filename.c_str(), "rb");
+
+  if (index != nullptr &&
+      load_index(index, stat_buf.st_size, stat_buf.st_mtime) != 0)
+  {
+    fclose(index);
+    index = nullptr;
+  }
+
+  if (index == nullptr)
+  {
+    index = fopen(index_filename.c_str(), "w+b");
+
+    // Directory isn't writable, keep the index for this run only.
+    if (index == nullptr) { index = tmpfile(); }
+    if (index == nullptr) { return -1; }
+
+    if (build_index(index, stat_buf.st_size, stat_buf.st_mtime) != 0)
+    {
+      printf("Error: Cannot index compressed file %s\n", filename);
+      unlink(index_filename.c_str());
+      return -1;
+    }
+  }
+
+  view = (uint8_t *)mmap(
+    NULL,
+    length,
+    PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+    -1,
+    0);
+
+  if (view == MAP_FAILED)
+  {
+    view = nullptr;
+    return -1;
+  }
+
+  last_used.resize(points.size(), 0);
+  pin_count.resize(points.size(), 0);
+
+  return 0;
+}
+
+int CompressedFile::map(uint64_t offset, uint64_t size)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  return map_locked(offset, size);
+}
+
+int CompressedFile::map_string(uint64_t offset)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  uint64_t position = offset;
+
+  // The chunks already searched are part of the range being mapped so a
+  // string crossing into the next chunk doesn't evict its own start.
+  while (position < length)
+  {
+    if (map_locked(offset, position - offset + 1) != 0) { return -1; }
+
+    const uint64_t end = get_chunk_end(find_chunk(position));
+
+    if (memchr(view + position, 0, end - position) != nullptr) { return 0; }
+
+    position = end;
+  }
+
+  return -1;
+}
+
+int CompressedFile::read(uint64_t offset, uint64_t size, uint8_t *data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (offset > length || size > length - offset) { return -1; }
+
+  // A chunk at a time, so a big read doesn't push everything else out.
+  while (size != 0)
+  {
+    const uint64_t count = std::min(size, get_chunk_end(find_chunk(offset)) - offset);
+
+    if (map_locked(offset, count) != 0) { return -1; }
+
+    memcpy(data, view + offset, count);
+
+    offset += count;
+    data += count;
+    size -= count;
+  }
+
+  return 0;
+}
+
+int CompressedFile::load_index(
+  FILE *index,
+  uint64_t compressed_length,
+  uint64_t mtime)
+{
+  IndexHeader header;
+
+  if (fread(&header, sizeof(header), 1, index) != 1) { return -1; }
+
+  if (memcmp(header.magic, "MEGZIDX2", 8) != 0 ||
+      header.compressed_length != compressed_length ||
+      header.mtime != mtime ||
+      header.span != span)
+  {
+    return -1;
+  }
+
+  points.resize(header.point_count);
+
+  if (fseeko(index, header.points_offset, SEEK_SET) != 0 ||
+      fread(points.data(), sizeof(Point), points.size(), index) !=
+        points.size())
+  {
+    points.clear();
+    return -1;
+  }
+
+  length = header.length;
+
+  return 0;
+}
+
+int CompressedFile::build_index(
+  FILE *index,
+  uint64_t compressed_length,
+  uint64_t mtime)
+{
+  IndexHeader header;
+  z_stream strm;
+  uint8_t input[65536];
+  uint8_t window[window_size];
+  uint8_t point_window[window_size];
+  uint64_t total_in = 0;
+  uint64_t total_out = 0;
+  uint64_t last = 0;
+  bool member_start = false;
+  int ret = Z_OK;
+
+  memset(&header, 0, sizeof(header));
+  memset(&strm, 0, sizeof(strm));
+  memset(window, 0, sizeof(window));
+
+  if (fwrite(&header, sizeof(header), 1, index) != 1) { return -1; }
+
+  // 47 = 15 bit window, accept either a gzip or zlib header.
+  if (inflateInit2(&strm, 47) != Z_OK) { return -1; }
+
+  points.clear();
+
+  // Runs to the end of the file. It's only complete if that's also the
+  // end of a stream.
+  while (true)
+  {
+    ssize_t n = ::read(fd, input, sizeof(input));
+
+    if (n == 0) { break; }
+    if (n < 0) { ret = Z_ERRNO; break; }
+
+    strm.avail_in = n;
+    strm.next_in = input;
+
+    do
+    {
+      if (strm.avail_out == 0)
+      {
+        strm.avail_out = window_size;
+        strm.next_out = window;
+      }
+
+      total_in += strm.avail_in;
+      total_out += strm.avail_out;
+      ret = inflate(&strm, Z_BLOCK);
+      total_in -= strm.avail_in;
+      total_out -= strm.avail_out;
+
+      if (ret == Z_NEED_DICT) { ret = Z_DATA_ERROR; }
+      if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) { break; }
+
+      // Concatenated members (cat a.gz b.gz) decompress to one file,
+      // anything else after a stream fails in inflate() above.
+      if (ret == Z_STREAM_END)
+      {
+        if (inflateReset(&strm) != Z_OK) { ret = Z_STREAM_ERROR; break; }
+        ret = Z_STREAM_END;
+        member_start = true;
+        continue;
+      }
+
+      // At the start of a deflate block (and not the end of the last
+      // one) the stream can be restarted with the previous 32k of output.
+      // Each member gets a point so no chunk runs across members.
+      if ((strm.data_type & 128) != 0 && (strm.data_type & 64) == 0 &&
+          (total_out == 0 || member_start || total_out - last > span))
+      {
+        const int left = strm.avail_out;
+
+        if (left != 0)
+        {
+          memcpy(point_window, window + window_size - left, left);
+        }
+
+        if (left < window_size)
+        {
+          memcpy(point_window + left, window, window_size - left);
+        }
+
+        Point point;
+        point.out = total_out;
+        point.in = total_in;
+        point.bits = strm.data_type & 7;
+        point.window = ftello(index);
+
+        if (fwrite(point_window, window_size, 1, index) != 1)
+        {
+          ret = Z_ERRNO;
+          break;
+        }
+
+        points.push_back(point);
+
+        last = total_out;
+        member_start = false;
+      }
+    } while (strm.avail_in != 0);
+
+    if (ret != Z_OK && ret != Z_STREAM_END) { break; }
+  }
+
+  inflateEnd(&strm);
+
+  if (ret != Z_STREAM_END || points.size() == 0) { return -1; }
+
+  length = total_out;
+
+  memcpy(header.magic, "MEGZIDX2", 8);
+  header.compressed_length = compressed_length;
+  header.mtime = mtime;
+  header.span = span;
+  header.length = length;
+  header.point_count = points.size();
+  header.points_offset = ftello(index);
+
+  if (fwrite(points.data(), sizeof(Point), points.size(), index) !=
+        points.size() ||
+      fseeko(index, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, index) != 1 ||
+      fflush(index) != 0)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+int CompressedFile::find_chunk(uint64_t offset)
+{
+  int low = 0;
+  int high = points.size() - 1;
+
+  while (low < high)
+  {
+    int mid = (low + high + 1) / 2;
+
+    if (points[mid].out <= offset)
+    {
+      low = mid;
+    }
+      else
+    {
+      high = mid - 1;
+    }
+  }
+
+  return low;
+}
+
+uint64_t CompressedFile::get_chunk_end(int chunk)
+{
+  return chunk + 1 < (int)points.size() ? points[chunk + 1].out : length;
+}
+
+int CompressedFile::map_locked(uint64_t offset, uint64_t size)
+{
+  if (offset > length || size > length - offset) { return -1; }
+  if (size == 0) { return 0; }
+
+  // Chunks of this range are never evicted to make room for each other.
+  // If they don't all fit the LRU goes over its limit until later calls
+  // (or the end of a Pin) bring it back down.
+  const int first = find_chunk(offset);
+  const int last = find_chunk(offset + size - 1);
+
+  for (int chunk = first; chunk <= last; chunk++)
+  {
+    if (last_used[chunk] == 0)
+    {
+      while ((int)resident.size() >= max_resident && evict_chunk(first, last)) { }
+
+      if (inflate_chunk(chunk) != 0) { return -1; }
+
+      resident.push_back(chunk);
+    }
+
+    last_used[chunk] = ++clock;
+
+    hold_chunk(chunk);
+  }
+
+  return 0;
+}
+
+int CompressedFile::inflate_chunk(int chunk)
+{
+  Point &point = points[chunk];
+  const uint64_t end = get_chunk_end(chunk);
+  uint8_t input[65536];
+  uint8_t window[window_size];
+  z_stream strm;
+  int ret;
+
+  memset(&strm, 0, sizeof(strm));
+
+  if (pread(fileno(index), window, window_size, point.window) !=
+        window_size)
+  {
+    return -1;
+  }
+
+  if (inflateInit2(&strm, -15) != Z_OK) { return -1; }
+
+  uint64_t in = point.in;
+
+  if (point.bits != 0)
+  {
+    uint8_t c;
+
+    if (pread(fd, &c, 1, in - 1) != 1)
+    {
+      inflateEnd(&strm);
+      return -1;
+    }
+
+    inflatePrime(&strm, point.bits, c >> (8 - point.bits));
+  }
+
+  inflateSetDictionary(&strm, window, window_size);
+
+  strm.next_out = view + point.out;
+  strm.avail_out = end - point.out;
+
+  do
+  {
+    if (strm.avail_in == 0)
+    {
+      ssize_t n = pread(fd, input, sizeof(input), in);
+
+      if (n <= 0) { break; }
+
+      strm.next_in = input;
+      strm.avail_in = n;
+      in += n;
+    }
+
+    ret = inflate(&strm, Z_NO_FLUSH);
+
+    if (ret != Z_OK) { break; }
+  } while (strm.avail_out != 0);
+
+  inflateEnd(&strm);
+
+  if (strm.avail_out != 0) { return -1; }
+
+  chunks_inflated++;
+
+  return 0;
+}
+
+void CompressedFile::hold_chunk(int chunk)
+{
+  for (Pin *pin = pins; pin != nullptr; pin = pin->previous)
+  {
+    if (pin->file != this) { continue; }
+
+    if (pin->held.size() == 0) { pin->held.resize(points.size(), false); }
+
+    if (!pin->held[chunk])
+    {
+      pin->held[chunk] = true;
+      pin->chunks.push_back(chunk);
+      pin_count[chunk]++;
+    }
+
+    return;
+  }
+}
+
+bool CompressedFile::evict_chunk(int first, int last)
+{
+  int oldest = -1;
+
+  for (int n = 0; n < (int)resident.size(); n++)
+  {
+    const int chunk = resident[n];
+
+    if (pin_count[chunk] != 0) { continue; }
+    if (chunk >= first && chunk <= last) { continue; }
+
+    if (oldest == -1 || last_used[chunk] < last_used[resident[oldest]])
+    {
+      oldest = n;
+    }
+  }
+
+  if (oldest == -1) { return false; }
+
+  const int chunk = resident[oldest];
+  const uint64_t page_size = getpagesize();
+  const uint64_t end = get_chunk_end(chunk);
+
+  // Pages shared with a neighboring chunk stay resident.
+  uint64_t start = (points[chunk].out + page_size - 1) & ~(page_size - 1);
+  uint64_t stop = end & ~(page_size - 1);
+
+  if (stop > start) { madvise(view + start, stop - start, MADV_DONTNEED); }
+
+  last_used[chunk] = 0;
+  resident.erase(resident.begin() + oldest);
+
+  return true;
+}
+
+void CompressedFile::trim()
+{
+  while ((int)resident.size() > max_resident && evict_chunk(1, 0)) { }
+}
+
@@ -0,0 +1,121 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_COMPRESSED_FILE_H
+#define MAGIC_ELF_COMPRESSED_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+// Random access into a gzip compressed file. A one time pass builds a
+// seek index (deflate block boundaries every span bytes of output with
+// the 32k window needed to restart there) which is saved next to the
+// file as <filename>.idx. The uncompressed image is a reserved anonymous
+// mapping and chunks are only inflated into it when a read touches them.
+// An LRU limits how many chunks stay resident.
+//
+// Evicting a chunk drops its pages, so a pointer into the view is only
+// good until the next map() (from any thread) unless the chunk is held
+// by a Pin. Code that keeps pointers across calls, or shares the file
+// between threads, pins or copies the data out with read().
+class CompressedFile
+{
+public:
+  // Every chunk the creating thread maps while the Pin is alive stays
+  // resident until the Pin is destroyed. Pins nest, and a Pin for a
+  // nullptr file (an uncompressed Elf) does nothing.
+  class Pin
+  {
+  public:
+    Pin(CompressedFile *file);
+    ~Pin();
+
+  private:
+    Pin(const Pin &);
+    Pin &operator=(const Pin &);
+
+    CompressedFile *file;
+    Pin *previous;
+    std::vector<int> chunks;
+    std::vector<bool> held;
+
+    friend class CompressedFile;
+  };
+
+  CompressedFile();
+  ~CompressedFile();
+
+  static bool is_compressed(const char *filename);
+
+  int open(const char *filename);
+
+  uint8_t *get_view() { return view; }
+  uint64_t get_length() { return length; }
+
+  int map(uint64_t offset, uint64_t size);
+  int map_string(uint64_t offset);
+  int read(uint64_t offset, uint64_t size, uint8_t *data);
+
+  int get_chunks_inflated() { return chunks_inflated; }
+
+private:
+  struct Point
+  {
+    uint64_t out;
+    uint64_t in;
+    uint64_t window;
+    int bits;
+  };
+
+  struct IndexHeader
+  {
+    char magic[8];
+    uint64_t compressed_length;
+    uint64_t mtime;
+    uint64_t span;
+    uint64_t length;
+    uint64_t point_count;
+    uint64_t points_offset;
+  };
+
+  int load_index(FILE *index, uint64_t compressed_length, uint64_t mtime);
+  int build_index(FILE *index, uint64_t compressed_length, uint64_t mtime);
+  int find_chunk(uint64_t offset);
+  uint64_t get_chunk_end(int chunk);
+  int map_locked(uint64_t offset, uint64_t size);
+  int inflate_chunk(int chunk);
+  void hold_chunk(int chunk);
+  bool evict_chunk(int first, int last);
+  void trim();
+
+  static const uint64_t span = 4 * 1024 * 1024;
+  static const int window_size = 32768;
+  static const int max_resident = 32;
+
+  int fd;
+  FILE *index;
+  uint8_t *view;
+  uint64_t length;
+  std::vector<Point> points;
+  std::vector<uint64_t> last_used;
+  std::vector<int> resident;
+  std::vector<int> pin_count;
+  uint64_t clock;
+  int chunks_inflated;
+  std::mutex mutex;
+
+  static thread_local Pin *pins;
+};
+
+#endif
+
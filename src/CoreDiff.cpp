@@ -0,0 +1,671 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+#include "CoreDiff.h"
+#include "Parallel.h"
+
+int CoreDiff::print(const char *filename_a, const char *filename_b, int max_ranges)
+{
+  struct timespec start, end;
+  Elf *core_a;
+  Elf *core_b;
+
+  if (open_core(filename_a, core_a) != 0) { return -1; }
+
+  if (open_core(filename_b, core_b) != 0)
+  {
+    delete core_a;
+    return -1;
+  }
+
+  if (core_a->header.e_machine != core_b->header.e_machine ||
+      core_a->bitwidth != core_b->bitwidth)
+  {
+    printf("Error: %s and %s are for different machines.\n", filename_a, filename_b);
+    delete core_a;
+    delete core_b;
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  std::vector<Program> loads_a;
+  std::vector<Program> loads_b;
+  std::vector<Mapping> mappings;
+  std::vector<Job> jobs;
+
+  read_loads(core_a, loads_a);
+  read_loads(core_b, loads_b);
+
+  add_mappings(loads_a, loads_b, mappings, jobs);
+  add_labels(core_a, core_b, mappings);
+
+  // Each thread gets a contiguous run of windows so it reads its part
+  // of both files from front to back.
+  const int threads = Parallel::get_thread_count(jobs.size(), 4);
+  std::vector<Stream> streams(threads);
+
+  for (auto &stream : streams)
+  {
+    stream.stats.resize(mappings.size(), { 0, 0, 0 });
+    stream.has_head = false;
+    stream.has_tail = false;
+    stream.failed = 0;
+  }
+
+  Parallel::for_range(
+    threads,
+    jobs.size(),
+    [&](int thread, uint64_t start, uint64_t end)
+    {
+      Stream &stream = streams[thread];
+
+      if (start >= end) { return; }
+
+      stream.first = jobs[start];
+
+      for (uint64_t n = start; n < end; n++)
+      {
+        compare(core_a, core_b, jobs[n], max_ranges, stream);
+      }
+    });
+
+  // Ranges that run across the border between two threads get joined
+  // here, in thread (so address) order.
+  std::vector<Stats> stats(mappings.size(), { 0, 0, 0 });
+  std::vector<Range> largest;
+  Range carry = { 0, 0, 0, 0 };
+  bool has_carry = false;
+
+  auto can_join = [](const Range &a, const Range &b)
+  {
+    return a.mapping == b.mapping && a.end == b.start;
+  };
+
+  auto finish = [&](const Range &range)
+  {
+    stats[range.mapping].ranges++;
+    add_largest(largest, range, max_ranges);
+  };
+
+  uint64_t failed = 0;
+
+  for (auto &stream : streams)
+  {
+    failed += stream.failed;
+
+    for (size_t n = 0; n < mappings.size(); n++)
+    {
+      stats[n].pages += stream.stats[n].pages;
+      stats[n].bytes += stream.stats[n].bytes;
+      stats[n].ranges += stream.stats[n].ranges;
+    }
+
+    for (auto &range : stream.largest) { add_largest(largest, range, max_ranges); }
+
+    Range *first = nullptr;
+
+    if (stream.has_head)
+    {
+      first = &stream.head;
+    }
+      else
+    if (stream.has_tail &&
+        stream.tail.mapping == stream.first.mapping &&
+        stream.tail.start == stream.first.address)
+    {
+      first = &stream.tail;
+    }
+
+    if (has_carry)
+    {
+      if (first != nullptr && can_join(carry, *first))
+      {
+        first->start = carry.start;
+        first->bytes += carry.bytes;
+      }
+        else
+      {
+        finish(carry);
+      }
+
+      has_carry = false;
+    }
+
+    if (stream.has_head) { finish(stream.head); }
+
+    if (stream.has_tail)
+    {
+      carry = stream.tail;
+      has_carry = true;
+    }
+  }
+
+  if (has_carry) { finish(carry); }
+
+  std::sort(largest.begin(), largest.end(),
+    [](const Range &a, const Range &b) { return is_smaller(b, a); });
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  // Mappings that only one of the cores has are listed in with the rest.
+  std::vector<int> order;
+
+  for (int n = 0; n < (int)mappings.size(); n++) { order.push_back(n); }
+
+  std::sort(order.begin(), order.end(),
+    [&](int a, int b) { return mappings[a].start < mappings[b].start; });
+
+  uint64_t compared = 0;
+  uint64_t not_dumped = 0;
+  uint64_t pages = 0;
+  uint64_t bytes = 0;
+  int ranges = 0;
+  int changed = 0;
+  int only_in_a = 0;
+  int only_in_b = 0;
+
+  printf("Changed mappings:\n");
+
+  for (int n : order)
+  {
+    const Mapping &mapping = mappings[n];
+    const Stats &stat = stats[n];
+
+    compared += mapping.compared;
+    not_dumped += mapping.not_dumped;
+    pages += stat.pages;
+    bytes += stat.bytes;
+    ranges += stat.ranges;
+
+    const bool resized =
+      mapping.status == IN_BOTH &&
+      (mapping.other_start != mapping.start || mapping.other_end != mapping.end);
+
+    if (stat.pages == 0 && mapping.status == IN_BOTH && !resized) { continue; }
+
+    printf("  0x%016" PRIx64 "-0x%016" PRIx64 " %c%c%c ",
+      mapping.start,
+      mapping.end,
+      (mapping.flags & 4) != 0 ? 'r' : '-',
+      (mapping.flags & 2) != 0 ? 'w' : '-',
+      (mapping.flags & 1) != 0 ? 'x' : '-');
+
+    switch (mapping.status)
+    {
+      case ONLY_IN_A:
+        printf("%-42s", "only in a");
+        only_in_a++;
+        break;
+      case ONLY_IN_B:
+        printf("%-42s", "only in b");
+        only_in_b++;
+        break;
+      default:
+        printf("%12" PRIu64 " bytes in %6" PRIu64 " pages, %5d ranges",
+          stat.bytes, stat.pages, stat.ranges);
+        changed++;
+        break;
+    }
+
+    printf("  %s", mapping.label.c_str());
+
+    if (resized)
+    {
+      printf(" (b: 0x%" PRIx64 "-0x%" PRIx64 ")", mapping.other_start, mapping.other_end);
+    }
+
+    printf("\n");
+  }
+
+  if (changed == 0 && only_in_a == 0 && only_in_b == 0) { printf("  none\n"); }
+
+  if (largest.size() != 0)
+  {
+    printf("\nLargest changed ranges:\n");
+
+    for (auto &range : largest)
+    {
+      printf("  0x%016" PRIx64 "-0x%016" PRIx64 " %8" PRIu64 " pages %12" PRIu64
+             " bytes  %s\n",
+        range.start,
+        range.end,
+        (range.end - range.start + page_size - 1) / page_size,
+        range.bytes,
+        mappings[range.mapping].label.c_str());
+    }
+  }
+
+  const double ms =
+    (end.tv_sec - start.tv_sec) * 1000.0 +
+    (end.tv_nsec - start.tv_nsec) / 1000000.0;
+
+  printf("\nCompared %" PRIu64 " bytes in %d mappings: %" PRIu64 " pages (%" PRIu64
+         " bytes) changed in %d ranges, %d mappings only in a, %d only in b "
+         "(%.1f ms, %d threads)\n",
+    compared,
+    (int)mappings.size() - only_in_a - only_in_b,
+    pages,
+    bytes,
+    ranges,
+    only_in_a,
+    only_in_b,
+    ms,
+    threads);
+
+  if (not_dumped != 0)
+  {
+    printf("%" PRIu64 " bytes have no data in one of the cores "
+           "(see coredump_filter)\n", not_dumped);
+  }
+
+  if (failed != 0)
+  {
+    printf("Error: %" PRIu64 " bytes couldn't be read and weren't compared\n", failed);
+  }
+
+  delete core_a;
+  delete core_b;
+
+  return failed == 0 ? 0 : -1;
+}
+
+int CoreDiff::open_core(const char *filename, Elf *&elf)
+{
+  elf = Elf::open_elf(filename);
+
+  if (elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  if (elf->header.e_type != ET_CORE)
+  {
+    printf("Error: %s is not a core file.\n", filename);
+    delete elf;
+    return -1;
+  }
+
+  if (elf->compressed == nullptr)
+  {
+    posix_fadvise(elf->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+
+  return 0;
+}
+
+void CoreDiff::read_loads(Elf *elf, std::vector<Program> &loads)
+{
+  for (int count = 0; count < elf->get_program_count(); count++)
+  {
+    Program program;
+    elf->get_program(count, program);
+
+    if (program.p_type != PT_LOAD || program.p_memsz == 0) { continue; }
+
+    // A truncated core only has data up to the end of the file.
+    const uint64_t length = elf->buffer_len;
+
+    if (program.p_offset >= length)
+    {
+      program.p_filesz = 0;
+    }
+      else
+    if (program.p_offset + program.p_filesz > length)
+    {
+      program.p_filesz = length - program.p_offset;
+    }
+
+    program.p_filesz = std::min(program.p_filesz, program.p_memsz);
+
+    loads.push_back(program);
+  }
+
+  std::sort(loads.begin(), loads.end(),
+    [](const Program &a, const Program &b) { return a.p_vaddr < b.p_vaddr; });
+}
+
+void CoreDiff::add_mappings(
+  const std::vector<Program> &loads_a,
+  const std::vector<Program> &loads_b,
+  std::vector<Mapping> &mappings,
+  std::vector<Job> &jobs)
+{
+  std::vector<bool> used_b(loads_b.size(), false);
+  size_t first_b = 0;
+
+  for (auto &a : loads_a)
+  {
+    Mapping mapping;
+    mapping.start = a.p_vaddr;
+    mapping.end = a.p_vaddr + a.p_memsz;
+    mapping.other_start = UINT64_MAX;
+    mapping.other_end = 0;
+    mapping.flags = a.p_flags;
+    mapping.status = ONLY_IN_A;
+    mapping.compared = 0;
+    mapping.not_dumped = 0;
+
+    const int index = mappings.size();
+
+    while (first_b < loads_b.size() &&
+           loads_b[first_b].p_vaddr + loads_b[first_b].p_memsz <= mapping.start)
+    {
+      first_b++;
+    }
+
+    for (size_t n = first_b; n < loads_b.size(); n++)
+    {
+      const Program &b = loads_b[n];
+
+      if (b.p_vaddr >= mapping.end) { break; }
+      if (b.p_vaddr + b.p_memsz <= mapping.start) { continue; }
+
+      used_b[n] = true;
+
+      mapping.status = IN_BOTH;
+      mapping.other_start = std::min(mapping.other_start, b.p_vaddr);
+      mapping.other_end = std::max(mapping.other_end, b.p_vaddr + b.p_memsz);
+
+      const uint64_t low = std::max(mapping.start, b.p_vaddr);
+      const uint64_t high = std::min(mapping.end, b.p_vaddr + b.p_memsz);
+
+      // Only what both cores have data for can be compared.
+      uint64_t data_high = high;
+      data_high = std::min(data_high, a.p_vaddr + a.p_filesz);
+      data_high = std::min(data_high, b.p_vaddr + b.p_filesz);
+
+      if (data_high <= low)
+      {
+        mapping.not_dumped += high - low;
+        continue;
+      }
+
+      mapping.compared += data_high - low;
+      mapping.not_dumped += high - data_high;
+
+      for (uint64_t address = low; address < data_high; address += chunk_size)
+      {
+        Job job;
+        job.mapping = index;
+        job.address = address;
+        job.length = std::min((uint64_t)chunk_size, data_high - address);
+        job.offset_a = a.p_offset + (address - a.p_vaddr);
+        job.offset_b = b.p_offset + (address - b.p_vaddr);
+
+        jobs.push_back(job);
+      }
+    }
+
+    mappings.push_back(mapping);
+  }
+
+  for (size_t n = 0; n < loads_b.size(); n++)
+  {
+    if (used_b[n]) { continue; }
+
+    const Program &b = loads_b[n];
+
+    Mapping mapping;
+    mapping.start = b.p_vaddr;
+    mapping.end = b.p_vaddr + b.p_memsz;
+    mapping.other_start = 0;
+    mapping.other_end = 0;
+    mapping.flags = b.p_flags;
+    mapping.status = ONLY_IN_B;
+    mapping.compared = 0;
+    mapping.not_dumped = 0;
+
+    mappings.push_back(mapping);
+  }
+}
+
+void CoreDiff::add_labels(Elf *core_a, Elf *core_b, std::vector<Mapping> &mappings)
+{
+  std::vector<MappedFile> mapped_files[2];
+  std::vector<uint64_t> stack_pointers;
+  Elf *cores[2] = { core_a, core_b };
+
+  for (int n = 0; n < 2; n++)
+  {
+    Elf *core = cores[n];
+    std::vector<uint64_t> registers;
+    uint64_t sp_offset;
+
+    core->read_core_mapped_files(mapped_files[n]);
+
+    if (core->get_register_index("rsp", sp_offset) < 0 &&
+        core->get_register_index("esp", sp_offset) < 0)
+    {
+      continue;
+    }
+
+    core->read_core_threads(registers);
+
+    for (uint64_t offset : registers)
+    {
+      stack_pointers.push_back(core->read_reg(offset + sp_offset));
+    }
+  }
+
+  for (auto &mapping : mappings)
+  {
+    // A mapping that's only in b is named from b's NT_FILE.
+    const int first = mapping.status == ONLY_IN_B ? 1 : 0;
+
+    for (int n = 0; n < 2 && mapping.label.empty(); n++)
+    {
+      for (auto &mapped_file : mapped_files[first ^ n])
+      {
+        if (mapped_file.contains(mapping.start))
+        {
+          mapping.label = mapped_file.name;
+          break;
+        }
+      }
+    }
+
+    if (!mapping.label.empty()) { continue; }
+
+    for (uint64_t sp : stack_pointers)
+    {
+      if (sp >= mapping.start && sp < mapping.end)
+      {
+        mapping.label = "[stack]";
+        break;
+      }
+    }
+
+    if (!mapping.label.empty()) { continue; }
+
+    char label[32];
+
+    snprintf(label, sizeof(label), "[anon %c%c%c]",
+      (mapping.flags & 4) != 0 ? 'r' : '-',
+      (mapping.flags & 2) != 0 ? 'w' : '-',
+      (mapping.flags & 1) != 0 ? 'x' : '-');
+
+    mapping.label = label;
+  }
+}
+
+const uint8_t *CoreDiff::read(
+  Elf *elf,
+  uint64_t offset,
+  uint64_t length,
+  std::vector<uint8_t> &buffer)
+{
+  if (buffer.size() < length) { buffer.resize(length); }
+
+  // Other threads' reads can drop a chunk of a compressed core, so it's
+  // copied out under the CompressedFile lock.
+  if (elf->compressed != nullptr)
+  {
+    if (elf->read_data(offset, length, buffer.data()) != 0) { return nullptr; }
+
+    return buffer.data();
+  }
+
+  // pread() into a buffer that gets reused, rather than going through
+  // the mapping, so pages of a huge core don't pile up in this process.
+  uint64_t position = 0;
+
+  while (position < length)
+  {
+    ssize_t count = pread(elf->fd, buffer.data() + position, length - position, offset + position);
+
+    if (count == -1 && errno == EINTR) { continue; }
+    if (count <= 0) { return nullptr; }
+
+    position += count;
+  }
+
+  return buffer.data();
+}
+
+void CoreDiff::compare(
+  Elf *core_a,
+  Elf *core_b,
+  const Job &job,
+  int max_ranges,
+  Stream &stream)
+{
+  const uint8_t *a = read(core_a, job.offset_a, job.length, stream.buffer_a);
+  const uint8_t *b = read(core_b, job.offset_b, job.length, stream.buffer_b);
+
+  if (a == nullptr || b == nullptr)
+  {
+    printf("Error: Cannot read 0x%" PRIx64 " bytes at 0x%" PRIx64 " from core %c\n",
+      job.length,
+      job.address,
+      a == nullptr ? 'a' : 'b');
+    stream.failed += job.length;
+    return;
+  }
+
+  Stats &stats = stream.stats[job.mapping];
+
+  auto finish = [&](const Range &range)
+  {
+    if (range.mapping == stream.first.mapping && range.start == stream.first.address)
+    {
+      stream.head = range;
+      stream.has_head = true;
+      return;
+    }
+
+    stream.stats[range.mapping].ranges++;
+    add_largest(stream.largest, range, max_ranges);
+  };
+
+  for (uint64_t n = 0; n < job.length; n += page_size)
+  {
+    const uint64_t length = std::min((uint64_t)page_size, job.length - n);
+
+    // memcmp() is already vectorized and most pages are the same.
+    if (memcmp(a + n, b + n, length) == 0) { continue; }
+
+    const uint64_t address = job.address + n;
+    const uint64_t count = count_changed(a + n, b + n, length);
+
+    stats.pages++;
+    stats.bytes += count;
+
+    if (stream.has_tail &&
+        stream.tail.mapping == job.mapping &&
+        stream.tail.end == address)
+    {
+      stream.tail.end = address + length;
+      stream.tail.bytes += count;
+      continue;
+    }
+
+    if (stream.has_tail) { finish(stream.tail); }
+
+    stream.tail = { job.mapping, address, address + length, count };
+    stream.has_tail = true;
+  }
+}
+
+uint64_t CoreDiff::count_changed(const uint8_t *a, const uint8_t *b, uint64_t length)
+{
+  uint64_t count = 0;
+  uint64_t n = 0;
+
+#ifdef __SSE2__
+  for (; n + 16 <= length; n += 16)
+  {
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i *)(a + n)),
+      _mm_loadu_si128((const __m128i *)(b + n))));
+
+    count += 16 - __builtin_popcount(mask);
+  }
+#endif
+
+  for (; n < length; n++)
+  {
+    if (a[n] != b[n]) { count++; }
+  }
+
+  return count;
+}
+
+void CoreDiff::add_largest(std::vector<Range> &largest, const Range &range, int max_ranges)
+{
+  // A heap with the smallest of the kept ranges on top.
+  auto compare = [](const Range &a, const Range &b) { return is_smaller(b, a); };
+
+  if (max_ranges <= 0) { return; }
+
+  if ((int)largest.size() < max_ranges)
+  {
+    largest.push_back(range);
+    std::push_heap(largest.begin(), largest.end(), compare);
+    return;
+  }
+
+  if (!is_smaller(largest.front(), range)) { return; }
+
+  std::pop_heap(largest.begin(), largest.end(), compare);
+  largest.back() = range;
+  std::push_heap(largest.begin(), largest.end(), compare);
+}
+
+bool CoreDiff::is_smaller(const Range &a, const Range &b)
+{
+  const uint64_t length_a = a.end - a.start;
+  const uint64_t length_b = b.end - b.start;
+
+  if (length_a != length_b) { return length_a < length_b; }
+  if (a.bytes != b.bytes) { return a.bytes < b.bytes; }
+
+  // Ties go to the lower address.
+  return a.start > b.start;
+}
+
@@ -0,0 +1,137 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_CORE_DIFF_H
+#define MAGIC_ELF_CORE_DIFF_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Elf.h"
+
+// Memory diff of two cores of the same process. PT_LOAD segments are
+// lined up by address, and the part that both cores have data for is
+// read in fixed windows on all threads and compared a page at a time.
+// Changed pages are counted per mapping (named through NT_FILE, or as a
+// stack / anonymous region) and joined into ranges, of which only the
+// largest are kept. Memory use depends on the thread count and not on
+// the size of the cores, since each thread streams its share of the
+// files through two window buffers. (Compressed cores are copied into
+// the same buffers through CompressedFile.)
+class CoreDiff
+{
+public:
+  static int print(const char *filename_a, const char *filename_b, int max_ranges);
+
+private:
+  CoreDiff();
+  ~CoreDiff();
+
+  enum
+  {
+    IN_BOTH,
+    ONLY_IN_A,
+    ONLY_IN_B,
+  };
+
+  struct Mapping
+  {
+    uint64_t start;
+    uint64_t end;
+    uint64_t other_start;
+    uint64_t other_end;
+    uint32_t flags;
+    int status;
+    std::string label;
+    uint64_t compared;
+    uint64_t not_dumped;
+  };
+
+  struct Job
+  {
+    int mapping;
+    uint64_t address;
+    uint64_t length;
+    uint64_t offset_a;
+    uint64_t offset_b;
+  };
+
+  struct Range
+  {
+    int mapping;
+    uint64_t start;
+    uint64_t end;
+    uint64_t bytes;
+  };
+
+  struct Stats
+  {
+    uint64_t pages;
+    uint64_t bytes;
+    int ranges;
+  };
+
+  // What one thread has found in its share of the jobs. The first
+  // range (if it starts where the thread started) and the one still open
+  // at the end may continue in the neighbouring threads, so they're kept
+  // out of the list until the threads are joined.
+  struct Stream
+  {
+    std::vector<uint8_t> buffer_a;
+    std::vector<uint8_t> buffer_b;
+    std::vector<Stats> stats;
+    std::vector<Range> largest;
+    Job first;
+    Range head;
+    Range tail;
+    bool has_head;
+    bool has_tail;
+    uint64_t failed;
+  };
+
+  static int open_core(const char *filename, Elf *&elf);
+
+  static void read_loads(Elf *elf, std::vector<Program> &loads);
+
+  static void add_mappings(
+    const std::vector<Program> &loads_a,
+    const std::vector<Program> &loads_b,
+    std::vector<Mapping> &mappings,
+    std::vector<Job> &jobs);
+
+  static void add_labels(Elf *core_a, Elf *core_b, std::vector<Mapping> &mappings);
+
+  static const uint8_t *read(
+    Elf *elf,
+    uint64_t offset,
+    uint64_t length,
+    std::vector<uint8_t> &buffer);
+
+  static void compare(
+    Elf *core_a,
+    Elf *core_b,
+    const Job &job,
+    int max_ranges,
+    Stream &stream);
+
+  static uint64_t count_changed(const uint8_t *a, const uint8_t *b, uint64_t length);
+
+  static void add_largest(std::vector<Range> &largest, const Range &range, int max_ranges);
+
+  static bool is_smaller(const Range &a, const Range &b);
+
+  static const uint64_t chunk_size = 4 * 1024 * 1024;
+  static const uint64_t page_size = 4096;
+};
+
+#endif
+
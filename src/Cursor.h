@@ -0,0 +1,72 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_CURSOR_H
+#define MAGIC_ELF_CURSOR_H
+
+#include <stdint.h>
+
+#include "Elf.h"
+
+// A read position in an Elf. The Elf itself doesn't have one, so each
+// caller (or thread) walking headers, notes or symbol tables holds its
+// own. Copying a Cursor is how a nested walk saves its place.
+class Cursor
+{
+public:
+  Cursor(const Elf *elf, uint64_t offset = 0) :
+    elf    { elf },
+    offset { offset }
+  {
+  }
+
+  uint8_t read_int8() { return elf->read_int8(offset++); }
+
+  uint16_t read_int16()
+  {
+    uint16_t value = elf->read_int16(offset);
+    offset += 2;
+    return value;
+  }
+
+  uint32_t read_int32()
+  {
+    uint32_t value = elf->read_int32(offset);
+    offset += 4;
+    return value;
+  }
+
+  uint64_t read_int64()
+  {
+    uint64_t value = elf->read_int64(offset);
+    offset += 8;
+    return value;
+  }
+
+  uint16_t read_half()  { return read_int16(); }
+  uint32_t read_word()  { return read_int32(); }
+  uint64_t read_xword() { return read_int64(); }
+
+  uint64_t read_addr()
+  {
+    return elf->bitwidth == 32 ? read_int32() : read_int64();
+  }
+
+  uint64_t read_offset() { return read_addr(); }
+
+  void skip(uint64_t length) { offset += length; }
+
+  const Elf *elf;
+  uint64_t offset;
+};
+
+#endif
+
@@ -0,0 +1,110 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <cxxabi.h>
+
+#include "Demangle.h"
+#include "Parallel.h"
+
+Demangle::Demangle() :
+  buffer { NULL },
+  length { 0 }
+{
+}
+
+Demangle::~Demangle()
+{
+  free(buffer);
+}
+
+const char *Demangle::demangle(const char *name)
+{
+  if (!is_mangled(name)) { return name; }
+
+  auto iter = memo.find(name);
+
+  if (iter != memo.end()) { return iter->second.c_str(); }
+
+  std::string &result = memo[name];
+
+  demangle_name(name, result, buffer, length);
+
+  return result.c_str();
+}
+
+void Demangle::demangle_batch(std::vector<const char *> &names)
+{
+  // Reserve a memo slot for every name not seen yet. The slots don't
+  // move once created, so the threads can fill them in without locking.
+  std::vector<const char *> missing;
+  std::vector<std::string *> slots;
+
+  for (const char *name : names)
+  {
+    if (!is_mangled(name)) { continue; }
+
+    auto result = memo.emplace(name, std::string());
+
+    if (result.second)
+    {
+      missing.push_back(name);
+      slots.push_back(&result.first->second);
+    }
+  }
+
+  Parallel::for_range(
+    Parallel::get_thread_count(missing.size(), 4096),
+    missing.size(),
+    [&missing, &slots](int thread, uint64_t start, uint64_t end)
+    {
+      char *buffer = NULL;
+      size_t length = 0;
+
+      for (uint64_t n = start; n < end; n++)
+      {
+        demangle_name(missing[n], *slots[n], buffer, length);
+      }
+
+      free(buffer);
+    });
+
+  for (auto &name : names)
+  {
+    name = demangle(name);
+  }
+}
+
+bool Demangle::demangle_name(
+  const char *name,
+  std::string &result,
+  char *&buffer,
+  size_t &length)
+{
+  int status;
+
+  char *demangled = abi::__cxa_demangle(name, buffer, &length, &status);
+
+  if (status != 0)
+  {
+    result = name;
+    return false;
+  }
+
+  buffer = demangled;
+  result = demangled;
+
+  return true;
+}
+
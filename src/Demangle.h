@@ -0,0 +1,51 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_DEMANGLE_H
+#define MAGIC_ELF_DEMANGLE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// C++ name demangling with a memo table so names that show up more than
+// once (.symtab and .dynsym, local symbols, repeated lookups) are only
+// run through abi::__cxa_demangle() once. Whole tables can be demangled
+// in parallel with demangle_batch().
+class Demangle
+{
+public:
+  Demangle();
+  ~Demangle();
+
+  const char *demangle(const char *name);
+  void demangle_batch(std::vector<const char *> &names);
+
+  static bool is_mangled(const char *name)
+  {
+    return name[0] == '_' && name[1] == 'Z';
+  }
+
+  static bool demangle_name(
+    const char *name,
+    std::string &result,
+    char *&buffer,
+    size_t &length);
+
+private:
+  std::unordered_map<std::string, std::string> memo;
+  char *buffer;
+  size_t length;
+};
+
+#endif
+
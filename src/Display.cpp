@@ -14,10 +14,16 @@
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
 
 #include "defines.h"
 #include "Display.h"
 #include "Elf.h"
+#include "Extents.h"
 
 int Display::symbol_value(const char *filename, const char *symbol_name)
 {
@@ -38,7 +44,7 @@ int Display::symbol_value(const char *filename, const char *symbol_name)
   {
     uint64_t offset = elf->address_to_offset(elf->get_addr(file_offset));
 
-    printf("%s=%s\n", symbol_name, elf->buffer + offset);
+    printf("%s=%s\n", symbol_name, elf->get_cstring(offset));
   }
 
   delete elf;
@@ -46,3 +52,37 @@ int Display::symbol_value(const char *filename, const char *symbol_name)
   return 0;
 }
 
+
+int Display::file_stats(const char *filename)
+{
+  struct stat stat_buf;
+  std::vector<Extents::Extent> extents;
+
+  int fd = open(filename, O_RDONLY);
+
+  if (fd == -1)
+  {
+    printf("Error: Cannot open file %s\n", filename);
+    return -1;
+  }
+
+  fstat(fd, &stat_buf);
+
+  printf("File Stats\n");
+  printf("---------------------------------------------\n");
+  printf("    size: %" PRId64 "\n", (int64_t)stat_buf.st_size);
+  printf("  blocks: %" PRId64 " (%" PRId64 " bytes allocated)\n\n",
+    (int64_t)stat_buf.st_blocks,
+    (int64_t)stat_buf.st_blocks * 512);
+
+  if (Extents::get_data_extents(fd, stat_buf.st_size, extents) != 0)
+  {
+    printf("Note: Filesystem doesn't support SEEK_DATA/SEEK_HOLE.\n\n");
+  }
+
+  Extents::print(extents, stat_buf.st_size);
+
+  close(fd);
+
+  return 0;
+}
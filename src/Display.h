@@ -18,6 +18,7 @@ class Display
 {
 public:
   static int symbol_value(const char *filename, const char *symbol_name);
+  static int file_stats(const char *filename);
 
 private:
   Display();
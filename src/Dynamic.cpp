@@ -0,0 +1,88 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdint.h>
+
+#include "defines.h"
+#include "Dynamic.h"
+
+bool Dynamic::is_string() const
+{
+  switch (d_tag)
+  {
+    case DT_NEEDED:
+    case DT_SONAME:
+    case DT_RPATH:
+    case DT_RUNPATH:
+    case DT_AUXILIARY:
+    case DT_FILTER:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char *Dynamic::get_tag_type(int64_t tag)
+{
+  const char *types[] =
+  {
+    "NULL",         "NEEDED",       "PLTRELSZ",     "PLTGOT",
+    "HASH",         "STRTAB",       "SYMTAB",       "RELA",
+    "RELASZ",       "RELAENT",      "STRSZ",        "SYMENT",
+    "INIT",         "FINI",         "SONAME",       "RPATH",
+    "SYMBOLIC",     "REL",          "RELSZ",        "RELENT",
+    "PLTREL",       "DEBUG",        "TEXTREL",      "JMPREL",
+    "BIND_NOW",     "INIT_ARRAY",   "FINI_ARRAY",   "INIT_ARRAYSZ",
+    "FINI_ARRAYSZ", "RUNPATH",      "FLAGS",        "UNKNOWN",
+    "PREINIT_ARRAY", "PREINIT_ARRAYSZ", "SYMTAB_SHNDX", "RELRSZ",
+    "RELR",         "RELRENT"
+  };
+
+  if (tag >= 0 && tag <= DT_RELRENT) { return types[tag]; }
+
+  switch (tag)
+  {
+    case 0x6ffffdf5:   return "GNU_PRELINKED";
+    case 0x6ffffdf6:   return "GNU_CONFLICTSZ";
+    case 0x6ffffdf7:   return "GNU_LIBLISTSZ";
+    case 0x6ffffdf8:   return "CHECKSUM";
+    case 0x6ffffdf9:   return "PLTPADSZ";
+    case 0x6ffffdfa:   return "MOVEENT";
+    case 0x6ffffdfb:   return "MOVESZ";
+    case 0x6ffffdfc:   return "FEATURE_1";
+    case 0x6ffffdfd:   return "POSFLAG_1";
+    case 0x6ffffdfe:   return "SYMINSZ";
+    case 0x6ffffdff:   return "SYMINENT";
+    case DT_GNU_HASH:  return "GNU_HASH";
+    case 0x6ffffef6:   return "TLSDESC_PLT";
+    case 0x6ffffef7:   return "TLSDESC_GOT";
+    case 0x6ffffef8:   return "GNU_CONFLICT";
+    case 0x6ffffef9:   return "GNU_LIBLIST";
+    case 0x6ffffefa:   return "CONFIG";
+    case 0x6ffffefb:   return "DEPAUDIT";
+    case 0x6ffffefc:   return "AUDIT";
+    case 0x6ffffefd:   return "PLTPAD";
+    case 0x6ffffefe:   return "MOVETAB";
+    case 0x6ffffeff:   return "SYMINFO";
+    case DT_VERSYM:    return "VERSYM";
+    case DT_RELACOUNT: return "RELACOUNT";
+    case DT_RELCOUNT:  return "RELCOUNT";
+    case DT_FLAGS_1:   return "FLAGS_1";
+    case DT_VERDEF:    return "VERDEF";
+    case DT_VERDEFNUM: return "VERDEFNUM";
+    case DT_VERNEED:   return "VERNEED";
+    case DT_VERNEEDNUM: return "VERNEEDNUM";
+    case DT_AUXILIARY: return "AUXILIARY";
+    case DT_FILTER:    return "FILTER";
+    default:           return "UNKNOWN";
+  }
+}
+
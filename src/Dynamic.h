@@ -0,0 +1,39 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_DYNAMIC_H
+#define MAGIC_ELF_DYNAMIC_H
+
+#include <stdint.h>
+
+struct Dynamic
+{
+  Dynamic() :
+    d_tag { 0 },
+    d_val { 0 }
+  {
+  }
+
+  ~Dynamic()
+  {
+  }
+
+  const char *get_tag_type() const { return get_tag_type(d_tag); }
+  bool is_string() const;
+
+  static const char *get_tag_type(int64_t tag);
+
+  int64_t d_tag;
+  uint64_t d_val;
+};
+
+#endif
+
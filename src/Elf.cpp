@@ -23,8 +23,13 @@
 #else
 #include <sys/mman.h>
 #endif
+#include <zlib.h>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "defines.h"
+#include "Cursor.h"
 #include "Elf.h"
 #include "Elf32.h"
 #include "Elf64.h"
@@ -34,19 +39,28 @@
 
 Elf::Elf() :
   fd                  { -1 },
+  buffer              { nullptr },
+  compressed          { nullptr },
   bitwidth            { 0 },
   buffer_len          { 0 },
-  file_ptr            { 0 },
   is_little_endian    { true },
   string_table_offset { 0 },
   symbol_table_offset { 0 },
   symbol_table_length { 0 },
-  str_sym_tbl_offset  { 0 }
+  str_sym_tbl_offset  { 0 },
+  dynsym_offset       { 0 },
+  dynsym_entsize      { 0 },
+  dynstr_offset       { 0 },
+  dynstr_length       { 0 },
+  hash_offset         { 0 },
+  demangle            { nullptr }
 {
 }
 
 Elf::~Elf()
 {
+  delete compressed;
+
   if (fd > 0)
   {
 #ifdef _WIN32
@@ -65,18 +79,21 @@ Elf *Elf::open_elf(const char *filename, bool writable)
   Elf *elf;
 
   // Open file to figure out if it's little endian / 32 or 64 bit.
-  FILE *fp = fopen(filename, "rb");
+  // gzread() passes through files that aren't compressed.
+  gzFile fp = gzopen(filename, "rb");
   if (fp == NULL) { return NULL; }
 
   uint8_t buffer[20];
-  if (fread(buffer, 1, sizeof(buffer), fp) != sizeof(buffer))
+  if (gzread(fp, buffer, sizeof(buffer)) != sizeof(buffer))
   {
     printf("Error: File not found.\n");
-    fclose(fp);
+    gzclose(fp);
     return NULL;
   }
 
-  fclose(fp);
+  gzclose(fp);
+
+  if (memcmp(buffer, "\x7f" "ELF", 4) != 0) { return NULL; }
 
   int ei_class = buffer[4];
   int ei_data  = buffer[5];
@@ -95,16 +112,23 @@ Elf *Elf::open_elf(const char *filename, bool writable)
     return nullptr;
   }
 
-  elf->read_header();
+  if (elf->read_header() != 0)
+  {
+    printf("Error: Cannot read ELF header.\n");
+    delete elf;
+    return nullptr;
+  }
 
   return elf;
 }
 
-Elf *Elf::open_elf_from_mem(void *mem_ptr)
+Elf *Elf::open_elf_from_mem(void *mem_ptr, long length)
 {
   Elf *elf;
   uint8_t *ident = (uint8_t *)mem_ptr;
 
+  if (length < 20 || memcmp(ident, "\x7f" "ELF", 4) != 0) { return nullptr; }
+
   int ei_data  = ident[5];
   int e_machine = ei_data == 1 ?
     ident[18] | (ident[19] << 8) :
@@ -114,6 +138,9 @@ Elf *Elf::open_elf_from_mem(void *mem_ptr)
 
   elf->is_little_endian = ident[5] == 1;
   elf->buffer = (uint8_t *)mem_ptr;
+  elf->buffer_len = length;
+
+  elf->read_header();
 
   return elf;
 }
@@ -122,6 +149,20 @@ int Elf::read_file(const char *filename, bool writable)
 {
   struct stat stat_buf;
 
+  if (CompressedFile::is_compressed(filename))
+  {
+    if (writable) { return -1; }
+
+    compressed = new CompressedFile();
+
+    if (compressed->open(filename) != 0) { return -1; }
+
+    buffer = compressed->get_view();
+    buffer_len = compressed->get_length();
+
+    return 0;
+  }
+
   fd = open(filename, writable ? O_RDWR : O_RDONLY);
 
   if (fd == -1) { return -1; }
@@ -171,7 +212,11 @@ int Elf::read_file(const char *filename, bool writable)
 
 int Elf::read_header()
 {
-  memcpy(header.e_ident, buffer, 16);
+  const uint8_t *ident = get_data(0, 16);
+
+  if (ident == nullptr) { return -1; }
+
+  memcpy(header.e_ident, ident, 16);
 
   header.ei_class      = header.e_ident[4];
   header.ei_data       = header.e_ident[5];
@@ -179,27 +224,39 @@ int Elf::read_header()
   header.ei_osabi      = header.e_ident[7];
   header.ei_abiversion = header.e_ident[8];
 
-  set_file_ptr(16);
-
-  header.e_type      = read_half();
-  header.e_machine   = read_half();
-  header.e_version   = read_word();
-  header.e_entry     = read_addr();
-  header.e_phoff     = read_offset();
-  header.e_shoff     = read_offset();
-  header.e_flags     = read_word();
-  header.e_ehsize    = read_half();
-  header.e_phentsize = read_half();
-  header.e_phnum     = read_half();
-  header.e_shentsize = read_half();
-  header.e_shnum     = read_half();
-  header.e_shstrndx  = read_half();
+  Cursor cursor(this, 16);
+
+  header.e_type      = cursor.read_half();
+  header.e_machine   = cursor.read_half();
+  header.e_version   = cursor.read_word();
+  header.e_entry     = cursor.read_addr();
+  header.e_phoff     = cursor.read_offset();
+  header.e_shoff     = cursor.read_offset();
+  header.e_flags     = cursor.read_word();
+  header.e_ehsize    = cursor.read_half();
+  header.e_phentsize = cursor.read_half();
+  header.e_phnum     = cursor.read_half();
+  header.e_shentsize = cursor.read_half();
+  header.e_shnum     = cursor.read_half();
+  header.e_shstrndx  = cursor.read_half();
+
+  // A partial image (a core read from a pipe, a memory-backed image)
+  // might not contain the section header table.
+  if (header.e_shoff + (uint64_t)header.e_shnum * header.e_shentsize >
+      (uint64_t)buffer_len)
+  {
+    header.e_shnum = 0;
+    read_dynamic();
+    return 0;
+  }
 
   compute_string_table_offset();
 
   str_sym_tbl_offset = find_section_offset(SHT_STRTAB, ".strtab", NULL);
   symbol_table_offset = find_section_offset(SHT_SYMTAB, NULL, &symbol_table_length);
 
+  read_dynamic();
+
   return 0;
 }
 
@@ -230,8 +287,6 @@ void Elf::print_header()
      header.get_osabi_type());
   printf("             EI_ABIVER=%d\n", header.ei_abiversion);
 
-  set_file_ptr(16);
-
   printf("     e_type: %02x %s\n", header.e_type, header.get_type_type());
   printf("  e_machine: 0x%x %s\n", header.e_machine, header.get_machine_type());
   printf("  e_version: %d\n", header.e_version);
@@ -256,52 +311,48 @@ void Elf::print_program_headers()
 
   for (int count = 0; count < get_program_count(); count++)
   {
-    set_file_ptr(get_program_offset() + (get_program_size() * count));
+    const uint64_t offset =
+      get_program_offset() + (get_program_size() * count);
 
-    printf("Program Header %d (offset=0x%04" PRIx64 ")\n", count, file_ptr);
+    printf("Program Header %d (offset=0x%04" PRIx64 ")\n", count, offset);
     printf("---------------------------------------------\n");
 
     Program program;
-    read_program(program);
+    get_program(count, program);
     print_program(program);
 
     if (program.p_type == PT_NOTE)
     {
       print_program_note(program);
     }
+
+    // Without section headers this is the only place it gets shown.
+    if (program.p_type == PT_DYNAMIC && get_section_count() == 0)
+    {
+      print_section_dynamic();
+    }
   }
 }
 
 void Elf::print_program_note(Program &program)
 {
-  uint32_t align_mask = bitwidth == 32 ? 3 : 7;
-  uint64_t bytes_used = 0;
-
-  set_file_ptr(program.p_offset);
+  uint64_t position = 0;
+  Note note;
 
-  while (bytes_used < program.p_filesz)
+  while (read_note(program, position, note) == 0)
   {
-    int namesz = read_word();
-    int descsz = read_word();
-    int type   = read_word();
-
-    int namesz_align = (namesz + align_mask) & ~align_mask;
-    int descsz_align = (descsz + align_mask) & ~align_mask;
-    char name[1024];
-
-    read_note_name(name, sizeof(name), namesz, namesz_align);
+    Cursor cursor(this, note.desc);
 
     // FIXME - There's a lot more things that can be put in here.
     // They will come back as unknown, but can be added as needed.
     printf("%8s 0x%04x  [0x%x] %s\n",
-      name, descsz, type, program.get_note_type(type));
+      note.name, note.descsz, note.type, program.get_note_type(note.type));
 
-    // FIXME - Um. When there is a GNU section it's 4 bytes off. Why?
-    if (strcmp(name, "GNU") == 0)
+    if (strcmp(note.name, "GNU") == 0)
     {
-      for (int n = 0; n < descsz; n++)
+      for (uint32_t n = 0; n < note.descsz; n++)
       {
-        uint8_t c = read_int8();
+        uint8_t c = cursor.read_int8();
 
         if (c >= ' ' && c < 127)
         {
@@ -313,142 +364,149 @@ void Elf::print_program_note(Program &program)
         }
       }
       printf("\n");
-      break;
+      continue;
     }
 
-    bool is_core = strcmp(name, "CORE") == 0;
+    bool is_core = strcmp(note.name, "CORE") == 0;
 
-    switch (type)
+    switch (note.type)
     {
       case NT_PRSTATUS:
-        if (is_core) { print_core_prstatus(); }
+        if (is_core) { print_core_prstatus(cursor); }
         break;
       case NT_PRFPREG:
         //print_core_regs();
         break;
       case 3:
-        if (is_core) { print_core_prpsinfo(); }
+        if (is_core) { print_core_prpsinfo(cursor); }
         break;
       case NT_SIGINFO:
-        if (is_core) { print_core_siginfo(); }
+        if (is_core) { print_core_siginfo(cursor); }
         break;
       case NT_FILE:
-        print_core_mapped_files(descsz);
+        print_core_mapped_files(cursor, note.descsz);
         break;
       default:
         break;
     }
-
-    file_ptr += descsz_align;
-
-    bytes_used += (4 * 3) + namesz_align + descsz_align;
   }
 
   printf("\n");
 }
 
-uint64_t Elf::get_core_registers_from_note(Program &program, uint32_t pid)
+// Linux pads notes to 4 bytes even in 64 bit files, so only a segment
+// that asks for 8 byte alignment (.note.gnu.property) gets it.
+int Elf::read_note(const Program &program, uint64_t &position, Note &note) const
 {
-  uint32_t align_mask = bitwidth == 32 ? 3 : 7;
-  uint64_t bytes_used = 0;
+  const uint64_t align = program.p_align == 8 ? 8 : 4;
 
-  push_ptr();
+  if (position + 12 > program.p_filesz ||
+      program.p_offset + program.p_filesz > (uint64_t)buffer_len)
+  {
+    return -1;
+  }
 
-  set_file_ptr(program.p_offset);
+  Cursor cursor(this, program.p_offset + position);
 
-  while (bytes_used < program.p_filesz)
-  {
-    int namesz = read_word();
-    int descsz = read_word();
-    int type   = read_word();
+  const uint32_t namesz = cursor.read_word();
+  note.descsz = cursor.read_word();
+  note.type   = cursor.read_word();
 
-    int namesz_align = (namesz + align_mask) & ~align_mask;
-    int descsz_align = (descsz + align_mask) & ~align_mask;
-    char name[1024];
+  const uint64_t desc = (position + 12 + namesz + align - 1) & ~(align - 1);
 
-    read_note_name(name, sizeof(name), namesz, namesz_align);
+  if (desc + note.descsz > program.p_filesz) { return -1; }
 
-    if (strcmp(name, "CORE") == 0)
-    {
-      if (type == NT_PRSTATUS)
-      {
-        push_ptr();
-        PRStatus prstatus;
-        read_core_prstatus(prstatus);
-        uint64_t offset = file_ptr;
-        pop_ptr();
+  read_note_name(
+    cursor,
+    note.name,
+    sizeof(note.name),
+    namesz,
+    desc - (position + 12));
 
-        if (prstatus.pid == pid)
-        {
-          pop_ptr();
-          return offset;
-        }
-      }
-    }
+  note.desc = program.p_offset + desc;
+  position = (desc + note.descsz + align - 1) & ~(align - 1);
 
-    file_ptr += descsz_align;
+  return 0;
+}
 
-    bytes_used += (4 * 3) + namesz_align + descsz_align;
-  }
+uint64_t Elf::get_core_registers_from_note(Program &program, uint32_t pid) const
+{
+  uint64_t position = 0;
+  Note note;
 
-  pop_ptr();
+  while (read_note(program, position, note) == 0)
+  {
+    if (note.type == NT_PRSTATUS && strcmp(note.name, "CORE") == 0)
+    {
+      Cursor desc(this, note.desc);
+      PRStatus prstatus;
+      read_core_prstatus(desc, prstatus);
+
+      if (prstatus.pid == pid) { return desc.offset; }
+    }
+  }
 
   return 0;
 }
 
-void Elf::read_note_name(char *name, int length, int namesz, int namesz_align)
+void Elf::read_note_name(
+  Cursor &cursor,
+  char *name,
+  int length,
+  int namesz,
+  int namesz_align) const
 {
   if (namesz < length - 1)
   {
     int n;
-    for (n = 0; n < namesz; n++) { name[n] = read_int8(); }
+    for (n = 0; n < namesz; n++) { name[n] = cursor.read_int8(); }
     name[n] = 0;
 
-    file_ptr += namesz_align - namesz;
+    cursor.skip(namesz_align - namesz);
   }
     else
   {
-    file_ptr += namesz_align;
+    cursor.skip(namesz_align);
     name[0] = 0;
   }
 }
 
-void Elf::read_core_prstatus(PRStatus &prstatus)
+void Elf::read_core_prstatus(Cursor &cursor, PRStatus &prstatus) const
 {
-  prstatus.signal_number = read_int32();
-  prstatus.extra_code = read_int32();
-  prstatus._errno = read_int32();
-  prstatus.cursig = read_int16();
+  prstatus.signal_number = cursor.read_int32();
+  prstatus.extra_code = cursor.read_int32();
+  prstatus._errno = cursor.read_int32();
+  prstatus.cursig = cursor.read_int16();
 
   if (bitwidth == 64)
   {
-    prstatus.unknown_1 = read_int16();
+    prstatus.unknown_1 = cursor.read_int16();
   }
 
-  prstatus.sigpend = read_offset();
-  prstatus.sighold = read_offset();
-
-  prstatus.pid = read_int32();
-  prstatus.ppid = read_int32();
-  prstatus.pgrp = read_int32();
-  prstatus.psid = read_int32();
-
-  prstatus.user_time_sec = read_offset();
-  prstatus.user_time_usec = read_offset();
-  prstatus.system_time_sec = read_offset();
-  prstatus.system_time_usec = read_offset();
-  prstatus.cumulative_user_time_sec = read_offset();
-  prstatus.cumulative_user_time_usec = read_offset();
-  prstatus.cumulative_system_time_sec = read_offset();
-  prstatus.cumulative_system_time_usec = read_offset();
+  prstatus.sigpend = cursor.read_offset();
+  prstatus.sighold = cursor.read_offset();
+
+  prstatus.pid = cursor.read_int32();
+  prstatus.ppid = cursor.read_int32();
+  prstatus.pgrp = cursor.read_int32();
+  prstatus.psid = cursor.read_int32();
+
+  prstatus.user_time_sec = cursor.read_offset();
+  prstatus.user_time_usec = cursor.read_offset();
+  prstatus.system_time_sec = cursor.read_offset();
+  prstatus.system_time_usec = cursor.read_offset();
+  prstatus.cumulative_user_time_sec = cursor.read_offset();
+  prstatus.cumulative_user_time_usec = cursor.read_offset();
+  prstatus.cumulative_system_time_sec = cursor.read_offset();
+  prstatus.cumulative_system_time_usec = cursor.read_offset();
 }
 
-void Elf::print_core_prstatus()
+void Elf::print_core_prstatus(Cursor &cursor)
 {
-  push_ptr();
+  Cursor desc = cursor;
 
   PRStatus prstatus;
-  read_core_prstatus(prstatus);
+  read_core_prstatus(desc, prstatus);
 
   printf("        signal_number: %d\n", prstatus.signal_number);
   printf("           extra_code: %d\n", prstatus.extra_code);
@@ -476,48 +534,202 @@ void Elf::print_core_prstatus()
     prstatus.cumulative_system_time_sec,
     prstatus.cumulative_system_time_usec);
 
-  print_registers();
-  pop_ptr();
+  print_registers(desc);
 }
 
-void Elf::print_core_prpsinfo()
+void Elf::print_core_prpsinfo(Cursor &cursor)
 {
-  push_ptr();
+  Cursor desc = cursor;
 
   char filename[16];
   char args[80];
   int n;
-  printf("            state: %d\n", read_int8());
-  printf("            sname: %d\n", read_int8());
-  printf("           zombie: %d\n", read_int8());
-  printf("             nice: %d\n", read_int8());
+  printf("            state: %d\n", desc.read_int8());
+  printf("            sname: %d\n", desc.read_int8());
+  printf("           zombie: %d\n", desc.read_int8());
+  printf("             nice: %d\n", desc.read_int8());
   // FIXME - only 64 bit?
-  file_ptr += 4;
-  printf("             flag: %" PRId64 "\n", read_offset());
-  //printf("             flag: %d\n", read_int32());
-  printf("              uid: %d\n", read_int32());
-  printf("              gid: %d\n", read_int32());
-  printf("              pid: %d\n", read_int32());
-  printf("             ppid: %d\n", read_int32());
-  printf("             pgrp: %d\n", read_int32());
-  printf("              sid: 0x%x\n", read_int32());
-  for (n = 0; n < 16; n++) { filename[n] = read_int8(); }
+  desc.skip(4);
+  printf("             flag: %" PRId64 "\n", desc.read_offset());
+  //printf("             flag: %d\n", desc.read_int32());
+  printf("              uid: %d\n", desc.read_int32());
+  printf("              gid: %d\n", desc.read_int32());
+  printf("              pid: %d\n", desc.read_int32());
+  printf("             ppid: %d\n", desc.read_int32());
+  printf("             pgrp: %d\n", desc.read_int32());
+  printf("              sid: 0x%x\n", desc.read_int32());
+  for (n = 0; n < 16; n++) { filename[n] = desc.read_int8(); }
   printf("         filename: '%.16s'\n", filename);
-  for (n = 0; n < 80; n++) { args[n] = read_int8(); }
+  for (n = 0; n < 80; n++) { args[n] = desc.read_int8(); }
   printf("             args: '%.80s'\n", args);
+}
+
+int Elf::read_core_mapped_files(std::vector<MappedFile> &mapped_files) const
+{
+  mapped_files.clear();
+
+  for (int count = 0; count < get_program_count(); count++)
+  {
+    Program program;
+    get_program(count, program);
+
+    if (program.p_type != PT_NOTE) { continue; }
+
+    uint64_t position = 0;
+    Note note;
 
-  pop_ptr();
+    while (read_note(program, position, note) == 0)
+    {
+      if (note.type == NT_FILE && strcmp(note.name, "CORE") == 0)
+      {
+        Cursor cursor(this, note.desc);
+        const uint64_t end = note.desc + note.descsz;
+
+        if (map_range(note.desc, note.descsz) != 0) { return -1; }
+
+        const uint64_t mapped_count = cursor.read_offset();
+        const uint64_t page_size = cursor.read_offset();
+
+        uint64_t names = cursor.offset + (mapped_count * (bitwidth / 8) * 3);
+
+        for (uint64_t n = 0; n < mapped_count && names < end; n++)
+        {
+          MappedFile mapped_file;
+
+          mapped_file.start = cursor.read_offset();
+          mapped_file.end = cursor.read_offset();
+          mapped_file.file_offset = cursor.read_offset() * page_size;
+
+          const char *filename = (const char *)buffer + names;
+          size_t length = strnlen(filename, end - names);
+
+          mapped_file.name.assign(filename, length);
+          names += length + 1;
+
+          mapped_files.push_back(mapped_file);
+        }
+
+        return mapped_files.size();
+      }
+    }
+  }
+
+  return 0;
+}
+
+int Elf::read_core_threads(std::vector<uint64_t> &registers) const
+{
+  registers.clear();
+
+  for (int count = 0; count < get_program_count(); count++)
+  {
+    Program program;
+    get_program(count, program);
+
+    if (program.p_type != PT_NOTE) { continue; }
+
+    uint64_t position = 0;
+    Note note;
+
+    while (read_note(program, position, note) == 0)
+    {
+      if (note.type == NT_PRSTATUS && strcmp(note.name, "CORE") == 0)
+      {
+        Cursor desc(this, note.desc);
+        PRStatus prstatus;
+        read_core_prstatus(desc, prstatus);
+
+        registers.push_back(desc.offset);
+      }
+    }
+  }
+
+  return registers.size();
 }
 
-void Elf::print_core_siginfo()
+void Elf::print_core_summary()
 {
-  push_ptr();
+  std::vector<MappedFile> mapped_files;
+  int threads = 0;
+
+  read_core_mapped_files(mapped_files);
+
+  uint64_t pc_offset;
+  bool has_pc =
+    get_register_index("rip", pc_offset) >= 0 ||
+    get_register_index("eip", pc_offset) >= 0;
+
+  printf("Core Summary\n");
+  printf("---------------------------------------------\n");
+
+  for (int count = 0; count < get_program_count(); count++)
+  {
+    Program program;
+    get_program(count, program);
+
+    if (program.p_type != PT_NOTE) { continue; }
+
+    uint64_t position = 0;
+    Note note;
+
+    while (read_note(program, position, note) == 0)
+    {
+      if (note.type == NT_PRSTATUS && strcmp(note.name, "CORE") == 0)
+      {
+        Cursor desc(this, note.desc);
+
+        PRStatus prstatus;
+        read_core_prstatus(desc, prstatus);
+        uint64_t regs_offset = desc.offset;
+
+        if (threads == 0)
+        {
+          printf("   signal: %d (%s)\n",
+            prstatus.cursig,
+            strsignal(prstatus.cursig));
+        }
+
+        printf("\n  Thread %d: pid=%d signal=%d\n",
+          threads, prstatus.pid, prstatus.cursig);
+
+        print_registers(desc);
+
+        if (has_pc)
+        {
+          uint64_t pc = read_reg(regs_offset + pc_offset);
+          const char *filename = "[anonymous]";
+          uint64_t file_offset = 0;
+
+          for (auto &mapped_file : mapped_files)
+          {
+            if (mapped_file.contains(pc))
+            {
+              filename = mapped_file.name.c_str();
+              file_offset = mapped_file.file_offset + (pc - mapped_file.start);
+              break;
+            }
+          }
+
+          printf("     <PC 0x%" PRIx64 " in %s offset=0x%" PRIx64 ">\n",
+            pc, filename, file_offset);
+        }
+
+        threads++;
+      }
+    }
+  }
+
+  printf("\n  threads: %d\n", threads);
+  printf("   mapped: %d files\n\n", (int)mapped_files.size());
+}
 
-  printf("        signal_number: %d\n", read_int32());
-  printf("           extra_code: %d\n", read_int32());
-  printf("                errno: %d\n", read_int32());
+void Elf::print_core_siginfo(Cursor &cursor)
+{
+  Cursor desc = cursor;
 
-  pop_ptr();
+  printf("        signal_number: %d\n", desc.read_int32());
+  printf("           extra_code: %d\n", desc.read_int32());
+  printf("                errno: %d\n", desc.read_int32());
 }
 
 void Elf::print_section_headers()
@@ -526,17 +738,32 @@ void Elf::print_section_headers()
 
   for (int count = 0; count < get_section_count(); count++)
   {
-    set_file_ptr(get_section_offset() + (get_section_size() * count));
+    const uint64_t offset =
+      get_section_offset() + (get_section_size() * count);
 
-    printf("Section Header %d (offset=0x%04" PRIx64 ")\n", count, file_ptr);
+    printf("Section Header %d (offset=0x%04" PRIx64 ")\n", count, offset);
     printf("---------------------------------------------\n");
 
     Section section;
-    read_section(section);
+    get_section(count, section);
     print_section(section);
   }
 }
 
+void Elf::get_sections(
+  std::vector<Section> &sections,
+  std::vector<std::string> &names) const
+{
+  sections.resize(get_section_count());
+  names.resize(get_section_count());
+
+  for (int count = 0; count < get_section_count(); count++)
+  {
+    get_section(count, sections[count]);
+    names[count] = get_string(sections[count].sh_name);
+  }
+}
+
 void Elf::print_section(Section &section)
 {
   std::string section_name = get_string(section.sh_name);
@@ -559,7 +786,11 @@ void Elf::print_section(Section &section)
 
 void Elf::print_symbol(Symbol &symbol, uint64_t string_table_offset)
 {
-  printf("  %s\n", buffer + string_table_offset + symbol.st_name);
+  const char *name = get_cstring(string_table_offset + symbol.st_name);
+
+  if (demangle != nullptr) { name = demangle->demangle(name); }
+
+  printf("  %s\n", name);
   printf("     name: %d\n", symbol.st_name);
   printf("     info: %d (%s) (%s)\n",
     symbol.st_info,
@@ -573,36 +804,170 @@ void Elf::print_symbol(Symbol &symbol, uint64_t string_table_offset)
   printf("     size: %" PRId64 "\n", symbol.st_size);
 }
 
+int Elf::get_section_data(Section &section, SectionData &section_data) const
+{
+  section_data = SectionData();
+
+  if (section.sh_type == SHT_NOBITS) { return 0; }
+
+  if (section.sh_offset + section.sh_size > (uint64_t)buffer_len)
+  {
+    return -1;
+  }
+
+  if ((section.sh_flags & SHF_COMPRESSED) == 0)
+  {
+    section_data.data = get_data(section.sh_offset, section.sh_size);
+    section_data.size = section.sh_size;
+
+    return section_data.data == nullptr ? -1 : 0;
+  }
+
+  // Elf32_Chdr / Elf64_Chdr in front of the compressed bytes.
+  const uint64_t offset = section.sh_offset;
+  uint64_t chdr_size;
+  uint64_t ch_size;
+
+  section_data.compression = read_int32(offset);
+
+  if (bitwidth == 32)
+  {
+    ch_size = read_int32(offset + 4);
+    chdr_size = 12;
+  }
+    else
+  {
+    ch_size = read_int64(offset + 8);
+    chdr_size = 24;
+  }
+
+  if (section.sh_size < chdr_size) { return -1; }
+
+  section_data.compressed_size = section.sh_size - chdr_size;
+
+  // ch_size comes from the file and is allocated up front, so it's
+  // capped. Deflate can't do better than about 1032:1, which also rules
+  // out most bogus sizes for zlib sections.
+  if (ch_size > max_decompressed_size) { return -1; }
+
+  if (section_data.compression == ELFCOMPRESS_ZLIB &&
+      ch_size > (section_data.compressed_size + 1) * 1032)
+  {
+    return -1;
+  }
+
+  section_data.decompressed = section_cache.get(offset);
+
+  if (!section_data.decompressed)
+  {
+    const uint8_t *data = get_data(offset + chdr_size, section_data.compressed_size);
+
+    if (data == nullptr) { return -1; }
+
+    section_data.decompressed.reset(new std::vector<uint8_t>(ch_size));
+
+    int err = decompress_section(
+      section_data.compression,
+      data,
+      section_data.compressed_size,
+      *section_data.decompressed);
+
+    if (err != 0)
+    {
+      section_data.decompressed.reset();
+      return -1;
+    }
+
+    section_cache.put(offset, section_data.decompressed);
+  }
+
+  section_data.data = section_data.decompressed->data();
+  section_data.size = section_data.decompressed->size();
+
+  return 0;
+}
+
+int Elf::decompress_section(
+  uint32_t compression,
+  const uint8_t *data,
+  uint64_t length,
+  std::vector<uint8_t> &output)
+{
+  switch (compression)
+  {
+    case ELFCOMPRESS_ZLIB:
+    {
+      uLongf output_length = output.size();
+
+      if (uncompress(output.data(), &output_length, data, length) != Z_OK ||
+          output_length != output.size())
+      {
+        return -1;
+      }
+
+      return 0;
+    }
+#ifdef ENABLE_ZSTD
+    case ELFCOMPRESS_ZSTD:
+    {
+      size_t output_length =
+        ZSTD_decompress(output.data(), output.size(), data, length);
+
+      if (ZSTD_isError(output_length) || output_length != output.size())
+      {
+        return -1;
+      }
+
+      return 0;
+    }
+#endif
+    default:
+      return -1;
+  }
+}
+
 void Elf::print_section_data(Section &section, std::string &name)
 {
   if (name == "") { return; }
 
+  SectionData section_data;
+
+  if (get_section_data(section, section_data) != 0)
+  {
+    printf("Error: Cannot read section contents (compression=%d).\n\n",
+      section_data.compression);
+    return;
+  }
+
+  if (section_data.decompressed)
+  {
+    printf("  compressed: %s %" PRId64 " -> %" PRId64 " bytes\n\n",
+      section_data.compression == ELFCOMPRESS_ZLIB ? "ZLIB" : "ZSTD",
+      section_data.compressed_size,
+      section_data.size);
+  }
+
+  uint8_t *data = (uint8_t *)section_data.data;
+  int size = section_data.size;
+
   if (name == ".comment")
   {
-    print_section_comment((char *)buffer + section.sh_offset, section.sh_size);
+    print_section_comment((char *)data, size);
   }
     else
   if (name == ".strtab" || section.sh_type == SHT_STRTAB)
   {
-    print_section_string_table(buffer + section.sh_offset, section.sh_size);
+    print_section_string_table(data, size);
   }
     else
-  if (name == ".shstrtab")
+  if (name == ".shstrtab" || name == ".debug_str" || name == ".debug_line_str")
   {
-    print_section_string_table(buffer + section.sh_offset, section.sh_size);
+    print_section_string_table(data, size);
   }
     else
-  if (name == ".rel.text")
+  if (section.sh_type == SHT_REL || section.sh_type == SHT_RELA)
   {
-    // Probably should get a size here too :(
-    int symtab_offset = find_section_offset(SHT_SYMTAB, ".symtab", NULL);
-    int strtab_offset = find_section_offset(SHT_STRTAB, ".strtab", NULL);
-
-    print_section_relocation(
-      section.sh_offset,
-      section.sh_size,
-      symtab_offset,
-      strtab_offset);
+    print_section_relocation(section);
   }
     else
   if (name == ".symtab")
@@ -628,15 +993,23 @@ void Elf::print_section_data(Section &section, std::string &name)
     else
   if (name == ".ARM.attributes" || section.sh_type == SHT_STRTAB)
   {
-    print_section_arm_attrs(buffer + section.sh_offset, section.sh_size);
+    print_section_arm_attrs(data, size);
   }
-#if 0
     else
-  if (name == ".dynamic")
+  if (name == ".dynamic" || section.sh_type == SHT_DYNAMIC)
   {
-    print_section_dynamic(section.sh_offset, section.sh_size);
+    print_section_dynamic();
+  }
+    else
+  if (section.sh_type == SHT_GNU_HASH)
+  {
+    print_section_gnu_hash(section);
+  }
+    else
+  if (section.sh_type == SHT_HASH)
+  {
+    print_section_hash(section);
   }
-#endif
 }
 
 void Elf::print_section_comment(const char *comment, int size)
@@ -687,42 +1060,447 @@ void Elf::print_section_symbol_table(
   int sh_entsize,
   int string_table_offset)
 {
-  push_ptr();
+  // The names are demangled on other threads, so the string table
+  // has to stay mapped until they're done.
+  CompressedFile::Pin pin(compressed);
 
-  set_file_ptr(offset);
-  uint64_t end = file_ptr + sh_size;
+  Cursor cursor(this, offset);
+  uint64_t end = cursor.offset + sh_size;
   Symbol symbol;
 
-  while (file_ptr < end)
+  if (demangle != nullptr)
   {
-    read_symbol(symbol);
-    print_symbol(symbol, string_table_offset);
+    // Demangle the whole table up front (in parallel) so printing
+    // each symbol is just a memo lookup.
+    std::vector<const char *> names;
+
+    while (cursor.offset < end)
+    {
+      read_symbol(cursor, symbol);
+      names.push_back(get_cstring(string_table_offset + symbol.st_name));
+    }
+
+    demangle->demangle_batch(names);
+
+    cursor.offset = offset;
   }
 
-  pop_ptr();
+  while (cursor.offset < end)
+  {
+    read_symbol(cursor, symbol);
+    print_symbol(symbol, string_table_offset);
+  }
 }
 
-void Elf::print_section_arm_attrs(uint8_t *attrs, int sh_size)
+int Elf::read_symbols(Section &section, Symbols &symbols) const
 {
-  char text[17];
-  int ptr;
+  CompressedFile::Pin pin(compressed);
 
-  ptr = 0;
+  const uint64_t entsize =
+    section.sh_entsize != 0 ? section.sh_entsize : (bitwidth == 32 ? 16 : 24);
 
-  for (int n = 0; n < sh_size; n++)
+  symbols.clear();
+
+  if (section.sh_offset + section.sh_size > (uint64_t)buffer_len)
   {
-    if ((n % 16) == 0)
+    return -1;
+  }
+
+  Section strtab;
+  strtab.sh_offset = 0;
+  strtab.sh_size = 0;
+
+  if (section.sh_link < (uint32_t)get_section_count())
+  {
+    get_section(section.sh_link, strtab);
+  }
+
+  if (strtab.sh_offset + strtab.sh_size <= (uint64_t)buffer_len)
+  {
+    if (compressed != nullptr)
     {
-      if (ptr != 0) { text[ptr] = 0; printf("  %s", text); ptr = 0; }
-      printf("\n");
+      symbols.strtab_copy = std::make_shared<std::vector<char>>(strtab.sh_size + 1);
+
+      char *copy = symbols.strtab_copy->data();
+
+      if (read_data(strtab.sh_offset, strtab.sh_size, (uint8_t *)copy) != 0)
+      {
+        return -1;
+      }
+
+      symbols.strtab = copy;
+    }
+      else
+    {
+      symbols.strtab = (const char *)get_data(strtab.sh_offset, strtab.sh_size);
     }
 
-    printf(" %02x", attrs[n]);
-    text[ptr++] = attrs[n] >= 48 && attrs[n] < 120 ?  attrs[n] : '.';
+    symbols.strtab_length = strtab.sh_size;
   }
 
-  text[ptr] = 0;
-  printf("  %s\n\n", text);
+  const uint64_t count = section.sh_size / entsize;
+  const uint8_t *data = get_data(section.sh_offset, count * entsize);
+
+  if (data == nullptr) { return -1; }
+
+  symbols.resize(count);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // Common case: Elf64_Sym entries can be loaded straight out of the
+  // mapping.
+  if (bitwidth == 64 && is_little_endian)
+  {
+    for (uint64_t n = 0; n < count; n++)
+    {
+      const uint8_t *entry = data + (n * entsize);
+
+      memcpy(&symbols.st_name[n], entry, 4);
+      symbols.st_info[n] = entry[4];
+      memcpy(&symbols.st_shndx[n], entry + 6, 2);
+      memcpy(&symbols.st_value[n], entry + 8, 8);
+      memcpy(&symbols.st_size[n], entry + 16, 8);
+    }
+
+    return 0;
+  }
+#else
+  (void)data;
+#endif
+
+  for (uint64_t n = 0; n < count; n++)
+  {
+    Symbol symbol;
+
+    get_symbol(section.sh_offset + (n * entsize), symbol);
+
+    symbols.st_name[n] = symbol.st_name;
+    symbols.st_info[n] = symbol.st_info;
+    symbols.st_shndx[n] = symbol.st_shndx;
+    symbols.st_value[n] = symbol.st_value;
+    symbols.st_size[n] = symbol.st_size;
+  }
+
+  return 0;
+}
+
+int Elf::find_symbol_table(Section &section) const
+{
+  int dynsym = -1;
+
+  for (int n = 0; n < get_section_count(); n++)
+  {
+    get_section(n, section);
+
+    if (section.sh_type == SHT_SYMTAB) { return n; }
+    if (section.sh_type == SHT_DYNSYM && dynsym == -1) { dynsym = n; }
+  }
+
+  if (dynsym != -1) { get_section(dynsym, section); }
+
+  return dynsym;
+}
+
+int Elf::read_relocations(Section &section, Relocations &relocations) const
+{
+  CompressedFile::Pin pin(compressed);
+
+  const int word = bitwidth / 8;
+
+  relocations.clear();
+  relocations.is_rela = section.sh_type == SHT_RELA;
+
+  uint64_t entsize = word * (relocations.is_rela ? 3 : 2);
+
+  if (section.sh_entsize > entsize) { entsize = section.sh_entsize; }
+
+  if (section.sh_offset + section.sh_size > (uint64_t)buffer_len)
+  {
+    return -1;
+  }
+
+  const uint64_t count = section.sh_size / entsize;
+  const uint8_t *data = get_data(section.sh_offset, count * entsize);
+
+  if (data == nullptr) { return -1; }
+
+  relocations.r_offset.resize(count);
+  relocations.r_sym.resize(count);
+  relocations.r_type.resize(count);
+  if (relocations.is_rela) { relocations.r_addend.resize(count); }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // Common case: entries can be loaded straight out of the mapping.
+  if (bitwidth == 64 && is_little_endian)
+  {
+    for (uint64_t n = 0; n < count; n++)
+    {
+      const uint8_t *entry = data + (n * entsize);
+      uint64_t info;
+
+      memcpy(&relocations.r_offset[n], entry, 8);
+      memcpy(&info, entry + 8, 8);
+
+      relocations.r_sym[n] = info >> 32;
+      relocations.r_type[n] = info & 0xffffffff;
+    }
+
+    if (relocations.is_rela)
+    {
+      for (uint64_t n = 0; n < count; n++)
+      {
+        memcpy(&relocations.r_addend[n], data + (n * entsize) + 16, 8);
+      }
+    }
+
+    return 0;
+  }
+#endif
+
+  for (uint64_t n = 0; n < count; n++)
+  {
+    const uint64_t offset = section.sh_offset + (n * entsize);
+    const uint64_t info = get_addr(offset + word);
+
+    relocations.r_offset[n] = get_addr(offset);
+
+    if (bitwidth == 32)
+    {
+      relocations.r_sym[n] = info >> 8;
+      relocations.r_type[n] = info & 0xff;
+
+      if (relocations.is_rela)
+      {
+        relocations.r_addend[n] = (int32_t)read_int32(offset + 8);
+      }
+    }
+      else
+    {
+      relocations.r_sym[n] = info >> 32;
+      relocations.r_type[n] = info & 0xffffffff;
+
+      if (relocations.is_rela)
+      {
+        relocations.r_addend[n] = (int64_t)read_int64(offset + 16);
+      }
+    }
+  }
+
+  return 0;
+}
+
+int Elf::read_dynamic_relocations(Relocations &relocations, bool plt) const
+{
+  uint64_t address;
+  uint64_t size = 0;
+  uint64_t value;
+  Section section;
+
+  relocations.clear();
+
+  // Fake up a section from DT_RELA / DT_REL or DT_JMPREL so this works
+  // without section headers.
+  section.sh_name = 0;
+  section.sh_flags = 0;
+  section.sh_addr = 0;
+  section.sh_link = 0;
+  section.sh_info = 0;
+  section.sh_addralign = 0;
+  section.sh_entsize = 0;
+
+  if (plt)
+  {
+    if (!get_dynamic(DT_JMPREL, address)) { return -1; }
+    get_dynamic(DT_PLTRELSZ, size);
+    section.sh_type =
+      get_dynamic(DT_PLTREL, value) && value == DT_REL ? SHT_REL : SHT_RELA;
+  }
+    else
+  if (get_dynamic(DT_RELA, address))
+  {
+    get_dynamic(DT_RELASZ, size);
+    get_dynamic(DT_RELAENT, section.sh_entsize);
+    section.sh_type = SHT_RELA;
+  }
+    else
+  if (get_dynamic(DT_REL, address))
+  {
+    get_dynamic(DT_RELSZ, size);
+    get_dynamic(DT_RELENT, section.sh_entsize);
+    section.sh_type = SHT_REL;
+  }
+    else
+  {
+    return -1;
+  }
+
+  section.sh_offset = program_address_to_offset(address);
+  section.sh_size = size;
+
+  if (section.sh_offset == 0) { return -1; }
+
+  return read_relocations(section, relocations);
+}
+
+uint64_t Elf::get_relr_count() const
+{
+  uint64_t address;
+  uint64_t size;
+  uint64_t count = 0;
+
+  if (!get_dynamic(DT_RELR, address) || !get_dynamic(DT_RELRSZ, size))
+  {
+    return 0;
+  }
+
+  const uint64_t offset = program_address_to_offset(address);
+  const int word = bitwidth / 8;
+
+  if (offset == 0 || offset + size > (uint64_t)buffer_len) { return 0; }
+
+  // Even entries are an address, odd entries a bitmap of the words
+  // that follow (bit 0 is the marker).
+  for (uint64_t n = 0; n + word <= size; n += word)
+  {
+    const uint64_t entry = get_addr(offset + n);
+
+    if ((entry & 1) == 0)
+    {
+      count++;
+    }
+      else
+    {
+      count += __builtin_popcountll(entry >> 1);
+    }
+  }
+
+  return count;
+}
+
+bool Elf::is_bind_now() const
+{
+  uint64_t value;
+
+  if (get_dynamic(DT_BIND_NOW, value)) { return true; }
+  if (get_dynamic(DT_FLAGS, value) && (value & DF_BIND_NOW) != 0)
+  {
+    return true;
+  }
+  if (get_dynamic(DT_FLAGS_1, value) && (value & DF_1_NOW) != 0)
+  {
+    return true;
+  }
+
+  return false;
+}
+
+void Elf::print_section_relocation(Section &section)
+{
+  Relocations relocations;
+  std::map<uint32_t, uint64_t> counts;
+
+  if (read_relocations(section, relocations) != 0)
+  {
+    printf("Error: Relocation section outside of file.\n\n");
+    return;
+  }
+
+  // sh_link is the symbol table, its sh_link the string table.
+  Section symtab;
+  Section strtab;
+  bool has_symtab = section.sh_link != 0 &&
+    (int)section.sh_link < get_section_count();
+
+  if (has_symtab)
+  {
+    get_section(section.sh_link, symtab);
+    get_section(symtab.sh_link, strtab);
+
+    if (symtab.sh_entsize == 0) { has_symtab = false; }
+  }
+
+  printf("%-18s %-16s %8s %-18s Symbol\n", "Offset", "Type", "Sym", "Addend");
+
+  for (uint64_t n = 0; n < relocations.size(); n++)
+  {
+    const uint32_t sym = relocations.r_sym[n];
+    const uint32_t type = relocations.r_type[n];
+    const char *name = "";
+
+    if (sym != 0 && has_symtab && sym * symtab.sh_entsize < symtab.sh_size)
+    {
+      uint32_t st_name = read_int32(symtab.sh_offset + (sym * symtab.sh_entsize));
+      name = get_cstring(strtab.sh_offset + st_name);
+    }
+
+    const char *type_name = Relocations::get_type_name(header.e_machine, type);
+
+    printf("0x%016" PRIx64 " ", relocations.r_offset[n]);
+
+    if (type_name[0] == 0)
+    {
+      printf("%-16d ", type);
+    }
+      else
+    {
+      printf("%-16s ", type_name);
+    }
+
+    printf("%8d ", sym);
+
+    char addend[32] = { 0 };
+
+    if (relocations.is_rela)
+    {
+      const int64_t value = relocations.r_addend[n];
+
+      snprintf(addend, sizeof(addend), "%s0x%" PRIx64,
+        value < 0 ? "-" : "",
+        value < 0 ? -(uint64_t)value : (uint64_t)value);
+    }
+
+    printf("%-18s ", addend);
+
+    printf("%s\n", name);
+
+    counts[type]++;
+  }
+
+  printf("\n  Relocation counts (total=%" PRId64 ")\n", relocations.size());
+
+  for (auto &count : counts)
+  {
+    const char *type_name =
+      Relocations::get_type_name(header.e_machine, count.first);
+
+    printf("    %-16s %" PRId64 "\n",
+      type_name[0] == 0 ? "?" : type_name,
+      count.second);
+  }
+
+  printf("\n");
+}
+
+void Elf::print_section_arm_attrs(uint8_t *attrs, int sh_size)
+{
+  char text[17];
+  int ptr;
+
+  ptr = 0;
+
+  for (int n = 0; n < sh_size; n++)
+  {
+    if ((n % 16) == 0)
+    {
+      if (ptr != 0) { text[ptr] = 0; printf("  %s", text); ptr = 0; }
+      printf("\n");
+    }
+
+    printf(" %02x", attrs[n]);
+    text[ptr++] = attrs[n] >= 48 && attrs[n] < 120 ?  attrs[n] : '.';
+  }
+
+  text[ptr] = 0;
+  printf("  %s\n\n", text);
 
   printf("   Version: %c\n", attrs[0]);
   printf("      Size: %d\n", attrs[1] | (attrs[2] << 8) | (attrs[3] << 16) | (attrs[4] << 24));
@@ -730,19 +1508,255 @@ void Elf::print_section_arm_attrs(uint8_t *attrs, int sh_size)
   printf("\n");
 }
 
+void Elf::print_section_dynamic()
+{
+  for (auto &dynamic : dynamic_entries)
+  {
+    printf("  %-16s 0x%" PRIx64, dynamic.get_tag_type(), dynamic.d_val);
+
+    if (dynamic.is_string())
+    {
+      printf(" %s", get_dynamic_string(dynamic.d_val));
+    }
+
+    printf("\n");
+  }
+
+  printf("\n");
+}
+
+void Elf::print_section_gnu_hash(Section &section)
+{
+  GnuHash table;
+  Section dynsym;
+  Section dynstr;
+
+  if (read_gnu_hash(section.sh_offset, table) != 0)
+  {
+    printf("Error: Cannot read GNU hash table.\n\n");
+    return;
+  }
+
+  get_section(section.sh_link, dynsym);
+  get_section(dynsym.sh_link, dynstr);
+
+  const uint32_t entsize = dynsym.sh_entsize != 0 ? dynsym.sh_entsize :
+    (bitwidth == 32 ? 16 : 24);
+  const uint32_t symbols = dynsym.sh_size / entsize;
+  const uint32_t c = bitwidth;
+
+  printf("  buckets: %u  symoffset: %u  bloom: %u words  shift: %u"
+         "  symbols: %u\n\n",
+    table.nbuckets,
+    table.symoffset,
+    table.bloom_size,
+    table.bloom_shift,
+    symbols > table.symoffset ? symbols - table.symoffset : 0);
+
+  // Walk each bucket's chain to get its length. A chain ends at the
+  // first hash value with the low bit set.
+  std::vector<uint32_t> lengths(table.nbuckets);
+  uint64_t collisions = 0;
+
+  for (uint32_t b = 0; b < table.nbuckets; b++)
+  {
+    uint32_t index = read_int32(table.buckets_offset + (uint64_t)b * 4);
+
+    if (index < table.symoffset) { continue; }
+
+    std::vector<uint32_t> hashes;
+
+    while (index < symbols)
+    {
+      const uint32_t h2 = read_int32(
+        table.chain_offset + (uint64_t)(index - table.symoffset) * 4);
+
+      // Two names with the same hash in one chain both get strcmp()'d.
+      for (uint32_t h : hashes)
+      {
+        if ((h | 1) == (h2 | 1)) { collisions++; break; }
+      }
+
+      hashes.push_back(h2);
+
+      if ((h2 & 1) != 0) { break; }
+
+      index++;
+    }
+
+    lengths[b] = hashes.size();
+  }
+
+  print_chain_histogram(lengths);
+
+  printf("  full hash collisions: %" PRIu64 "\n", collisions);
+
+  // Every defined name has to get through the bloom filter. Names this
+  // module only imports (symbols before symoffset) are names it will
+  // never find, so the ones that get through are false positives.
+  uint64_t bits_set = 0;
+
+  for (uint32_t n = 0; n < table.bloom_size; n++)
+  {
+    bits_set +=
+      __builtin_popcountll(get_addr(table.bloom_offset + (uint64_t)n * (c / 8)));
+  }
+
+  uint64_t missing = 0;
+  uint64_t tested = 0;
+  uint64_t passed = 0;
+
+  for (uint32_t n = 1; n < symbols; n++)
+  {
+    Symbol symbol;
+
+    get_symbol(dynsym.sh_offset + (uint64_t)n * entsize, symbol);
+
+    if (symbol.st_name >= dynstr.sh_size) { continue; }
+
+    const uint32_t h1 = GnuHash::hash(get_cstring(dynstr.sh_offset + symbol.st_name));
+    const uint64_t word = get_addr(
+      table.bloom_offset + ((h1 / c) % table.bloom_size) * (c / 8));
+    const uint64_t mask =
+      (1ULL << (h1 % c)) | (1ULL << ((h1 >> table.bloom_shift) % c));
+    const bool pass = (word & mask) == mask;
+
+    if (n >= table.symoffset)
+    {
+      if (!pass) { missing++; }
+    }
+      else
+    if (symbol.st_shndx == 0)
+    {
+      tested++;
+      if (pass) { passed++; }
+    }
+  }
+
+  const double fill = (double)bits_set / ((double)table.bloom_size * c);
+
+  printf("  bloom bits set: %" PRIu64 " of %" PRIu64 " (%.1f%%)\n",
+    bits_set,
+    (uint64_t)table.bloom_size * c,
+    fill * 100);
+  printf("  bloom false positive rate: %.1f%% estimated",
+    fill * fill * 100);
+
+  if (tested != 0)
+  {
+    printf(", %.1f%% measured (%" PRIu64 " of %" PRIu64 " imported names)",
+      (double)passed * 100 / tested, passed, tested);
+  }
+
+  printf("\n");
+
+  if (missing != 0)
+  {
+    printf("  Warning: %" PRIu64 " defined names fail the bloom filter\n",
+      missing);
+  }
+
+  printf("\n");
+}
+
+void Elf::print_section_hash(Section &section)
+{
+  if (section.sh_size < 8) { return; }
+
+  const uint32_t nbucket = read_int32(section.sh_offset);
+  const uint32_t nchain = read_int32(section.sh_offset + 4);
+  const uint64_t buckets = section.sh_offset + 8;
+  const uint64_t chains = buckets + (uint64_t)nbucket * 4;
+
+  printf("  buckets: %u  chains: %u\n\n", nbucket, nchain);
+
+  if (chains + (uint64_t)nchain * 4 > (uint64_t)buffer_len) { return; }
+
+  std::vector<uint32_t> lengths(nbucket);
+
+  for (uint32_t b = 0; b < nbucket; b++)
+  {
+    uint32_t index = read_int32(buckets + (uint64_t)b * 4);
+
+    // Bounded by nchain in case the table has a loop in it.
+    while (index != 0 && index < nchain && lengths[b] < nchain)
+    {
+      lengths[b]++;
+      index = read_int32(chains + (uint64_t)index * 4);
+    }
+  }
+
+  print_chain_histogram(lengths);
+
+  printf("\n");
+}
+
+void Elf::print_chain_histogram(std::vector<uint32_t> &lengths)
+{
+  const int max_length = 10;
+  uint64_t histogram[max_length + 1] = { 0 };
+  uint64_t symbols = 0;
+  uint64_t probes = 0;
+  uint32_t longest = 0;
+
+  if (lengths.size() == 0) { return; }
+
+  for (uint32_t length : lengths)
+  {
+    histogram[length < max_length ? length : max_length]++;
+    symbols += length;
+    // Finding the k'th entry in a chain takes k probes.
+    probes += (uint64_t)length * (length + 1) / 2;
+    if (length > longest) { longest = length; }
+  }
+
+  printf("  chain length histogram:\n");
+
+  for (int n = 0; n <= max_length; n++)
+  {
+    if (histogram[n] == 0) { continue; }
+
+    printf("    %2d%s %8" PRIu64 " (%5.1f%%)\n",
+      n,
+      n == max_length ? "+" : " ",
+      histogram[n],
+      (double)histogram[n] * 100 / lengths.size());
+  }
+
+  printf("\n");
+  printf("  buckets used: %" PRIu64 " of %d (%.1f%%)  longest chain: %u\n",
+    lengths.size() - histogram[0],
+    (int)lengths.size(),
+    (double)(lengths.size() - histogram[0]) * 100 / lengths.size(),
+    longest);
+
+  if (symbols != 0)
+  {
+    printf("  expected probes: %.2f per hit, %.2f per miss\n",
+      (double)probes / symbols,
+      (double)symbols / lengths.size());
+  }
+
+  // More symbols than buckets but most buckets empty means the names
+  // hash badly (or the table was generated wrong).
+  if (symbols >= lengths.size() && histogram[0] > lengths.size() / 2)
+  {
+    printf("  Warning: %" PRIu64 " symbols use only %" PRIu64 " buckets\n",
+      symbols, lengths.size() - histogram[0]);
+  }
+}
+
 uint64_t Elf::find_section_offset(
   uint32_t type,
   const char *section_name,
-  uint64_t *len)
+  uint64_t *len) const
 {
   if (len != nullptr) { *len = 0; }
 
   for (int count = 0; count < get_section_count(); count++)
   {
-    set_file_ptr(get_section_offset() + (get_section_size() * count));
-
     Section section;
-    read_section(section);
+    get_section(count, section);
 
     if (section.sh_type == type)
     {
@@ -750,7 +1764,7 @@ uint64_t Elf::find_section_offset(
 
       if (section.sh_name != 0)
       {
-        name = (char *)buffer + get_string_table_offset() + section.sh_name;
+        name = get_cstring(get_string_table_offset() + section.sh_name);
       }
 
       if (section_name == NULL || strcmp(section_name, name) == 0)
@@ -764,42 +1778,46 @@ uint64_t Elf::find_section_offset(
   return 0;
 }
 
-uint64_t Elf::find_symbol_offset(const char *name)
+uint64_t Elf::find_symbol_offset(const char *name) const
 {
-  set_file_ptr(get_symbol_table_offset());
-  uint64_t end = file_ptr + get_symbol_table_length();
+  CompressedFile::Pin pin(compressed);
+
+  Cursor cursor(this, get_symbol_table_offset());
+  uint64_t end = cursor.offset + get_symbol_table_length();
   Symbol symbol;
 
-  while (file_ptr < end)
+  while (cursor.offset < end)
   {
-    read_symbol(symbol);
-    char *symbol_name = (char *)buffer + str_sym_tbl_offset +  symbol.st_name;
+    read_symbol(cursor, symbol);
+    const char *symbol_name = get_cstring(str_sym_tbl_offset + symbol.st_name);
 
     if (strcmp(symbol_name, name) == 0)
     {
-      const int section_index = symbol.st_shndx;
-      set_file_ptr(get_section_offset() + (get_section_size() * section_index));
       Section section;
-      read_section(section);
+      get_section(symbol.st_shndx, section);
 
       return section.sh_offset + (symbol.st_value - section.sh_addr);
     }
   }
 
+  // Stripped binaries still have the dynamic symbols.
+  if (find_dynamic_symbol(name, symbol) >= 0)
+  {
+    return program_address_to_offset(symbol.st_value);
+  }
+
   return 0;
 }
 
-uint64_t Elf::address_to_offset(uint64_t address)
+uint64_t Elf::address_to_offset(uint64_t address) const
 {
   // Search through sections for an address and compute the offset into
   // the file.
 
   for (int count = 0; count < get_section_count(); count++)
   {
-    set_file_ptr(get_section_offset() + (get_section_size() * count));
-
     Section section;
-    read_section(section);
+    get_section(count, section);
 
     const uint64_t start = section.sh_addr;
     const uint64_t end = section.sh_addr + section.sh_size;
@@ -813,16 +1831,285 @@ uint64_t Elf::address_to_offset(uint64_t address)
   return 0;
 }
 
+uint64_t Elf::program_address_to_offset(uint64_t address) const
+{
+  for (int count = 0; count < get_program_count(); count++)
+  {
+    Program program;
+    get_program(count, program);
+
+    if (program.p_type != PT_LOAD) { continue; }
+
+    if (address >= program.p_vaddr &&
+        address < program.p_vaddr + program.p_filesz)
+    {
+      return program.p_offset + (address - program.p_vaddr);
+    }
+  }
+
+  return 0;
+}
+
+int Elf::read_dynamic()
+{
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  dynamic_entries.clear();
+  dynamic_index.clear();
+
+  for (int count = 0; count < get_program_count(); count++)
+  {
+    Program program;
+    get_program(count, program);
+
+    if (program.p_type == PT_DYNAMIC)
+    {
+      offset = program.p_offset;
+      length = program.p_filesz;
+      break;
+    }
+  }
+
+  if (offset == 0)
+  {
+    offset = find_section_offset(SHT_DYNAMIC, NULL, &length);
+  }
+
+  if (offset == 0 || offset + length > (uint64_t)buffer_len) { return -1; }
+
+  const int entry_size = bitwidth / 4;
+
+  for (uint64_t n = 0; n + entry_size <= length; n += entry_size)
+  {
+    Dynamic dynamic;
+
+    if (bitwidth == 32)
+    {
+      dynamic.d_tag = (int32_t)read_int32(offset + n);
+    }
+      else
+    {
+      dynamic.d_tag = (int64_t)read_int64(offset + n);
+    }
+
+    dynamic.d_val = get_addr(offset + n + (entry_size / 2));
+
+    if (dynamic.d_tag == DT_NULL) { break; }
+
+    if (dynamic_index.find(dynamic.d_tag) == dynamic_index.end())
+    {
+      dynamic_index[dynamic.d_tag] = dynamic_entries.size();
+    }
+
+    dynamic_entries.push_back(dynamic);
+  }
+
+  uint64_t value;
+
+  if (get_dynamic(DT_STRTAB, value))
+  {
+    dynstr_offset = program_address_to_offset(value);
+  }
+
+  if (get_dynamic(DT_STRSZ, value)) { dynstr_length = value; }
+
+  if (get_dynamic(DT_SYMTAB, value))
+  {
+    dynsym_offset = program_address_to_offset(value);
+    dynsym_entsize = bitwidth == 32 ? 16 : 24;
+  }
+
+  if (get_dynamic(DT_SYMENT, value)) { dynsym_entsize = value; }
+
+  if (get_dynamic(DT_GNU_HASH, value))
+  {
+    read_gnu_hash(program_address_to_offset(value), gnu_hash);
+  }
+
+  if (get_dynamic(DT_HASH, value))
+  {
+    hash_offset = program_address_to_offset(value);
+  }
+
+  return 0;
+}
+
+bool Elf::get_dynamic(int64_t tag, uint64_t &value) const
+{
+  auto iter = dynamic_index.find(tag);
+
+  if (iter == dynamic_index.end()) { return false; }
+
+  value = dynamic_entries[iter->second].d_val;
+
+  return true;
+}
+
+const char *Elf::get_dynamic_string(uint64_t offset) const
+{
+  if (dynstr_offset == 0 || offset >= dynstr_length) { return ""; }
+
+  return get_cstring(dynstr_offset + offset);
+}
+
+int Elf::read_gnu_hash(uint64_t offset, GnuHash &gnu_hash) const
+{
+  gnu_hash = GnuHash();
+
+  if (offset == 0 || offset + 16 > (uint64_t)buffer_len) { return -1; }
+
+  GnuHash table;
+
+  table.offset       = offset;
+  table.nbuckets     = read_int32(offset);
+  table.symoffset    = read_int32(offset + 4);
+  table.bloom_size   = read_int32(offset + 8);
+  table.bloom_shift  = read_int32(offset + 12);
+  table.bloom_offset = offset + 16;
+
+  table.buckets_offset =
+    table.bloom_offset + ((uint64_t)table.bloom_size * (bitwidth / 8));
+  table.chain_offset =
+    table.buckets_offset + ((uint64_t)table.nbuckets * 4);
+
+  if (table.nbuckets == 0 || table.bloom_size == 0 ||
+      table.chain_offset > (uint64_t)buffer_len)
+  {
+    return -1;
+  }
+
+  gnu_hash = table;
+
+  return 0;
+}
+
+int Elf::find_dynamic_symbol(const char *name, uint32_t h1, Symbol &symbol) const
+{
+  CompressedFile::Pin pin(compressed);
+
+  if (dynsym_offset == 0 || dynstr_offset == 0) { return -1; }
+
+  if (gnu_hash.offset != 0)
+  {
+    const uint32_t c = bitwidth;
+
+    // The bloom filter rejects most names that aren't defined here
+    // without touching the buckets.
+    uint64_t word = get_addr(
+      gnu_hash.bloom_offset + ((h1 / c) % gnu_hash.bloom_size) * (c / 8));
+    uint64_t mask =
+      (1ULL << (h1 % c)) | (1ULL << ((h1 >> gnu_hash.bloom_shift) % c));
+
+    if ((word & mask) != mask) { return -1; }
+
+    uint32_t index =
+      read_int32(gnu_hash.buckets_offset + (h1 % gnu_hash.nbuckets) * 4);
+
+    if (index < gnu_hash.symoffset) { return -1; }
+
+    while (true)
+    {
+      uint64_t chain =
+        gnu_hash.chain_offset + ((uint64_t)(index - gnu_hash.symoffset) * 4);
+
+      if (chain + 4 > (uint64_t)buffer_len) { return -1; }
+
+      uint32_t h2 = read_int32(chain);
+
+      if ((h1 | 1) == (h2 | 1))
+      {
+        get_symbol(dynsym_offset + (index * dynsym_entsize), symbol);
+
+        if (strcmp(get_dynamic_string(symbol.st_name), name) == 0)
+        {
+          return index;
+        }
+      }
+
+      if ((h2 & 1) != 0) { return -1; }
+
+      index++;
+    }
+  }
+
+  if (hash_offset != 0)
+  {
+    const uint32_t nbucket = read_int32(hash_offset);
+    const uint32_t nchain = read_int32(hash_offset + 4);
+    const uint64_t buckets = hash_offset + 8;
+    const uint64_t chains = buckets + ((uint64_t)nbucket * 4);
+
+    if (nbucket == 0) { return -1; }
+
+    uint32_t index = read_int32(buckets + (GnuHash::sysv_hash(name) % nbucket) * 4);
+
+    for (uint32_t n = 0; index != 0 && n < nchain; n++)
+    {
+      get_symbol(dynsym_offset + (index * dynsym_entsize), symbol);
+
+      if (symbol.st_shndx != 0 &&
+          strcmp(get_dynamic_string(symbol.st_name), name) == 0)
+      {
+        return index;
+      }
+
+      index = read_int32(chains + ((uint64_t)index * 4));
+    }
+  }
+
+  return -1;
+}
+
+uint64_t Elf::get_dynamic_symbol_count() const
+{
+  // There's no count in the dynamic section. DT_HASH has one chain
+  // entry per symbol. With only DT_GNU_HASH, the last symbol is the end
+  // of the chain that starts at the highest bucket.
+  if (hash_offset != 0) { return read_int32(hash_offset + 4); }
+
+  if (gnu_hash.offset == 0) { return 0; }
+
+  uint32_t last = 0;
+
+  for (uint32_t b = 0; b < gnu_hash.nbuckets; b++)
+  {
+    const uint32_t index = read_int32(gnu_hash.buckets_offset + (uint64_t)b * 4);
+
+    if (index > last) { last = index; }
+  }
+
+  if (last < gnu_hash.symoffset) { return gnu_hash.symoffset; }
+
+  while (true)
+  {
+    const uint64_t chain =
+      gnu_hash.chain_offset + ((uint64_t)(last - gnu_hash.symoffset) * 4);
+
+    if (chain + 4 > (uint64_t)buffer_len) { break; }
+    if ((read_int32(chain) & 1) != 0) { break; }
+
+    last++;
+  }
+
+  return last + 1;
+}
+
+void Elf::get_symbol(uint64_t offset, Symbol &symbol) const
+{
+  Cursor cursor(this, offset);
+  read_symbol(cursor, symbol);
+}
+
 int Elf::get_program_header(
   Program &program,
   uint64_t &offset,
-  uint64_t address)
+  uint64_t address) const
 {
   for (uint32_t count = 0; count < header.e_phnum; count++)
   {
-    set_file_ptr(header.e_phoff + (header.e_phentsize * count));
-    offset = file_ptr;
-    read_program(program);
+    offset = header.e_phoff + (header.e_phentsize * count);
+    get_program(count, program);
 
     const uint64_t low = program.p_vaddr;
     const uint64_t high = program.p_vaddr + program.p_memsz;
@@ -833,39 +2120,80 @@ int Elf::get_program_header(
   return -1;
 }
 
-uint16_t Elf::read_int16(uint64_t offset)
+void Elf::get_program(int index, Program &program) const
+{
+  Cursor cursor(this, header.e_phoff + (header.e_phentsize * index));
+  read_program(cursor, program);
+}
+
+void Elf::get_section(int index, Section &section) const
+{
+  Cursor cursor(this, header.e_shoff + (header.e_shentsize * index));
+  read_section(cursor, section);
+}
+
+int Elf::read_data(uint64_t offset, uint64_t length, uint8_t *data) const
+{
+  if (offset > (uint64_t)buffer_len || length > buffer_len - offset)
+  {
+    return -1;
+  }
+
+  if (compressed != nullptr) { return compressed->read(offset, length, data); }
+
+  memcpy(data, buffer + offset, length);
+
+  return 0;
+}
+
+uint16_t Elf::read_int16(uint64_t offset) const
 {
+  uint8_t copy[2];
+  const uint8_t *data = get_scalar(offset, sizeof(copy), copy);
+
+  if (data == nullptr) { return 0; }
+
   if (is_little_endian)
   {
-    return GET_LITTLE_ENDIAN16(buffer, offset);
+    return GET_LITTLE_ENDIAN16(data, 0);
   }
     else
   {
-    return GET_BIG_ENDIAN16(buffer, offset);
+    return GET_BIG_ENDIAN16(data, 0);
   }
 }
 
-uint32_t Elf::read_int32(uint64_t offset)
+uint32_t Elf::read_int32(uint64_t offset) const
 {
+  uint8_t copy[4];
+  const uint8_t *data = get_scalar(offset, sizeof(copy), copy);
+
+  if (data == nullptr) { return 0; }
+
   if (is_little_endian)
   {
-    return GET_LITTLE_ENDIAN32(buffer, offset);
+    return GET_LITTLE_ENDIAN32(data, 0);
   }
     else
   {
-    return GET_BIG_ENDIAN32(buffer, offset);
+    return GET_BIG_ENDIAN32(data, 0);
   }
 }
 
-uint64_t Elf::read_int64(uint64_t offset)
+uint64_t Elf::read_int64(uint64_t offset) const
 {
+  uint8_t copy[8];
+  const uint8_t *data = get_scalar(offset, sizeof(copy), copy);
+
+  if (data == nullptr) { return 0; }
+
   if (is_little_endian)
   {
-    return GET_LITTLE_ENDIAN64(buffer, offset);
+    return GET_LITTLE_ENDIAN64(data, 0);
   }
     else
   {
-    return GET_BIG_ENDIAN64(buffer, offset);
+    return GET_BIG_ENDIAN64(data, 0);
   }
 }
 
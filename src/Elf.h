@@ -16,14 +16,36 @@
 #ifdef _WIN32
 #include <windows.h>
 #endif
+#include <map>
+#include <string>
 #include <vector>
 
+#include "CompressedFile.h"
+#include "Demangle.h"
+#include "Dynamic.h"
+#include "GnuHash.h"
 #include "Header.h"
+#include "MappedFile.h"
+#include "Note.h"
 #include "Program.h"
 #include "PRStatus.h"
+#include "Relocations.h"
+#include "Symbols.h"
 #include "Section.h"
+#include "SectionCache.h"
+#include "SectionData.h"
 #include "Symbol.h"
 
+class Cursor;
+
+// Nothing here keeps a read position: decoding goes through a Cursor the
+// caller owns and the query methods are const, so one Elf can be used
+// by several threads at once. For a compressed file that holds for
+// scalar reads (copied out under the CompressedFile lock) and for the
+// methods that decode tables (they pin what they walk), but a pointer
+// from get_data(), get_cstring() or get_section_data() is only safe
+// while the calling thread holds a CompressedFile::Pin; otherwise use
+// read_data(). Printing and modifying aren't thread safe.
 class Elf
 {
 public:
@@ -31,42 +53,57 @@ public:
   virtual ~Elf();
 
   static Elf *open_elf(const char *filename, bool writable = false);
-  static Elf *open_elf_from_mem(void *mem_ptr);
+  static Elf *open_elf_from_mem(void *mem_ptr, long length);
 
   int read_file(const char *filename, bool writable = false);
 
   int read_header();
   virtual void compute_string_table_offset() = 0;
 
-  virtual int read_program(Program &program) = 0;
-  virtual int read_section(Section &section) = 0;
-  virtual int read_symbol(Symbol &symbol) = 0;
+  virtual int read_program(Cursor &cursor, Program &program) const = 0;
+  virtual int read_section(Cursor &cursor, Section &section) const = 0;
+  virtual int read_symbol(Cursor &cursor, Symbol &symbol) const = 0;
 
   virtual void print_program(Program &program) = 0;
   virtual void print_section(Section &section);
   virtual void print_symbol(Symbol &symbol, uint64_t string_table_offset);
 
   void print_program_note(Program &program);
-  void read_note_name(char *name, int length, int namesz, int namesz_align);
-  uint64_t get_core_registers_from_note(Program &program, uint32_t pid);
+  int read_note(const Program &program, uint64_t &position, Note &note) const;
+
+  void read_note_name(
+    Cursor &cursor,
+    char *name,
+    int length,
+    int namesz,
+    int namesz_align) const;
+
+  uint64_t get_core_registers_from_note(Program &program, uint32_t pid) const;
 
-  void read_core_prstatus(PRStatus &prstatus);
+  void read_core_prstatus(Cursor &cursor, PRStatus &prstatus) const;
+  int read_core_mapped_files(std::vector<MappedFile> &mapped_files) const;
+  int read_core_threads(std::vector<uint64_t> &registers) const;
 
-  void print_core_prstatus();
-  void print_core_prpsinfo();
-  void print_core_siginfo();
-  virtual void print_core_mapped_files(int descsz) { }
-  virtual void print_registers() { }
+  void print_core_prstatus(Cursor &cursor);
+  void print_core_prpsinfo(Cursor &cursor);
+  void print_core_siginfo(Cursor &cursor);
+  void print_core_summary();
+  virtual void print_core_mapped_files(Cursor &cursor, int descsz) { }
+  virtual void print_registers(Cursor &cursor) { }
+
+  int get_section_data(Section &section, SectionData &section_data) const;
 
   void print_section_data(Section &section, std::string &name);
   void print_section_comment(const char *comment, int size);
   void print_section_string_table(uint8_t *table, int size);
 
-  virtual void print_section_relocation(
-    int sh_offset,
-    int sh_size,
-    int symtab_offset,
-    int strtab_offset) = 0;
+  int read_relocations(Section &section, Relocations &relocations) const;
+  int read_symbols(Section &section, Symbols &symbols) const;
+  int find_symbol_table(Section &section) const;
+  int read_dynamic_relocations(Relocations &relocations, bool plt) const;
+  uint64_t get_relr_count() const;
+  bool is_bind_now() const;
+  void print_section_relocation(Section &section);
 
   virtual void print_section_symbol_table(
     int offset,
@@ -75,6 +112,10 @@ public:
     int string_table_offset);
 
   void print_section_arm_attrs(uint8_t *attrs, int sh_size);
+  void print_section_dynamic();
+  void print_section_gnu_hash(Section &section);
+  void print_section_hash(Section &section);
+  static void print_chain_histogram(std::vector<uint32_t> &lengths);
 
   void print_header();
   void print_program_headers();
@@ -83,12 +124,41 @@ public:
   uint64_t find_section_offset(
     uint32_t type,
     const char *section_name,
-    uint64_t *len = nullptr);
+    uint64_t *len = nullptr) const;
+
+  uint64_t find_symbol_offset(const char *name) const;
+  uint64_t address_to_offset(uint64_t address) const;
+  uint64_t program_address_to_offset(uint64_t address) const;
 
-  uint64_t find_symbol_offset(const char *name);
-  uint64_t address_to_offset(uint64_t address);
+  int read_dynamic();
+  bool get_dynamic(int64_t tag, uint64_t &value) const;
+  const char *get_dynamic_string(uint64_t offset) const;
+  int read_gnu_hash(uint64_t offset, GnuHash &gnu_hash) const;
+  int find_dynamic_symbol(const char *name, Symbol &symbol) const
+  {
+    return find_dynamic_symbol(name, GnuHash::hash(name), symbol);
+  }
+
+  int find_dynamic_symbol(const char *name, uint32_t h1, Symbol &symbol) const;
+  void get_symbol(uint64_t offset, Symbol &symbol) const;
+  uint64_t get_dynamic_symbol_count() const;
 
-  int get_program_header(Program &program, uint64_t &offset, uint64_t address);
+  int get_program_header(
+    Program &program,
+    uint64_t &offset,
+    uint64_t address) const;
+
+  void get_program(int index, Program &program) const;
+  void get_section(int index, Section &section) const;
+
+  void get_sections(
+    std::vector<Section> &sections,
+    std::vector<std::string> &names) const;
+
+  const char *get_section_name(Section &section) const
+  {
+    return get_string(section.sh_name);
+  }
 
   int get_program_count()       const { return header.e_phnum; }
   int get_program_offset()      const { return header.e_phoff; }
@@ -101,14 +171,59 @@ public:
   int get_symbol_table_offset() const { return symbol_table_offset; }
   int get_symbol_table_length() const { return symbol_table_length; }
 
-  virtual uint64_t get_addr(long offset) = 0;
-  virtual uint64_t get_offset(long offset) = 0;
+  virtual uint64_t get_addr(long offset) const = 0;
+  virtual uint64_t get_offset(long offset) const = 0;
 
-  virtual int get_register_index(const char *name, uint64_t &offset)
+  virtual int get_register_index(const char *name, uint64_t &offset) const
   {
     return -1;
   }
 
+  // NULL if the range isn't in the file or couldn't be inflated. For a
+  // compressed file the pointer is only good until the next read, unless
+  // the caller holds a CompressedFile::Pin.
+  const uint8_t *get_data(uint64_t offset, uint64_t length) const
+  {
+    if (offset > (uint64_t)buffer_len || length > buffer_len - offset)
+    {
+      return nullptr;
+    }
+
+    if (map_range(offset, length) != 0) { return nullptr; }
+
+    return buffer + offset;
+  }
+
+  // Copies out of the file, safe to use on a shared compressed file.
+  int read_data(uint64_t offset, uint64_t length, uint8_t *data) const;
+
+  const char *get_cstring(uint64_t offset) const
+  {
+    if (offset >= (uint64_t)buffer_len) { return ""; }
+
+    if (compressed != nullptr && compressed->map_string(offset) != 0)
+    {
+      return "";
+    }
+
+    return (const char *)buffer + offset;
+  }
+
+  uint8_t read_int8(uint64_t offset) const
+  {
+    uint8_t copy[1];
+    const uint8_t *data = get_scalar(offset, sizeof(copy), copy);
+
+    return data != nullptr ? data[0] : 0;
+  }
+
+  uint16_t read_int16(uint64_t offset) const;
+  uint32_t read_int32(uint64_t offset) const;
+  uint64_t read_int64(uint64_t offset) const;
+
+  uint16_t get_half(long offset) const { return read_int16(offset); }
+  uint32_t get_word(long offset) const { return read_int32(offset); }
+
   int set_writable();
   void set_readonly();
 
@@ -120,9 +235,9 @@ public:
   int fd;
 #endif
   uint8_t *buffer;
+  CompressedFile *compressed;
   int bitwidth;
   long buffer_len;
-  uint64_t file_ptr;
   bool is_little_endian;
 
   Header header;
@@ -132,69 +247,55 @@ public:
   uint64_t symbol_table_length;
   uint64_t str_sym_tbl_offset;
 
-  virtual uint64_t read_reg(uint64_t offset) = 0;
-  virtual void write_reg(uint64_t offset, uint64_t value) = 0;
-
-protected:
-  void set_file_ptr(uint64_t offset) { file_ptr = offset; }
-  uint64_t get_file_ptr() { return file_ptr; }
+  std::vector<Dynamic> dynamic_entries;
+  std::map<int64_t, int> dynamic_index;
+  uint64_t dynsym_offset;
+  uint64_t dynsym_entsize;
+  uint64_t dynstr_offset;
+  uint64_t dynstr_length;
+  uint64_t hash_offset;
+  GnuHash gnu_hash;
 
-  uint8_t read_int8(uint64_t offset) { return buffer[offset]; }
-  uint16_t read_int16(uint64_t offset);
-  uint32_t read_int32(uint64_t offset);
-  uint64_t read_int64(uint64_t offset);
+  // Symbol names are printed demangled when this is set.
+  Demangle *demangle;
 
-  uint8_t read_int8() { return read_int8(file_ptr++); }
+  virtual uint64_t read_reg(uint64_t offset) const = 0;
+  virtual void write_reg(uint64_t offset, uint64_t value) = 0;
 
-  uint16_t read_int16()
+protected:
+  // Compressed files only have the parts of buffer that were read.
+  int map_range(uint64_t offset, uint64_t length) const
   {
-    uint16_t value = read_int16(file_ptr);
-    file_ptr += 2;
-    return value;
+    return compressed != nullptr ? compressed->map(offset, length) : 0;
   }
 
-  uint32_t read_int32()
+  // Scalars from a compressed file are copied out, so another thread
+  // can't evict them between the map and the read.
+  const uint8_t *get_scalar(uint64_t offset, int length, uint8_t *copy) const
   {
-    uint32_t value = read_int32(file_ptr);
-    file_ptr += 4;
-    return value;
-  }
+    if (compressed == nullptr) { return buffer + offset; }
 
-  uint64_t read_int64()
-  {
-    uint64_t value = read_int64(file_ptr);
-    file_ptr += 8;
-    return value;
+    return compressed->read(offset, length, copy) == 0 ? copy : nullptr;
   }
 
-  uint16_t read_half() { return read_int16(); }
-  uint32_t read_word() { return read_int32(); }
-  uint16_t get_half(long offset) { return read_int16(offset); }
-  uint32_t get_word(long offset) { return read_int32(offset); }
-
-  const char *get_string(int offset)
+  const char *get_string(int offset) const
   {
     if (offset == 0) { return ""; }
-    return (char *)(buffer + get_string_table_offset() + offset);
+    return get_cstring(get_string_table_offset() + offset);
   }
 
-  // These shouldn't be used for ELF32.
-  //uint32_t read_xword()            { return read_int64(); }
-  //uint32_t get_xword(long offset)  { return read_int64(offset); }
+private:
+  static Elf *create_instance(int ei_class, int e_machine);
 
-  virtual uint64_t read_addr() = 0;
-  virtual uint64_t read_offset() = 0;
+  static int decompress_section(
+    uint32_t compression,
+    const uint8_t *data,
+    uint64_t length,
+    std::vector<uint8_t> &output);
 
-  void push_ptr() { file_ptr_stack.push_back(file_ptr); }
-  void pop_ptr()
-  {
-    file_ptr = file_ptr_stack.back();
-    file_ptr_stack.pop_back();
-  }
+  static const uint64_t max_decompressed_size = 1ULL << 32;
 
-private:
-  static Elf *create_instance(int ei_class, int e_machine);
-  std::vector<uint64_t> file_ptr_stack;
+  mutable SectionCache section_cache;
 };
 
 #endif
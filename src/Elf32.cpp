@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 
+#include "Cursor.h"
 #include "Elf32.h"
 
 Elf32::Elf32()
@@ -31,44 +32,44 @@ void Elf32::compute_string_table_offset()
     get_offset(header.e_shoff + (header.e_shstrndx * header.e_shentsize) + 16);
 }
 
-int Elf32::read_program(Program &program)
+int Elf32::read_program(Cursor &cursor, Program &program) const
 {
-  program.p_type   = read_word();
-  program.p_offset = read_offset();
-  program.p_vaddr  = read_addr();
-  program.p_paddr  = read_addr();
-  program.p_filesz = read_word();
-  program.p_memsz  = read_word();
-  program.p_flags  = read_word();
-  program.p_align  = read_word();
+  program.p_type   = cursor.read_word();
+  program.p_offset = cursor.read_offset();
+  program.p_vaddr  = cursor.read_addr();
+  program.p_paddr  = cursor.read_addr();
+  program.p_filesz = cursor.read_word();
+  program.p_memsz  = cursor.read_word();
+  program.p_flags  = cursor.read_word();
+  program.p_align  = cursor.read_word();
 
   return 0;
 }
 
-int Elf32::read_section(Section &section)
+int Elf32::read_section(Cursor &cursor, Section &section) const
 {
-  section.sh_name      = read_word();
-  section.sh_type      = read_word();
-  section.sh_flags     = read_word();
-  section.sh_addr      = read_addr();
-  section.sh_offset    = read_offset();
-  section.sh_size      = read_word();
-  section.sh_link      = read_word();
-  section.sh_info      = read_word();
-  section.sh_addralign = read_word();
-  section.sh_entsize   = read_word();
+  section.sh_name      = cursor.read_word();
+  section.sh_type      = cursor.read_word();
+  section.sh_flags     = cursor.read_word();
+  section.sh_addr      = cursor.read_addr();
+  section.sh_offset    = cursor.read_offset();
+  section.sh_size      = cursor.read_word();
+  section.sh_link      = cursor.read_word();
+  section.sh_info      = cursor.read_word();
+  section.sh_addralign = cursor.read_word();
+  section.sh_entsize   = cursor.read_word();
 
   return 0;
 }
 
-int Elf32::read_symbol(Symbol &symbol)
+int Elf32::read_symbol(Cursor &cursor, Symbol &symbol) const
 {
-  symbol.st_name  = read_word();
-  symbol.st_value = read_addr();
-  symbol.st_size  = read_word();
-  symbol.st_info  = read_int8();
-  symbol.st_other = read_int8();
-  symbol.st_shndx = read_half();
+  symbol.st_name  = cursor.read_word();
+  symbol.st_value = cursor.read_addr();
+  symbol.st_size  = cursor.read_word();
+  symbol.st_info  = cursor.read_int8();
+  symbol.st_other = cursor.read_int8();
+  symbol.st_shndx = cursor.read_half();
 
   return 0;
 }
@@ -87,85 +88,35 @@ void Elf32::print_program(Program &program)
   printf(" p_align: %" PRId64 "\n\n", program.p_align);
 }
 
-void Elf32::print_core_mapped_files(int desccz)
+void Elf32::print_core_mapped_files(Cursor &cursor, int desccz)
 {
-  push_ptr();
+  Cursor entry = cursor;
 
-  const char *filename = (char *)buffer + file_ptr;
-  long count = read_offset();
+  if (map_range(entry.offset, desccz) != 0)
+  {
+    printf("Error: Cannot read NT_FILE note.\n");
+    return;
+  }
+
+  const char *filename = (char *)buffer + entry.offset;
+  long count = entry.read_offset();
   int n;
 
   printf("            count: %ld\n", count);
-  printf("        page size: %" PRId64 "\n", read_offset());
+  printf("        page size: %" PRId64 "\n", entry.read_offset());
 
   printf("            Page Offset   Start    End\n");
   filename += 4 * 2 + (count * 4 * 3);
 
   for (n = 0; n < count; n++)
   {
-     uint32_t page_offset = read_int32();
-     uint32_t start = read_int32();
-     uint32_t end = read_int32();
+     uint32_t page_offset = entry.read_int32();
+     uint32_t start = entry.read_int32();
+     uint32_t end = entry.read_int32();
      printf("            %08x %08x %08x\n", start, end, page_offset);
      printf("            %s\n\n", filename);
      filename += strlen(filename) + 1;
   }
-
-  pop_ptr();
-}
-
-void Elf32::print_section_relocation(
-  int sh_offset,
-  int sh_size,
-  int symtab_offset,
-  int strtab_offset)
-{
-  const char *relocation_types[] =
-  {
-    "NONE",
-    "386_32",
-    "PC32",
-    "GOT32",
-    "PLT32",
-    "COPY",
-    "GLOB_DAT",
-    "JMP_SLOT",
-    "RELATIVE",
-    "GOTOFF",
-    "GOTPC",
-  };
-
-  int n = 0;
-
-  printf("Offset     Type     Symbol\n");
-
-  while (n < sh_size)
-  {
-    uint32_t offset = get_addr(sh_offset + n);
-    uint32_t info = get_word(sh_offset + n + 4);
-    int sym = info >> 8;
-    int type = info & 0xff;
-
-    printf("0x%08x ", offset);
-
-    if (type > 10)
-    {
-      printf("%d ", type);
-    }
-      else
-    {
-      printf("%-8s ", relocation_types[type]);
-    }
-
-    int symbol = get_word(symtab_offset + (sym * 16));
-    const char *name = get_string(symbol);
-
-    printf("[%d] %s\n", sym, name);
-
-    n = n + 8;
-  }
-
-  printf("\n\n");
 }
 
 #if 0
@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 
+#include "Cursor.h"
 #include "Elf64.h"
 
 Elf64::Elf64()
@@ -31,44 +32,44 @@ void Elf64::compute_string_table_offset()
     get_offset(header.e_shoff + (header.e_shstrndx * header.e_shentsize) + 24);
 }
 
-int Elf64::read_program(Program &program)
+int Elf64::read_program(Cursor &cursor, Program &program) const
 {
-  program.p_type   = read_word();
-  program.p_flags  = read_word();
-  program.p_offset = read_offset();
-  program.p_vaddr  = read_addr();
-  program.p_paddr  = read_addr();
-  program.p_filesz = read_xword();
-  program.p_memsz  = read_xword();
-  program.p_align  = read_xword();
+  program.p_type   = cursor.read_word();
+  program.p_flags  = cursor.read_word();
+  program.p_offset = cursor.read_offset();
+  program.p_vaddr  = cursor.read_addr();
+  program.p_paddr  = cursor.read_addr();
+  program.p_filesz = cursor.read_xword();
+  program.p_memsz  = cursor.read_xword();
+  program.p_align  = cursor.read_xword();
 
   return 0;
 }
 
-int Elf64::read_section(Section &section)
+int Elf64::read_section(Cursor &cursor, Section &section) const
 {
-  section.sh_name      = read_word();
-  section.sh_type      = read_word();
-  section.sh_flags     = read_xword();
-  section.sh_addr      = read_addr();
-  section.sh_offset    = read_offset();
-  section.sh_size      = read_xword();
-  section.sh_link      = read_word();
-  section.sh_info      = read_word();
-  section.sh_addralign = read_xword();
-  section.sh_entsize   = read_xword();
+  section.sh_name      = cursor.read_word();
+  section.sh_type      = cursor.read_word();
+  section.sh_flags     = cursor.read_xword();
+  section.sh_addr      = cursor.read_addr();
+  section.sh_offset    = cursor.read_offset();
+  section.sh_size      = cursor.read_xword();
+  section.sh_link      = cursor.read_word();
+  section.sh_info      = cursor.read_word();
+  section.sh_addralign = cursor.read_xword();
+  section.sh_entsize   = cursor.read_xword();
 
   return 0;
 }
 
-int Elf64::read_symbol(Symbol &symbol)
+int Elf64::read_symbol(Cursor &cursor, Symbol &symbol) const
 {
-  symbol.st_name  = read_word();
-  symbol.st_info  = read_int8();
-  symbol.st_other = read_int8();
-  symbol.st_shndx = read_half();
-  symbol.st_value = read_addr();
-  symbol.st_size  = read_xword();
+  symbol.st_name  = cursor.read_word();
+  symbol.st_info  = cursor.read_int8();
+  symbol.st_other = cursor.read_int8();
+  symbol.st_shndx = cursor.read_half();
+  symbol.st_value = cursor.read_addr();
+  symbol.st_size  = cursor.read_xword();
 
   return 0;
 }
@@ -87,56 +88,35 @@ void Elf64::print_program(Program &program)
   printf(" p_align: 0x%" PRIx64 "\n\n", program.p_align);
 }
 
-void Elf64::print_core_mapped_files(int desccz)
+void Elf64::print_core_mapped_files(Cursor &cursor, int desccz)
 {
-  push_ptr();
+  Cursor entry = cursor;
 
-  char *filename = (char *)buffer + file_ptr;
-  long count = read_offset();
+  if (map_range(entry.offset, desccz) != 0)
+  {
+    printf("Error: Cannot read NT_FILE note.\n");
+    return;
+  }
+
+  char *filename = (char *)buffer + entry.offset;
+  long count = entry.read_offset();
   int n;
 
   printf("            count: %ld\n", count);
-  printf("        page size: %" PRId64 "\n", read_offset());
+  printf("        page size: %" PRId64 "\n", entry.read_offset());
 
   printf("            Page Offset      Start            End\n");
   filename += 8 * 2 + (count * 8 *3);
 
   for (n = 0; n < count; n++)
   {
-     uint64_t start = read_int64();
-     uint64_t end = read_int64();
-     uint64_t page_offset = read_int64();
+     uint64_t start = entry.read_int64();
+     uint64_t end = entry.read_int64();
+     uint64_t page_offset = entry.read_int64();
      printf("            %016" PRIx64 " %016" PRIx64" %016" PRIx64 "\n", page_offset, start, end);
      printf("            %s\n\n", filename);
      filename += strlen(filename) + 1;
   }
-
-  pop_ptr();
-}
-
-void Elf64::print_section_relocation(
-  int sh_offset,
-  int sh_size,
-  int symtab_offset,
-  int strtab_offset)
-{
-  int n = 0;
-
-  printf("%12s %12s type\n", "Offset", "Sym");
-
-  while (n < sh_size)
-  {
-    uint64_t offset = get_addr(sh_offset + n);
-    uint64_t info = get_word(sh_offset + n + 8);
-    uint64_t sym = info >> 8;
-    int type = info & 0xff;
-
-    printf("0x%08" PRIx64 " 0x%08" PRIx64 " %d\n", offset, sym, type);
-
-    n = n + 16;
-  }
-
-  printf("\n\n");
 }
 
 void Elf64::write_reg(uint64_t offset, uint64_t value)
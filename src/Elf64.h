@@ -24,18 +24,12 @@ public:
 
   virtual void compute_string_table_offset();
 
-  virtual int read_program(Program &program);
-  virtual int read_section(Section &section);
-  virtual int read_symbol(Symbol &symbol);
+  virtual int read_program(Cursor &cursor, Program &program) const;
+  virtual int read_section(Cursor &cursor, Section &section) const;
+  virtual int read_symbol(Cursor &cursor, Symbol &symbol) const;
 
   virtual void print_program(Program &program);
-  virtual void print_core_mapped_files(int desccz);
-
-  virtual void print_section_relocation(
-    int sh_offset,
-    int sh_size,
-    int symtab_offset,
-    int strtab_offset);
+  virtual void print_core_mapped_files(Cursor &cursor, int desccz);
 
 #if 0
   virtual void print_section_symbol_table(
@@ -45,19 +39,13 @@ public:
     int strtab_offset);
 #endif
 
-  uint64_t read_xword()           { return read_int64(); }
-  uint64_t get_xword(long offset) { return read_int64(offset); }
+  uint64_t get_xword(long offset) const { return read_int64(offset); }
 
-  virtual uint64_t get_addr(long offset)   { return read_int64(offset); }
-  virtual uint64_t get_offset(long offset) { return read_int64(offset); }
+  virtual uint64_t get_addr(long offset) const   { return read_int64(offset); }
+  virtual uint64_t get_offset(long offset) const { return read_int64(offset); }
 
-  virtual uint64_t read_reg(uint64_t offset) { return read_int64(offset); }
+  virtual uint64_t read_reg(uint64_t offset) const { return read_int64(offset); }
   virtual void write_reg(uint64_t offset, uint64_t value);
-
-protected:
-  virtual uint64_t read_addr()   { return read_int64(); }
-  virtual uint64_t read_offset() { return read_int64(); }
-
 };
 
 #endif
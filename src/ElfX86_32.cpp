@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 
+#include "Cursor.h"
 #include "ElfX86_32.h"
 
 ElfX86_32::ElfX86_32()
@@ -22,25 +23,25 @@ ElfX86_32::~ElfX86_32()
 {
 }
 
-void ElfX86_32::print_registers()
+void ElfX86_32::print_registers(Cursor &cursor)
 {
-  uint32_t ebx = (uint32_t)read_int32();
-  uint32_t ecx = (uint32_t)read_int32();
-  uint32_t edx = (uint32_t)read_int32();
-  uint32_t esi = (uint32_t)read_int32();
-  uint32_t edi = (uint32_t)read_int32();
-  uint32_t ebp = (uint32_t)read_int32();
-  uint32_t eax = (uint32_t)read_int32();
-  uint32_t xds = (uint32_t)read_int32();
-  uint32_t xes = (uint32_t)read_int32();
-  uint32_t xfs = (uint32_t)read_int32();
-  uint32_t xgs = (uint32_t)read_int32();
-  uint32_t orig_eax = (uint32_t)read_int32();
-  uint32_t eip = (uint32_t)read_int32();
-  uint32_t xcs = (uint32_t)read_int32();
-  uint32_t eflags = (uint32_t)read_int32();
-  uint32_t esp = (uint32_t)read_int32();
-  uint32_t xss = (uint32_t)read_int32();
+  uint32_t ebx = (uint32_t)cursor.read_int32();
+  uint32_t ecx = (uint32_t)cursor.read_int32();
+  uint32_t edx = (uint32_t)cursor.read_int32();
+  uint32_t esi = (uint32_t)cursor.read_int32();
+  uint32_t edi = (uint32_t)cursor.read_int32();
+  uint32_t ebp = (uint32_t)cursor.read_int32();
+  uint32_t eax = (uint32_t)cursor.read_int32();
+  uint32_t xds = (uint32_t)cursor.read_int32();
+  uint32_t xes = (uint32_t)cursor.read_int32();
+  uint32_t xfs = (uint32_t)cursor.read_int32();
+  uint32_t xgs = (uint32_t)cursor.read_int32();
+  uint32_t orig_eax = (uint32_t)cursor.read_int32();
+  uint32_t eip = (uint32_t)cursor.read_int32();
+  uint32_t xcs = (uint32_t)cursor.read_int32();
+  uint32_t eflags = (uint32_t)cursor.read_int32();
+  uint32_t esp = (uint32_t)cursor.read_int32();
+  uint32_t xss = (uint32_t)cursor.read_int32();
 
   printf("      EBX: %08x  ECX: %08x    EDX: %08x  ESI: %08x\n",
     ebx, ecx, edx, esi);
@@ -63,7 +64,7 @@ void ElfX86_32::print_registers()
   }
 }
 
-int ElfX86_32::get_register_index(const char *name, uint64_t &offset)
+int ElfX86_32::get_register_index(const char *name, uint64_t &offset) const
 {
   const char *regs[] =
   {
@@ -22,9 +22,9 @@ public:
   ElfX86_32();
   virtual ~ElfX86_32();
 
-  virtual void print_registers();
+  virtual void print_registers(Cursor &cursor);
 
-  virtual int get_register_index(const char *name, uint64_t &offset);
+  virtual int get_register_index(const char *name, uint64_t &offset) const;
 };
 
 #endif
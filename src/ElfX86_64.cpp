@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 
+#include "Cursor.h"
 #include "ElfX86_64.h"
 
 ElfX86_64::ElfX86_64()
@@ -22,35 +23,35 @@ ElfX86_64::~ElfX86_64()
 {
 }
 
-void ElfX86_64::print_registers()
+void ElfX86_64::print_registers(Cursor &cursor)
 {
-  uint64_t r15 = (uint64_t)read_int64();
-  uint64_t r14 = (uint64_t)read_int64();
-  uint64_t r13 = (uint64_t)read_int64();
-  uint64_t r12 = (uint64_t)read_int64();
-  uint64_t rbp = (uint64_t)read_int64();
-  uint64_t rbx = (uint64_t)read_int64();
-  uint64_t r11 = (uint64_t)read_int64();
-  uint64_t r10 = (uint64_t)read_int64();
-  uint64_t r9 = (uint64_t)read_int64();
-  uint64_t r8 = (uint64_t)read_int64();
-  uint64_t rax = (uint64_t)read_int64();
-  uint64_t rcx = (uint64_t)read_int64();
-  uint64_t rdx = (uint64_t)read_int64();
-  uint64_t rsi = (uint64_t)read_int64();
-  uint64_t rdi = (uint64_t)read_int64();
-  uint64_t orig_rax = (uint64_t)read_int64();
-  uint64_t rip = (uint64_t)read_int64();
-  uint64_t cs = (uint64_t)read_int64();
-  uint64_t eflags = (uint64_t)read_int64();
-  uint64_t rsp = (uint64_t)read_int64();
-  uint64_t ss = (uint64_t)read_int64();
-  uint64_t fs_base = (uint64_t)read_int64();
-  uint64_t gs_base = (uint64_t)read_int64();
-  uint64_t ds = (uint64_t)read_int64();
-  uint64_t es = (uint64_t)read_int64();
-  uint64_t fs = (uint64_t)read_int64();
-  uint64_t gs = (uint64_t)read_int64();
+  uint64_t r15 = (uint64_t)cursor.read_int64();
+  uint64_t r14 = (uint64_t)cursor.read_int64();
+  uint64_t r13 = (uint64_t)cursor.read_int64();
+  uint64_t r12 = (uint64_t)cursor.read_int64();
+  uint64_t rbp = (uint64_t)cursor.read_int64();
+  uint64_t rbx = (uint64_t)cursor.read_int64();
+  uint64_t r11 = (uint64_t)cursor.read_int64();
+  uint64_t r10 = (uint64_t)cursor.read_int64();
+  uint64_t r9 = (uint64_t)cursor.read_int64();
+  uint64_t r8 = (uint64_t)cursor.read_int64();
+  uint64_t rax = (uint64_t)cursor.read_int64();
+  uint64_t rcx = (uint64_t)cursor.read_int64();
+  uint64_t rdx = (uint64_t)cursor.read_int64();
+  uint64_t rsi = (uint64_t)cursor.read_int64();
+  uint64_t rdi = (uint64_t)cursor.read_int64();
+  uint64_t orig_rax = (uint64_t)cursor.read_int64();
+  uint64_t rip = (uint64_t)cursor.read_int64();
+  uint64_t cs = (uint64_t)cursor.read_int64();
+  uint64_t eflags = (uint64_t)cursor.read_int64();
+  uint64_t rsp = (uint64_t)cursor.read_int64();
+  uint64_t ss = (uint64_t)cursor.read_int64();
+  uint64_t fs_base = (uint64_t)cursor.read_int64();
+  uint64_t gs_base = (uint64_t)cursor.read_int64();
+  uint64_t ds = (uint64_t)cursor.read_int64();
+  uint64_t es = (uint64_t)cursor.read_int64();
+  uint64_t fs = (uint64_t)cursor.read_int64();
+  uint64_t gs = (uint64_t)cursor.read_int64();
 
   printf("      R15: %016" PRIx64 "     R14: %016" PRIx64 "   R13: %016" PRIx64 "\n",
     r15, r14, r13);
@@ -90,7 +91,7 @@ void ElfX86_64::print_registers()
   }
 }
 
-int ElfX86_64::get_register_index(const char *name, uint64_t &offset)
+int ElfX86_64::get_register_index(const char *name, uint64_t &offset) const
 {
   const char *regs[] =
   {
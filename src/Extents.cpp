@@ -0,0 +1,91 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "Extents.h"
+
+int Extents::get_data_extents(
+  int fd,
+  uint64_t length,
+  std::vector<Extent> &extents)
+{
+  extents.clear();
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+  off_t start = 0;
+
+  while ((uint64_t)start < length)
+  {
+    start = lseek(fd, start, SEEK_DATA);
+
+    if (start == -1)
+    {
+      // ENXIO means there is no more data after start.
+      if (errno == ENXIO) { return 0; }
+      break;
+    }
+
+    off_t end = lseek(fd, start, SEEK_HOLE);
+
+    if (end == -1) { break; }
+
+    extents.push_back({ (uint64_t)start, (uint64_t)end });
+
+    start = end;
+  }
+
+  if ((uint64_t)start >= length) { return 0; }
+#endif
+
+  // The filesystem can't report holes so treat it all as data.
+  extents.clear();
+
+  if (length != 0) { extents.push_back({ 0, length }); }
+
+  return -1;
+}
+
+uint64_t Extents::get_data_length(std::vector<Extent> &extents)
+{
+  uint64_t total = 0;
+
+  for (auto &extent : extents) { total += extent.end - extent.start; }
+
+  return total;
+}
+
+void Extents::print(std::vector<Extent> &extents, uint64_t length)
+{
+  uint64_t data = get_data_length(extents);
+
+  printf("Data Extents (count=%d)\n", (int)extents.size());
+  printf("---------------------------------------------\n");
+
+  for (auto &extent : extents)
+  {
+    printf("  0x%012" PRIx64 " - 0x%012" PRIx64 " %" PRIu64 "\n",
+      extent.start,
+      extent.end,
+      extent.end - extent.start);
+  }
+
+  printf("\n");
+  printf("    data: %" PRIu64 "\n", data);
+  printf("   holes: %" PRIu64 "\n", length - data);
+  printf("\n");
+}
+
@@ -0,0 +1,44 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_EXTENTS_H
+#define MAGIC_ELF_EXTENTS_H
+
+#include <stdint.h>
+#include <vector>
+
+// Kernel written cores are mostly holes. Whole file scanners walk the
+// data extents from SEEK_DATA / SEEK_HOLE instead of reading zero pages.
+class Extents
+{
+public:
+  struct Extent
+  {
+    uint64_t start;
+    uint64_t end;
+  };
+
+  static int get_data_extents(
+    int fd,
+    uint64_t length,
+    std::vector<Extent> &extents);
+
+  static uint64_t get_data_length(std::vector<Extent> &extents);
+
+  static void print(std::vector<Extent> &extents, uint64_t length);
+
+private:
+  Extents();
+  ~Extents();
+};
+
+#endif
+
@@ -0,0 +1,496 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <map>
+
+#include "FileDiff.h"
+#include "Hash.h"
+#include "Parallel.h"
+
+#define CHUNK_SIZE (1024 * 1024)
+#define RANGE_GAP 8
+#define MAX_RANGES 8
+
+int FileDiff::print(const char *old_filename, const char *new_filename)
+{
+  Elf *old_elf = Elf::open_elf(old_filename);
+
+  if (old_elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", old_filename);
+    return -1;
+  }
+
+  Elf *new_elf = Elf::open_elf(new_filename);
+
+  if (new_elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", new_filename);
+    delete old_elf;
+    return -1;
+  }
+
+  printf("Diff: %s -> %s\n\n", old_filename, new_filename);
+
+  print_header_diff(old_elf, new_elf);
+  print_program_diff(old_elf, new_elf);
+
+  std::vector<Section> old_sections, new_sections;
+  std::vector<std::string> old_names, new_names;
+
+  old_elf->get_sections(old_sections, old_names);
+  new_elf->get_sections(new_sections, new_names);
+
+  // Match by name. Repeated names (.group, .text.unlikely, ...) are
+  // matched in the order they appear.
+  std::map<std::string, std::vector<int>> new_by_name;
+  std::vector<bool> new_matched(new_sections.size());
+  std::vector<Pair> pairs;
+  std::vector<std::string> only_old, only_new;
+
+  for (int n = new_sections.size() - 1; n >= 1; n--)
+  {
+    new_by_name[new_names[n]].push_back(n);
+  }
+
+  for (int n = 1; n < (int)old_sections.size(); n++)
+  {
+    auto iter = new_by_name.find(old_names[n]);
+
+    if (iter == new_by_name.end() || iter->second.size() == 0)
+    {
+      only_old.push_back(old_names[n]);
+      continue;
+    }
+
+    Pair pair;
+    pair.name = old_names[n];
+    pair.old_index = n;
+    pair.new_index = iter->second.back();
+    iter->second.pop_back();
+    new_matched[pair.new_index] = true;
+
+    if (old_elf->get_section_data(old_sections[n], pair.old_data) != 0 ||
+        new_elf->get_section_data(new_sections[pair.new_index], pair.new_data) != 0)
+    {
+      printf("Error: Cannot read section %s\n", pair.name.c_str());
+      continue;
+    }
+
+    pairs.push_back(pair);
+  }
+
+  for (int n = 1; n < (int)new_sections.size(); n++)
+  {
+    if (!new_matched[n]) { only_new.push_back(new_names[n]); }
+  }
+
+  // Same size sections get split into chunks that are hashed (and only
+  // if the hashes differ, compared) in parallel. Sections that changed
+  // size are compared directly below.
+  std::vector<Chunk> chunks;
+
+  for (int n = 0; n < (int)pairs.size(); n++)
+  {
+    const uint64_t size = pairs[n].old_data.size;
+
+    if (size != pairs[n].new_data.size) { continue; }
+
+    for (uint64_t offset = 0; offset < size; offset += CHUNK_SIZE)
+    {
+      Chunk chunk;
+      chunk.pair = n;
+      chunk.offset = offset;
+      chunk.length = size - offset < CHUNK_SIZE ? size - offset : CHUNK_SIZE;
+      chunk.failed = false;
+      chunks.push_back(chunk);
+    }
+  }
+
+  // A chunk of a compressed file is copied out when its thread gets to
+  // it since another thread's reads can drop the window a section's
+  // data pointer points into.
+  Parallel::for_range(
+    Parallel::get_thread_count(chunks.size(), 1),
+    chunks.size(),
+    [&](int thread, uint64_t start, uint64_t end)
+    {
+      std::vector<uint8_t> old_buffer;
+      std::vector<uint8_t> new_buffer;
+
+      for (uint64_t n = start; n < end; n++)
+      {
+        Chunk &chunk = chunks[n];
+        Pair &pair = pairs[chunk.pair];
+
+        const uint8_t *old_data = read(
+          old_elf,
+          old_sections[pair.old_index],
+          pair.old_data,
+          chunk.offset,
+          chunk.length,
+          old_buffer);
+        const uint8_t *new_data = read(
+          new_elf,
+          new_sections[pair.new_index],
+          pair.new_data,
+          chunk.offset,
+          chunk.length,
+          new_buffer);
+
+        if (old_data == nullptr || new_data == nullptr)
+        {
+          chunk.failed = true;
+          continue;
+        }
+
+        if (Hash::hash64(old_data, chunk.length) ==
+            Hash::hash64(new_data, chunk.length))
+        {
+          continue;
+        }
+
+        compare(old_data, new_data, 0, chunk.length, chunk.ranges);
+
+        for (auto &range : chunk.ranges)
+        {
+          range.start += chunk.offset;
+          range.end += chunk.offset;
+        }
+      }
+    });
+
+  int failed = 0;
+
+  // Chunks are in order, so ranges are appended in order and only need
+  // merging where a range runs over a chunk boundary.
+  for (auto &chunk : chunks)
+  {
+    std::vector<Range> &ranges = pairs[chunk.pair].ranges;
+
+    if (chunk.failed)
+    {
+      printf("Error: Cannot read 0x%" PRIx64 " bytes at +0x%" PRIx64 " of %s\n",
+        chunk.length, chunk.offset, pairs[chunk.pair].name.c_str());
+      failed++;
+      continue;
+    }
+
+    for (auto &range : chunk.ranges)
+    {
+      if (ranges.size() != 0 && range.start - ranges.back().end <= RANGE_GAP)
+      {
+        ranges.back().end = range.end;
+      }
+        else
+      {
+        ranges.push_back(range);
+      }
+    }
+  }
+
+  int identical = 0;
+
+  printf("Sections\n");
+  printf("---------------------------------------------\n");
+
+  for (auto &pair : pairs)
+  {
+    Section &old_section = old_sections[pair.old_index];
+    Section &new_section = new_sections[pair.new_index];
+
+    if (pair.old_data.size != pair.new_data.size)
+    {
+      const uint64_t length =
+        pair.old_data.size < pair.new_data.size ?
+        pair.old_data.size : pair.new_data.size;
+
+      std::vector<uint8_t> old_buffer;
+      std::vector<uint8_t> new_buffer;
+
+      const uint8_t *old_data = read(
+        old_elf, old_section, pair.old_data, 0, length, old_buffer);
+      const uint8_t *new_data = read(
+        new_elf, new_section, pair.new_data, 0, length, new_buffer);
+
+      if (old_data == nullptr || new_data == nullptr)
+      {
+        printf("Error: Cannot read section %s\n", pair.name.c_str());
+        failed++;
+        continue;
+      }
+
+      // Everything after an insert or delete moves, so only the first
+      // difference is interesting.
+      compare(old_data, new_data, 0, length, pair.ranges);
+
+      if (pair.ranges.size() == 0)
+      {
+        Range range = { length, length };
+        pair.ranges.push_back(range);
+      }
+
+      pair.ranges.resize(1);
+    }
+
+    if (pair.ranges.size() == 0 &&
+        old_section.sh_type == new_section.sh_type &&
+        old_section.sh_flags == new_section.sh_flags &&
+        old_section.sh_addr == new_section.sh_addr &&
+        old_section.sh_size == new_section.sh_size)
+    {
+      identical++;
+      continue;
+    }
+
+    print_pair(pair, old_section, new_section);
+  }
+
+  for (auto &name : only_old) { printf("  %-24s only in old\n", name.c_str()); }
+  for (auto &name : only_new) { printf("  %-24s only in new\n", name.c_str()); }
+
+  printf("\n  identical: %d  differ: %d  only in old: %d  only in new: %d\n\n",
+    identical,
+    (int)pairs.size() - identical,
+    (int)only_old.size(),
+    (int)only_new.size());
+
+  delete old_elf;
+  delete new_elf;
+
+  return failed == 0 ? 0 : -1;
+}
+
+#define DIFF_FIELD(field, format) \
+  if (old_elf->header.field != new_elf->header.field) \
+  { \
+    printf("  %12s: " format " -> " format "\n", #field, \
+      old_elf->header.field, new_elf->header.field); \
+    count++; \
+  }
+
+void FileDiff::print_header_diff(Elf *old_elf, Elf *new_elf)
+{
+  int count = 0;
+
+  printf("Elf Header\n");
+  printf("---------------------------------------------\n");
+
+  DIFF_FIELD(ei_class, "%d");
+  DIFF_FIELD(ei_data, "%d");
+  DIFF_FIELD(ei_osabi, "%d");
+  DIFF_FIELD(e_type, "%d");
+  DIFF_FIELD(e_machine, "0x%x");
+  DIFF_FIELD(e_version, "%d");
+  DIFF_FIELD(e_entry, "0x%" PRIx64);
+  DIFF_FIELD(e_phoff, "0x%" PRIx64);
+  DIFF_FIELD(e_shoff, "0x%" PRIx64);
+  DIFF_FIELD(e_flags, "0x%08x");
+  DIFF_FIELD(e_phnum, "%d");
+  DIFF_FIELD(e_shnum, "%d");
+  DIFF_FIELD(e_shstrndx, "%d");
+
+  if (count == 0) { printf("  identical\n"); }
+
+  printf("\n");
+}
+
+#undef DIFF_FIELD
+
+#define DIFF_FIELD(field, format) \
+  if (old_program.field != new_program.field) \
+  { \
+    printf("  [%2d] %-12s %8s: " format " -> " format "\n", n, \
+      old_program.get_header_type(), #field, \
+      old_program.field, new_program.field); \
+    count++; \
+  }
+
+void FileDiff::print_program_diff(Elf *old_elf, Elf *new_elf)
+{
+  const int programs =
+    old_elf->get_program_count() < new_elf->get_program_count() ?
+    old_elf->get_program_count() : new_elf->get_program_count();
+  int count = 0;
+
+  printf("Program Headers\n");
+  printf("---------------------------------------------\n");
+
+  for (int n = 0; n < programs; n++)
+  {
+    Program old_program, new_program;
+
+    old_elf->get_program(n, old_program);
+    new_elf->get_program(n, new_program);
+
+    DIFF_FIELD(p_type, "%d");
+    DIFF_FIELD(p_flags, "%d");
+    DIFF_FIELD(p_offset, "0x%" PRIx64);
+    DIFF_FIELD(p_vaddr, "0x%" PRIx64);
+    DIFF_FIELD(p_filesz, "0x%" PRIx64);
+    DIFF_FIELD(p_memsz, "0x%" PRIx64);
+    DIFF_FIELD(p_align, "0x%" PRIx64);
+  }
+
+  if (old_elf->get_program_count() != new_elf->get_program_count())
+  {
+    printf("  count: %d -> %d\n",
+      old_elf->get_program_count(),
+      new_elf->get_program_count());
+    count++;
+  }
+
+  if (count == 0) { printf("  identical\n"); }
+
+  printf("\n");
+}
+
+#undef DIFF_FIELD
+
+const uint8_t *FileDiff::read(
+  Elf *elf,
+  const Section &section,
+  const SectionData &section_data,
+  uint64_t offset,
+  uint64_t length,
+  std::vector<uint8_t> &buffer)
+{
+  // A decompressed SHF_COMPRESSED section is held by section_data.
+  if (elf->compressed == nullptr || section_data.decompressed)
+  {
+    return section_data.data + offset;
+  }
+
+  buffer.resize(length);
+
+  if (elf->read_data(section.sh_offset + offset, length, buffer.data()) != 0)
+  {
+    return nullptr;
+  }
+
+  return buffer.data();
+}
+
+void FileDiff::compare(
+  const uint8_t *old_data,
+  const uint8_t *new_data,
+  uint64_t offset,
+  uint64_t length,
+  std::vector<Range> &ranges)
+{
+  const uint64_t end = offset + length;
+  uint64_t n = offset;
+
+  while (n < end)
+  {
+    // Skip matching bytes a word at a time.
+    while (n + 8 <= end && memcmp(old_data + n, new_data + n, 8) == 0)
+    {
+      n += 8;
+    }
+
+    while (n < end && old_data[n] == new_data[n]) { n++; }
+
+    if (n >= end) { break; }
+
+    const uint64_t start = n;
+    uint64_t last = n;
+
+    // A range ends once RANGE_GAP bytes in a row match again.
+    while (n < end && n - last <= RANGE_GAP)
+    {
+      if (old_data[n] != new_data[n]) { last = n; }
+      n++;
+    }
+
+    Range range = { start, last + 1 };
+    ranges.push_back(range);
+  }
+}
+
+void FileDiff::print_pair(Pair &pair, Section &old_section, Section &new_section)
+{
+  printf("  %-24s", pair.name.c_str());
+
+  if (old_section.sh_type != new_section.sh_type)
+  {
+    printf(" type %d -> %d", old_section.sh_type, new_section.sh_type);
+  }
+
+  if (old_section.sh_flags != new_section.sh_flags)
+  {
+    printf(" flags 0x%" PRIx64 " -> 0x%" PRIx64,
+      old_section.sh_flags, new_section.sh_flags);
+  }
+
+  if (old_section.sh_addr != new_section.sh_addr)
+  {
+    printf(" addr 0x%" PRIx64 " -> 0x%" PRIx64,
+      old_section.sh_addr, new_section.sh_addr);
+  }
+
+  if (pair.old_data.size != pair.new_data.size)
+  {
+    printf(" size %" PRIu64 " -> %" PRIu64 " (%+" PRId64 ")",
+      pair.old_data.size,
+      pair.new_data.size,
+      (int64_t)(pair.new_data.size - pair.old_data.size));
+  }
+    else
+  {
+    printf(" size %" PRIu64, pair.old_data.size);
+  }
+
+  printf("\n");
+
+  if (pair.ranges.size() == 0) { return; }
+
+  const bool resized = pair.old_data.size != pair.new_data.size;
+  uint64_t bytes = 0;
+
+  for (auto &range : pair.ranges) { bytes += range.end - range.start; }
+
+  printf("    first difference at +0x%" PRIx64, pair.ranges[0].start);
+
+  // Offsets into a SHF_COMPRESSED section don't map to the file.
+  if (!pair.old_data.decompressed)
+  {
+    printf(" (file offset 0x%" PRIx64 ")",
+      old_section.sh_offset + pair.ranges[0].start);
+  }
+
+  if (resized)
+  {
+    printf("\n");
+    return;
+  }
+
+  printf(", %d ranges, %" PRIu64 " bytes\n", (int)pair.ranges.size(), bytes);
+
+  for (int n = 0; n < (int)pair.ranges.size() && n < MAX_RANGES; n++)
+  {
+    printf("      0x%08" PRIx64 "-0x%08" PRIx64 " (%" PRIu64 " bytes)\n",
+      pair.ranges[n].start,
+      pair.ranges[n].end,
+      pair.ranges[n].end - pair.ranges[n].start);
+  }
+
+  if (pair.ranges.size() > MAX_RANGES)
+  {
+    printf("      ...\n");
+  }
+}
+
@@ -0,0 +1,82 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_FILE_DIFF_H
+#define MAGIC_ELF_FILE_DIFF_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Elf.h"
+#include "SectionData.h"
+
+// Structural diff of two ELF files: header fields, program headers and
+// sections matched by name. Section contents are split into chunks that
+// are hashed in parallel; only chunks whose hashes differ get compared
+// byte by byte to find the changed ranges.
+class FileDiff
+{
+public:
+  static int print(const char *old_filename, const char *new_filename);
+
+private:
+  FileDiff();
+  ~FileDiff();
+
+  struct Range
+  {
+    uint64_t start;
+    uint64_t end;
+  };
+
+  struct Pair
+  {
+    std::string name;
+    int old_index;
+    int new_index;
+    SectionData old_data;
+    SectionData new_data;
+    std::vector<Range> ranges;
+  };
+
+  struct Chunk
+  {
+    int pair;
+    uint64_t offset;
+    uint64_t length;
+    bool failed;
+    std::vector<Range> ranges;
+  };
+
+  static void print_header_diff(Elf *old_elf, Elf *new_elf);
+  static void print_program_diff(Elf *old_elf, Elf *new_elf);
+
+  static const uint8_t *read(
+    Elf *elf,
+    const Section &section,
+    const SectionData &section_data,
+    uint64_t offset,
+    uint64_t length,
+    std::vector<uint8_t> &buffer);
+
+  static void compare(
+    const uint8_t *old_data,
+    const uint8_t *new_data,
+    uint64_t offset,
+    uint64_t length,
+    std::vector<Range> &ranges);
+
+  static void print_pair(Pair &pair, Section &old_section, Section &new_section);
+};
+
+#endif
+
@@ -0,0 +1,522 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/procfs.h>
+#include <algorithm>
+
+#include "defines.h"
+#include "Gcore.h"
+#include "Parallel.h"
+
+int Gcore::write(
+  int pid,
+  const char *filename,
+  uint64_t max_heap,
+  bool consistent)
+{
+  Process process;
+  Info info;
+
+  if (sizeof(void *) != 8)
+  {
+    printf("Error: -gcore only writes 64 bit cores.\n");
+    return -1;
+  }
+
+  if (process.attach(pid) != 0) { return -1; }
+  if (read_info(pid, info) != 0) { return -1; }
+
+  std::vector<Process::Mapping> &mappings = process.get_mappings();
+  std::vector<Segment> segments;
+  uint64_t skipped = 0;
+
+  // Decide what gets written before anything is stopped.
+  for (auto &mapping : mappings)
+  {
+    Segment segment;
+    const uint64_t size = mapping.end - mapping.start;
+    const bool file_backed = mapping.path[0] == '/';
+
+    segment.mapping = &mapping;
+    segment.offset = 0;
+    segment.filesz = size;
+
+    if (mapping.perms[0] != 'r' ||
+        mapping.path == "[vvar]" ||
+        mapping.path == "[vvar_vclock]" ||
+        mapping.path == "[vsyscall]")
+    {
+      segment.filesz = 0;
+    }
+      else
+    if (file_backed && mapping.perms[1] != 'w')
+    {
+      // Keep the ELF header page so tools can tell what was loaded.
+      segment.filesz = mapping.offset == 0 ? std::min(size, (uint64_t)4096) : 0;
+    }
+      else
+    if (mapping.path == "[heap]" && max_heap != 0)
+    {
+      segment.filesz = std::min(size, max_heap);
+    }
+
+    skipped += size - segment.filesz;
+    segments.push_back(segment);
+  }
+
+  const uint64_t phnum = segments.size() + 1;
+
+  if (phnum >= 0xffff)
+  {
+    printf("Error: Too many mappings (%d)\n", (int)segments.size());
+    return -1;
+  }
+
+  std::vector<uint8_t> auxv;
+  char path[64];
+
+  snprintf(path, sizeof(path), "/proc/%d/auxv", pid);
+  read_file(path, auxv);
+
+  int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  if (fd == -1)
+  {
+    printf("Error: Cannot open %s for writing (%s)\n", filename, strerror(errno));
+    return -1;
+  }
+
+  // Everything from here until resume() is the stop window.
+  if (process.stop() != 0)
+  {
+    printf("Error: Cannot stop process %d\n", pid);
+    close(fd);
+    unlink(filename);
+    return -1;
+  }
+
+  std::vector<Process::Thread> &threads = process.get_threads();
+
+  // A thread that kept running would be missing from the core.
+  for (auto &thread : threads)
+  {
+    if (thread.stopped) { continue; }
+
+    printf("Error: Cannot stop thread %d of process %d\n", thread.tid, pid);
+    process.resume();
+    close(fd);
+    unlink(filename);
+    return -1;
+  }
+  std::vector<uint8_t> notes;
+
+  // The main thread goes first and carries the process wide notes, the
+  // same order the kernel uses.
+  std::stable_sort(threads.begin(), threads.end(),
+    [pid](const Process::Thread &a, const Process::Thread &b)
+    {
+      return a.tid == pid && b.tid != pid;
+    });
+
+  bool first = true;
+
+  for (auto &thread : threads)
+  {
+    if (!thread.stopped) { continue; }
+
+    add_prstatus(notes, thread, info);
+
+    if (first)
+    {
+      struct elf_prpsinfo prpsinfo;
+
+      memset(&prpsinfo, 0, sizeof(prpsinfo));
+      prpsinfo.pr_state = info.state == 'R' ? 0 : 1;
+      prpsinfo.pr_sname = info.state;
+      prpsinfo.pr_zomb = info.state == 'Z';
+      prpsinfo.pr_nice = info.nice;
+      prpsinfo.pr_flag = info.flags;
+      prpsinfo.pr_uid = info.uid;
+      prpsinfo.pr_gid = info.gid;
+      prpsinfo.pr_pid = pid;
+      prpsinfo.pr_ppid = info.ppid;
+      prpsinfo.pr_pgrp = info.pgrp;
+      prpsinfo.pr_sid = info.sid;
+      strncpy(prpsinfo.pr_fname, info.name.c_str(), sizeof(prpsinfo.pr_fname) - 1);
+      strncpy(prpsinfo.pr_psargs, info.args.c_str(), sizeof(prpsinfo.pr_psargs) - 1);
+
+      add_note(notes, NT_PRPSINFO, &prpsinfo, sizeof(prpsinfo));
+
+      if (auxv.size() != 0) { add_note(notes, NT_AUXV, auxv.data(), auxv.size()); }
+
+      add_file_note(notes, mappings);
+      first = false;
+    }
+
+    if (thread.fp_registers.size() != 0)
+    {
+      add_note(notes, NT_PRFPREG, thread.fp_registers.data(), thread.fp_registers.size());
+    }
+  }
+
+  // Registers and notes are all taken, so unless the memory has to
+  // match them the process can run again while it's copied.
+  if (!consistent) { process.resume(); }
+
+  // ELF header, program headers, notes, then page aligned memory.
+  const uint64_t ehsize = 64;
+  const uint64_t phentsize = 56;
+  const uint64_t notes_offset = ehsize + phnum * phentsize;
+  uint64_t offset = (notes_offset + notes.size() + 4095) & ~(uint64_t)4095;
+
+  for (auto &segment : segments)
+  {
+    segment.offset = offset;
+    offset += segment.filesz;
+  }
+
+  const uint64_t length = offset;
+  uint8_t *core = (uint8_t *)MAP_FAILED;
+
+  if (ftruncate(fd, length) == 0)
+  {
+    core = (uint8_t *)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+
+  if (core == MAP_FAILED)
+  {
+    process.resume();
+    printf("Error: Cannot write %s (%s)\n", filename, strerror(errno));
+    close(fd);
+    unlink(filename);
+    return -1;
+  }
+
+  uint8_t *header = core;
+
+  memcpy(header, "\x7f" "ELF", 4);
+  header[4] = 2;
+  header[5] = 1;
+  header[6] = 1;
+
+  uint16_t half;
+  uint32_t word;
+  uint64_t xword;
+
+  half = ET_CORE;        memcpy(header + 16, &half, 2);
+  half = info.machine;   memcpy(header + 18, &half, 2);
+  word = 1;              memcpy(header + 20, &word, 4);
+  xword = ehsize;        memcpy(header + 32, &xword, 8);
+  half = ehsize;         memcpy(header + 52, &half, 2);
+  half = phentsize;      memcpy(header + 54, &half, 2);
+  half = phnum;          memcpy(header + 56, &half, 2);
+
+  std::vector<Program> programs;
+  Program program;
+
+  program.p_type = PT_NOTE;
+  program.p_flags = 0;
+  program.p_offset = notes_offset;
+  program.p_vaddr = 0;
+  program.p_paddr = 0;
+  program.p_memsz = 0;
+  program.p_filesz = notes.size();
+  program.p_align = 4;
+  programs.push_back(program);
+
+  for (auto &segment : segments)
+  {
+    const Process::Mapping &mapping = *segment.mapping;
+
+    program.p_type = PT_LOAD;
+    program.p_flags =
+      (mapping.perms[0] == 'r' ? 4 : 0) |
+      (mapping.perms[1] == 'w' ? 2 : 0) |
+      (mapping.perms[2] == 'x' ? 1 : 0);
+    program.p_offset = segment.offset;
+    program.p_vaddr = mapping.start;
+    program.p_paddr = 0;
+    program.p_filesz = segment.filesz;
+    program.p_memsz = mapping.end - mapping.start;
+    program.p_align = 4096;
+    programs.push_back(program);
+  }
+
+  uint8_t *entry = core + ehsize;
+
+  for (auto &program : programs)
+  {
+    memcpy(entry + 0, &program.p_type, 4);
+    memcpy(entry + 4, &program.p_flags, 4);
+    memcpy(entry + 8, &program.p_offset, 8);
+    memcpy(entry + 16, &program.p_vaddr, 8);
+    memcpy(entry + 24, &program.p_paddr, 8);
+    memcpy(entry + 32, &program.p_filesz, 8);
+    memcpy(entry + 40, &program.p_memsz, 8);
+    memcpy(entry + 48, &program.p_align, 8);
+    entry += phentsize;
+  }
+
+  memcpy(core + notes_offset, notes.data(), notes.size());
+
+  // Memory is read in chunks so a page that can't be read only costs
+  // its chunk and the work spreads evenly over the threads.
+  std::vector<Process::Read> reads;
+
+  for (auto &segment : segments)
+  {
+    for (uint64_t n = 0; n < segment.filesz; n += chunk_size)
+    {
+      Process::Read read;
+
+      read.address = segment.mapping->start + n;
+      read.length = std::min((uint64_t)chunk_size, segment.filesz - n);
+      read.data = core + segment.offset + n;
+      read.ok = false;
+
+      reads.push_back(read);
+    }
+  }
+
+  Parallel::for_range(
+    Parallel::get_thread_count(reads.size(), 64),
+    reads.size(),
+    [&](int thread, uint64_t start, uint64_t end)
+    {
+      std::vector<Process::Read> batch(reads.begin() + start, reads.begin() + end);
+
+      process.read_memory(batch);
+
+      std::copy(batch.begin(), batch.end(), reads.begin() + start);
+    });
+
+  if (consistent) { process.resume(); }
+
+  munmap(core, length);
+  close(fd);
+
+  uint64_t failed = 0;
+
+  for (auto &read : reads)
+  {
+    if (!read.ok) { failed += read.length; }
+  }
+
+  int thread_count = 0;
+
+  for (auto &thread : threads)
+  {
+    if (thread.registers.size() != 0) { thread_count++; }
+  }
+
+  printf("Wrote %s: %d threads, %d mappings, %" PRIu64 " bytes\n",
+    filename,
+    thread_count,
+    (int)segments.size(),
+    length);
+  printf("  memory: %" PRIu64 " bytes in %" PRIu64
+         " process_vm_readv() calls, %" PRIu64 " bytes skipped by filter",
+    process.get_read_bytes(),
+    process.get_read_calls(),
+    skipped);
+
+  if (failed != 0) { printf(", %" PRIu64 " bytes unreadable", failed); }
+
+  printf("\n");
+  printf("  process stopped for %.3f ms%s\n",
+    process.get_stop_usec() / 1000.0,
+    consistent ? " (consistent)" : "");
+
+  return 0;
+}
+
+int Gcore::read_info(int pid, Info &info)
+{
+  char filename[64];
+  std::vector<uint8_t> data;
+
+  snprintf(filename, sizeof(filename), "/proc/%d/stat", pid);
+  read_file(filename, data);
+  data.push_back(0);
+
+  // The name is in parentheses and can contain anything, so parse from
+  // the last ')'.
+  const char *stat = (const char *)data.data();
+  const char *name_start = strchr(stat, '(');
+  const char *name_end = strrchr(stat, ')');
+
+  if (name_start == NULL || name_end == NULL || name_end < name_start)
+  {
+    printf("Error: Cannot read %s\n", filename);
+    return -1;
+  }
+
+  info.name.assign(name_start + 1, name_end);
+
+  long nice = 0;
+
+  if (sscanf(name_end + 2,
+      "%c %d %d %d %*d %*d %u %*u %*u %*u %*u %*u %*u %*d %*d %*d %ld",
+      &info.state, &info.ppid, &info.pgrp, &info.sid, &info.flags, &nice) != 6)
+  {
+    printf("Error: Cannot parse %s\n", filename);
+    return -1;
+  }
+
+  info.nice = nice;
+  info.uid = 0;
+  info.gid = 0;
+
+  snprintf(filename, sizeof(filename), "/proc/%d/status", pid);
+  read_file(filename, data);
+  data.push_back(0);
+
+  const char *status = (const char *)data.data();
+  const char *uid = strstr(status, "\nUid:");
+  const char *gid = strstr(status, "\nGid:");
+
+  if (uid != NULL) { info.uid = strtoul(uid + 5, NULL, 10); }
+  if (gid != NULL) { info.gid = strtoul(gid + 5, NULL, 10); }
+
+  snprintf(filename, sizeof(filename), "/proc/%d/cmdline", pid);
+  read_file(filename, data);
+
+  for (auto c : data) { info.args += c == 0 ? ' ' : (char)c; }
+
+  while (info.args.size() != 0 && info.args.back() == ' ') { info.args.pop_back(); }
+
+  // The core's e_machine comes from the running executable.
+  uint8_t ident[20];
+
+  snprintf(filename, sizeof(filename), "/proc/%d/exe", pid);
+
+  int fd = open(filename, O_RDONLY);
+
+  if (fd == -1 || read(fd, ident, sizeof(ident)) != sizeof(ident))
+  {
+    printf("Error: Cannot read %s (%s)\n", filename, strerror(errno));
+    if (fd != -1) { close(fd); }
+    return -1;
+  }
+
+  close(fd);
+
+  info.machine = ident[18] | (ident[19] << 8);
+
+  return 0;
+}
+
+void Gcore::read_file(const char *filename, std::vector<uint8_t> &data)
+{
+  uint8_t buffer[4096];
+
+  data.clear();
+
+  // Files in /proc have no size, so read until the end.
+  int fd = open(filename, O_RDONLY);
+
+  if (fd == -1) { return; }
+
+  while (true)
+  {
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+
+    if (count < 0 && errno == EINTR) { continue; }
+    if (count <= 0) { break; }
+
+    data.insert(data.end(), buffer, buffer + count);
+  }
+
+  close(fd);
+}
+
+void Gcore::add_note(
+  std::vector<uint8_t> &notes,
+  uint32_t type,
+  const void *desc,
+  uint32_t descsz)
+{
+  const uint32_t header[3] = { 5, descsz, type };
+  const uint8_t *data = (const uint8_t *)desc;
+
+  notes.insert(notes.end(), (const uint8_t *)header, (const uint8_t *)(header + 3));
+  notes.insert(notes.end(), (const uint8_t *)"CORE\0\0\0", (const uint8_t *)"CORE\0\0\0" + 8);
+  notes.insert(notes.end(), data, data + descsz);
+  notes.resize((notes.size() + 3) & ~(size_t)3, 0);
+}
+
+void Gcore::add_prstatus(
+  std::vector<uint8_t> &notes,
+  const Process::Thread &thread,
+  const Info &info)
+{
+  struct elf_prstatus prstatus;
+
+  memset(&prstatus, 0, sizeof(prstatus));
+  prstatus.pr_cursig = thread.signal;
+  prstatus.pr_pid = thread.tid;
+  prstatus.pr_ppid = info.ppid;
+  prstatus.pr_pgrp = info.pgrp;
+  prstatus.pr_sid = info.sid;
+  prstatus.pr_fpvalid = thread.fp_registers.size() != 0;
+
+  memcpy(
+    &prstatus.pr_reg,
+    thread.registers.data(),
+    std::min(thread.registers.size(), sizeof(prstatus.pr_reg)));
+
+  add_note(notes, NT_PRSTATUS, &prstatus, sizeof(prstatus));
+}
+
+void Gcore::add_file_note(
+  std::vector<uint8_t> &notes,
+  std::vector<Process::Mapping> &mappings)
+{
+  std::vector<uint64_t> entries;
+  std::string names;
+
+  // count, page size, then start/end/page offset for each file and the
+  // file names after all of them.
+  entries.push_back(0);
+  entries.push_back(4096);
+
+  for (auto &mapping : mappings)
+  {
+    if (mapping.path[0] != '/') { continue; }
+
+    entries.push_back(mapping.start);
+    entries.push_back(mapping.end);
+    entries.push_back(mapping.offset / 4096);
+
+    names += mapping.path;
+    names += '\0';
+  }
+
+  entries[0] = (entries.size() - 2) / 3;
+
+  std::vector<uint8_t> desc(
+    (const uint8_t *)entries.data(),
+    (const uint8_t *)(entries.data() + entries.size()));
+
+  desc.insert(desc.end(), names.begin(), names.end());
+
+  add_note(notes, NT_FILE, desc.data(), desc.size());
+}
+
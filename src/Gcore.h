@@ -0,0 +1,86 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_GCORE_H
+#define MAGIC_ELF_GCORE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Process.h"
+
+// Writes a core file for a running process without a debugger. All
+// threads are stopped while their registers and the notes are taken and
+// released again before memory is copied, so the stop doesn't grow with
+// the size of the process. The memory then isn't a snapshot of one
+// instant; with consistent set the threads stay stopped for the copy.
+// Memory goes straight from process_vm_readv() into the mapped output
+// file from several threads. Read-only file-backed mappings (code,
+// rodata) are left out apart from the ELF header page, same as the
+// kernel does by default, and the heap can be capped. Every mapping
+// still gets a PT_LOAD so addresses and NT_FILE line up with the full
+// process.
+class Gcore
+{
+public:
+  static int write(
+    int pid,
+    const char *filename,
+    uint64_t max_heap,
+    bool consistent);
+
+private:
+  struct Segment
+  {
+    const Process::Mapping *mapping;
+    uint64_t offset;
+    uint64_t filesz;
+  };
+
+  struct Info
+  {
+    int ppid;
+    int pgrp;
+    int sid;
+    int nice;
+    uint32_t flags;
+    uint32_t uid;
+    uint32_t gid;
+    char state;
+    std::string name;
+    std::string args;
+    uint16_t machine;
+  };
+
+  static int read_info(int pid, Info &info);
+  static void read_file(const char *filename, std::vector<uint8_t> &data);
+
+  static void add_note(
+    std::vector<uint8_t> &notes,
+    uint32_t type,
+    const void *desc,
+    uint32_t descsz);
+
+  static void add_prstatus(
+    std::vector<uint8_t> &notes,
+    const Process::Thread &thread,
+    const Info &info);
+
+  static void add_file_note(
+    std::vector<uint8_t> &notes,
+    std::vector<Process::Mapping> &mappings);
+
+  static const uint64_t chunk_size = 1024 * 1024;
+};
+
+#endif
+
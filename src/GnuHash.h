@@ -0,0 +1,76 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_GNU_HASH_H
+#define MAGIC_ELF_GNU_HASH_H
+
+#include <stdint.h>
+
+// Layout of a DT_GNU_HASH table: header, bloom filter words (one
+// address in size), buckets, then the hash chain for every symbol
+// starting at symoffset.
+struct GnuHash
+{
+  GnuHash() :
+    offset         { 0 },
+    nbuckets       { 0 },
+    symoffset      { 0 },
+    bloom_size     { 0 },
+    bloom_shift    { 0 },
+    bloom_offset   { 0 },
+    buckets_offset { 0 },
+    chain_offset   { 0 }
+  {
+  }
+
+  ~GnuHash()
+  {
+  }
+
+  static uint32_t hash(const char *name)
+  {
+    uint32_t h = 5381;
+
+    for (const uint8_t *s = (const uint8_t *)name; *s != 0; s++)
+    {
+      h = (h << 5) + h + *s;
+    }
+
+    return h;
+  }
+
+  static uint32_t sysv_hash(const char *name)
+  {
+    uint32_t h = 0;
+
+    for (const uint8_t *s = (const uint8_t *)name; *s != 0; s++)
+    {
+      h = (h << 4) + *s;
+      uint32_t g = h & 0xf0000000;
+      if (g != 0) { h ^= g >> 24; }
+      h &= ~g;
+    }
+
+    return h;
+  }
+
+  uint64_t offset;
+  uint32_t nbuckets;
+  uint32_t symoffset;
+  uint32_t bloom_size;
+  uint32_t bloom_shift;
+  uint64_t bloom_offset;
+  uint64_t buckets_offset;
+  uint64_t chain_offset;
+};
+
+#endif
+
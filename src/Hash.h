@@ -0,0 +1,76 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_HASH_H
+#define MAGIC_ELF_HASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Fast non-cryptographic 64 bit hash for telling if two blocks of
+// memory are (almost certainly) the same. Four independent lanes are
+// mixed 8 bytes at a time so the loop isn't limited by one multiply
+// chain.
+class Hash
+{
+public:
+  static uint64_t hash64(const uint8_t *data, uint64_t length, uint64_t seed = 0)
+  {
+    const uint64_t prime1 = 0x9e3779b185ebca87ULL;
+    const uint64_t prime2 = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t lane[4] = { seed + prime1, seed + prime2, seed, seed - prime1 };
+    uint64_t n = 0;
+
+    for (; n + 32 <= length; n += 32)
+    {
+      for (int i = 0; i < 4; i++)
+      {
+        uint64_t value;
+        memcpy(&value, data + n + (i * 8), 8);
+        lane[i] = rotate(lane[i] + (value * prime2), 31) * prime1;
+      }
+    }
+
+    uint64_t h = rotate(lane[0], 1) + rotate(lane[1], 7) +
+                 rotate(lane[2], 12) + rotate(lane[3], 18);
+
+    for (; n + 8 <= length; n += 8)
+    {
+      uint64_t value;
+      memcpy(&value, data + n, 8);
+      h = rotate(h ^ (rotate(value * prime2, 31) * prime1), 27) * prime1;
+    }
+
+    for (; n < length; n++)
+    {
+      h = rotate(h ^ (data[n] * prime1), 11) * prime2;
+    }
+
+    h ^= length;
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+
+    return h;
+  }
+
+private:
+  Hash() { }
+  ~Hash() { }
+
+  static uint64_t rotate(uint64_t value, int bits)
+  {
+    return (value << bits) | (value >> (64 - bits));
+  }
+};
+
+#endif
+
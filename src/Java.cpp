@@ -14,7 +14,10 @@
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <sys/stat.h>
+#include <vector>
 
+#include "Extents.h"
 #include "Java.h"
 
 void Java::extract(const char *filename)
@@ -23,6 +26,8 @@ void Java::extract(const char *filename)
   const int cafebabe[] = { 0xca, 0xfe, 0xba, 0xbe };
   int ptr = 0, ch;
   uint64_t progress = 0;
+  std::vector<Extents::Extent> extents;
+  struct stat stat_buf;
   Code code;
 
   memset(&code, 0, sizeof(code));
@@ -35,43 +40,62 @@ void Java::extract(const char *filename)
     exit(1);
   }
 
+  fstat(fileno(in), &stat_buf);
+  Extents::get_data_extents(fileno(in), stat_buf.st_size, extents);
+
   code.size = 65536;
   code.data = (uint8_t *)malloc(code.size);
 
-  while (1)
+  for (auto &extent : extents)
   {
-    ch = getc(in);
-    if (ch == EOF) { break; }
+    uint64_t pos = extent.start;
+
+    if (fseek(in, pos, SEEK_SET) != 0) { break; }
 
-    if (ch == cafebabe[ptr++])
+    // A class file can't start across a hole.
+    ptr = 0;
+
+    while (pos < extent.end)
     {
-      if (ptr == 4)
+      ch = getc(in);
+      if (ch == EOF) { break; }
+      pos++;
+
+      if (ch == cafebabe[ptr++])
+      {
+        if (ptr == 4)
+        {
+          code.start = pos - 4;
+          ptr = 0;
+          code.length = 0;
+
+          int err =
+            extract_header(in, &code) != 0 ||
+            extract_constants(in, &code) != 0 ||
+            extract_info(in, &code) != 0 ||
+            extract_interfaces(in, &code) != 0 ||
+            extract_fields(in, &code) != 0 ||
+            extract_methods(in, &code) != 0 ||
+            extract_attributes(in, &code) != 0;
+
+          pos = ftell(in);
+
+          if (err) { continue; }
+
+          dump(&code);
+        }
+      }
+      else
       {
-        code.start = ftell(in) - 4;
         ptr = 0;
-        code.length = 0;
-
-        if (extract_header(in, &code) != 0) { continue; }
-        if (extract_constants(in, &code) != 0) { continue; }
-        if (extract_info(in, &code) != 0) { continue; }
-        if (extract_interfaces(in, &code) != 0) { continue; }
-        if (extract_fields(in, &code) != 0) { continue; }
-        if (extract_methods(in, &code) != 0) { continue; }
-        if (extract_attributes(in, &code) != 0) { continue; }
-
-        dump(&code);
       }
-    }
-    else
-    {
-      ptr = 0;
-    }
 
-    progress++;
+      progress++;
 
-    if ((progress % 10000000) == 0)
-    {
-      printf("%" PRId64 "MB %ld\n", progress / 1024 / 1024, ftell(in));
+      if ((progress % 10000000) == 0)
+      {
+        printf("%" PRId64 "MB %" PRId64 "\n", progress / 1024 / 1024, pos);
+      }
     }
   }
 
@@ -0,0 +1,261 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <glob.h>
+#include <unistd.h>
+#include <set>
+
+#include "defines.h"
+#include "LibraryCache.h"
+
+LibraryCache::LibraryCache()
+{
+  read_ld_so_conf("/etc/ld.so.conf", 0);
+
+  const char *defaults[] =
+  {
+#if defined(__x86_64__)
+    "/lib/x86_64-linux-gnu",
+    "/usr/lib/x86_64-linux-gnu",
+#endif
+    "/lib64",
+    "/usr/lib64",
+    "/lib",
+    "/usr/lib",
+  };
+
+  for (auto dir : defaults) { system_dirs.push_back(dir); }
+}
+
+LibraryCache::~LibraryCache()
+{
+  for (auto &iter : elfs) { delete iter.second; }
+}
+
+Elf *LibraryCache::open(const char *filename, std::string &path)
+{
+  char real_path[PATH_MAX];
+
+  if (realpath(filename, real_path) == NULL) { return NULL; }
+
+  path = real_path;
+
+  auto iter = elfs.find(path);
+
+  if (iter != elfs.end()) { return iter->second; }
+
+  // Failures are cached too so a missing library is only looked for once.
+  Elf *elf = Elf::open_elf(real_path);
+  elfs[path] = elf;
+
+  return elf;
+}
+
+Elf *LibraryCache::find_library(
+  const char *name,
+  Elf *requester,
+  const std::string &requester_path,
+  std::string &path)
+{
+  if (strchr(name, '/') != NULL) { return open(name, path); }
+
+  std::vector<std::string> dirs;
+  std::string origin = requester_path.substr(0, requester_path.rfind('/'));
+  uint64_t rpath = 0;
+  uint64_t runpath = 0;
+  bool has_rpath = requester->get_dynamic(DT_RPATH, rpath);
+  bool has_runpath = requester->get_dynamic(DT_RUNPATH, runpath);
+
+  // Same order as ld.so: DT_RPATH (only without DT_RUNPATH),
+  // LD_LIBRARY_PATH, DT_RUNPATH, then the system directories.
+  if (has_rpath && !has_runpath)
+  {
+    add_search_path(dirs, requester->get_dynamic_string(rpath), origin);
+  }
+
+  const char *ld_library_path = getenv("LD_LIBRARY_PATH");
+
+  if (ld_library_path != NULL)
+  {
+    add_search_path(dirs, ld_library_path, origin);
+  }
+
+  if (has_runpath)
+  {
+    add_search_path(dirs, requester->get_dynamic_string(runpath), origin);
+  }
+
+  dirs.insert(dirs.end(), system_dirs.begin(), system_dirs.end());
+
+  for (auto &dir : dirs)
+  {
+    std::string filename = dir + "/" + name;
+
+    if (access(filename.c_str(), R_OK) != 0) { continue; }
+
+    Elf *elf = open(filename.c_str(), path);
+
+    if (elf == NULL) { continue; }
+
+    // Skip libraries built for a different class or machine.
+    if (elf->header.ei_class == requester->header.ei_class &&
+        elf->header.e_machine == requester->header.e_machine)
+    {
+      return elf;
+    }
+  }
+
+  return NULL;
+}
+
+int LibraryCache::load_closure(
+  const char *filename,
+  std::vector<Module> &modules)
+{
+  std::set<std::string> loaded_paths;
+  std::set<std::string> loaded_names;
+  std::string path;
+
+  modules.clear();
+
+  Elf *elf = open(filename, path);
+
+  if (elf == NULL) { return -1; }
+
+  modules.push_back({ filename, path, elf });
+  loaded_paths.insert(path);
+
+  // Breadth first, the same order ld.so builds the global scope in.
+  for (uint32_t n = 0; n < modules.size(); n++)
+  {
+    Elf *requester = modules[n].elf;
+    const std::string requester_path = modules[n].path;
+
+    for (auto &dynamic : requester->dynamic_entries)
+    {
+      if (dynamic.d_tag != DT_NEEDED) { continue; }
+
+      std::string name = requester->get_dynamic_string(dynamic.d_val);
+
+      if (loaded_names.find(name) != loaded_names.end()) { continue; }
+
+      elf = find_library(name.c_str(), requester, requester_path, path);
+
+      if (elf == NULL)
+      {
+        printf("Warning: Cannot find %s (needed by %s)\n",
+          name.c_str(), requester_path.c_str());
+        continue;
+      }
+
+      loaded_names.insert(name);
+
+      if (loaded_paths.find(path) != loaded_paths.end()) { continue; }
+
+      loaded_paths.insert(path);
+      modules.push_back({ name, path, elf });
+    }
+  }
+
+  return 0;
+}
+
+void LibraryCache::add_search_path(
+  std::vector<std::string> &dirs,
+  const char *search_path,
+  const std::string &origin)
+{
+  std::string paths = search_path;
+  size_t start = 0;
+
+  while (start <= paths.size())
+  {
+    size_t end = paths.find(':', start);
+    if (end == std::string::npos) { end = paths.size(); }
+
+    std::string dir = paths.substr(start, end - start);
+
+    size_t pos;
+
+    while ((pos = dir.find("$ORIGIN")) != std::string::npos)
+    {
+      dir.replace(pos, 7, origin);
+    }
+
+    while ((pos = dir.find("${ORIGIN}")) != std::string::npos)
+    {
+      dir.replace(pos, 9, origin);
+    }
+
+    if (dir != "") { dirs.push_back(dir); }
+
+    start = end + 1;
+  }
+}
+
+void LibraryCache::read_ld_so_conf(const char *filename, int depth)
+{
+  char line[PATH_MAX];
+
+  if (depth > 8) { return; }
+
+  FILE *in = fopen(filename, "r");
+  if (in == NULL) { return; }
+
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    char *s = line;
+
+    char *comment = strchr(s, '#');
+    if (comment != NULL) { *comment = 0; }
+
+    while (*s == ' ' || *s == '\t') { s++; }
+
+    int length = strlen(s);
+    while (length > 0 && (s[length - 1] == '\n' || s[length - 1] == ' ' ||
+           s[length - 1] == '\t' || s[length - 1] == '\r'))
+    {
+      s[--length] = 0;
+    }
+
+    if (length == 0) { continue; }
+
+    if (strncmp(s, "include", 7) == 0 && (s[7] == ' ' || s[7] == '\t'))
+    {
+      s += 8;
+      while (*s == ' ' || *s == '\t') { s++; }
+
+      glob_t globbuf;
+
+      if (glob(s, 0, NULL, &globbuf) == 0)
+      {
+        for (size_t n = 0; n < globbuf.gl_pathc; n++)
+        {
+          read_ld_so_conf(globbuf.gl_pathv[n], depth + 1);
+        }
+
+        globfree(&globbuf);
+      }
+
+      continue;
+    }
+
+    system_dirs.push_back(s);
+  }
+
+  fclose(in);
+}
+
@@ -0,0 +1,60 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_LIBRARY_CACHE_H
+#define MAGIC_ELF_LIBRARY_CACHE_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Elf.h"
+
+// Opened ELF files keyed by real path, plus the dynamic loader's search
+// rules so DT_NEEDED entries can be followed the way ld.so would.
+class LibraryCache
+{
+public:
+  LibraryCache();
+  ~LibraryCache();
+
+  struct Module
+  {
+    std::string name;
+    std::string path;
+    Elf *elf;
+  };
+
+  Elf *open(const char *filename, std::string &path);
+
+  Elf *find_library(
+    const char *name,
+    Elf *requester,
+    const std::string &requester_path,
+    std::string &path);
+
+  int load_closure(const char *filename, std::vector<Module> &modules);
+
+private:
+  void add_search_path(
+    std::vector<std::string> &dirs,
+    const char *search_path,
+    const std::string &origin);
+
+  void read_ld_so_conf(const char *filename, int depth);
+
+  std::map<std::string, Elf *> elfs;
+  std::vector<std::string> system_dirs;
+};
+
+#endif
+
@@ -0,0 +1,44 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_MAPPED_FILE_H
+#define MAGIC_ELF_MAPPED_FILE_H
+
+#include <stdint.h>
+#include <string>
+
+// One entry of a core file's NT_FILE note.
+struct MappedFile
+{
+  MappedFile() :
+    start       { 0 },
+    end         { 0 },
+    file_offset { 0 }
+  {
+  }
+
+  ~MappedFile()
+  {
+  }
+
+  bool contains(uint64_t address) const
+  {
+    return address >= start && address < end;
+  }
+
+  uint64_t start;
+  uint64_t end;
+  uint64_t file_offset;
+  std::string name;
+};
+
+#endif
+
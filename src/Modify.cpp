@@ -14,10 +14,18 @@
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
 
+#include "Cursor.h"
 #include "defines.h"
 #include "Elf.h"
 #include "Modify.h"
+#include "Process.h"
 
 int Modify::modify_function(
   const char *filename,
@@ -47,32 +55,11 @@ int Modify::modify_function(
     return -1;
   }
 
-  elf->set_writable();
-
-  if (elf->bitwidth == 32)
-  {
-    elf->buffer[offset + 0] = 0xb8;
-    elf->buffer[offset + 1] = ret_value & 0xff;
-    elf->buffer[offset + 2] = (ret_value >> 8) & 0xff;
-    elf->buffer[offset + 3] = (ret_value >> 16) & 0xff;
-    elf->buffer[offset + 4] = (ret_value >> 24) & 0xff;
-    elf->buffer[offset + 5] =0xc3;
-  }
-    else
-  {
-    elf->buffer[offset + 0] = 0x48;
-    elf->buffer[offset + 1] = 0xb8;
-    elf->buffer[offset + 2] = ret_value & 0xff;
-    elf->buffer[offset + 3] = (ret_value >> 8) & 0xff;
-    elf->buffer[offset + 4] = (ret_value >> 16) & 0xff;
-    elf->buffer[offset + 5] = (ret_value >> 24) & 0xff;
-    elf->buffer[offset + 6] = (ret_value >> 32) & 0xff;
-    elf->buffer[offset + 7] = (ret_value >> 40) & 0xff;
-    elf->buffer[offset + 8] = (ret_value >> 48) & 0xff;
-    elf->buffer[offset + 9] = (ret_value >> 56) & 0xff;
-    elf->buffer[offset + 10] = 0xc3;
-  }
+  uint8_t stub[16];
+  const int length = get_stub(elf->bitwidth, ret_value, stub);
 
+  elf->set_writable();
+  memcpy(elf->buffer + offset, stub, length);
   elf->set_readonly();
 
   printf("Function %s modified to do nothing except return %" PRId64 ".\n",
@@ -108,7 +95,7 @@ int Modify::set_core_register_value(
   for (int count = 0; count < elf->get_program_count(); count++)
   {
     Program program;
-    elf->read_program(program);
+    elf->get_program(count, program);
 
     if (program.p_type == PT_NOTE)
     {
@@ -140,3 +127,454 @@ int Modify::set_core_register_value(
   return -2;
 }
 
+int Modify::modify_function_live(
+  int pid,
+  const char *filename,
+  const char *function_name,
+  uint64_t ret_value,
+  const char *undo_filename)
+{
+  Process process;
+  Patch patch;
+
+  if (process.attach(pid) != 0) { return -1; }
+  if (process.load_modules() != 0) { return -1; }
+
+  if (find_function_live(process, filename, function_name, patch) != 0)
+  {
+    return -1;
+  }
+
+  patch.length = get_stub(patch.bitwidth, ret_value, patch.patched);
+
+  if (patch.size != 0 && patch.size < (uint64_t)patch.length)
+  {
+    printf("Error: Function %s is only %" PRIu64 " bytes.\n",
+      function_name, patch.size);
+    return -1;
+  }
+
+  patch.function = function_name;
+
+  // Without somewhere to put the undo record the patch isn't made.
+  FILE *out = fopen(undo_filename, "ab");
+
+  if (out == NULL)
+  {
+    printf("Error: Cannot write undo record %s (%s)\n",
+      undo_filename, strerror(errno));
+    return -1;
+  }
+
+  if (write_live(process, patch, false) != 0)
+  {
+    fclose(out);
+    return -1;
+  }
+
+  std::string record = get_undo_record(pid, patch);
+
+  if (fputs(record.c_str(), out) < 0 || fclose(out) != 0)
+  {
+    printf("Error: Cannot write undo record %s (%s), it would have been:\n%s",
+      undo_filename, strerror(errno), record.c_str());
+    return -1;
+  }
+
+  printf("Function %s at 0x%" PRIx64 " in %d (%s) modified to do nothing "
+         "except return %" PRId64 ".\n",
+    function_name, patch.address, pid, patch.path.c_str(), ret_value);
+  printf("Threads stopped for %" PRIu64 " us, undo record in %s\n",
+    process.get_stop_usec(), undo_filename);
+
+  return 0;
+}
+
+int Modify::undo_live(const char *undo_filename)
+{
+  std::vector<Patch> patches;
+  std::vector<int> pids;
+  char line[PATH_MAX + 1024];
+
+  FILE *in = fopen(undo_filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Error: Cannot open %s\n", undo_filename);
+    return -1;
+  }
+
+  std::vector<std::string> records;
+
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    Patch patch;
+    int pid;
+    int path_start = 0;
+    char original[64], patched[64], function[1024];
+
+    // The path is the rest of the line since it can have spaces in it.
+    if (sscanf(line, "%d %" SCNx64 " %63s %63s %1023s %n",
+        &pid, &patch.address, original, patched, function, &path_start) != 5 ||
+        path_start == 0 ||
+        line[path_start] == '\n' ||
+        line[path_start] == 0 ||
+        strlen(original) != strlen(patched) ||
+        strlen(original) > sizeof(patch.original) * 2)
+    {
+      printf("Error: Bad undo record: %s", line);
+      fclose(in);
+      return -1;
+    }
+
+    patch.length = strlen(original) / 2;
+
+    for (int n = 0; n < patch.length; n++)
+    {
+      sscanf(original + n * 2, "%2hhx", &patch.original[n]);
+      sscanf(patched + n * 2, "%2hhx", &patch.patched[n]);
+    }
+
+    patch.function = function;
+    patch.path = line + path_start;
+
+    if (patch.path.back() == '\n') { patch.path.pop_back(); }
+
+    patches.push_back(patch);
+    pids.push_back(pid);
+    records.push_back(line);
+  }
+
+  fclose(in);
+
+  // Newest first in case the same bytes were patched more than once.
+  for (int n = patches.size() - 1; n >= 0; n--)
+  {
+    Process process;
+
+    // The modules are needed to decode the registers. If one fails the
+    // record is cut down to what's still patched, so running -undo again
+    // picks up where this left off.
+    if (process.attach(pids[n]) != 0 ||
+        process.load_modules() != 0 ||
+        write_live(process, patches[n], true) != 0)
+    {
+      records.resize(n + 1);
+
+      if (write_records(undo_filename, records) == 0)
+      {
+        printf("%d patches are still in %s\n", n + 1, undo_filename);
+      }
+
+      return -1;
+    }
+
+    printf("Function %s at 0x%" PRIx64 " in %d restored "
+           "(threads stopped for %" PRIu64 " us).\n",
+      patches[n].function.c_str(),
+      patches[n].address,
+      pids[n],
+      process.get_stop_usec());
+  }
+
+  unlink(undo_filename);
+
+  return 0;
+}
+
+std::string Modify::get_undo_record(int pid, const Patch &patch)
+{
+  char text[64];
+  std::string record;
+
+  snprintf(text, sizeof(text), "%d 0x%" PRIx64 " ", pid, patch.address);
+  record = text;
+
+  for (int n = 0; n < patch.length; n++)
+  {
+    snprintf(text, sizeof(text), "%02x", patch.original[n]);
+    record += text;
+  }
+
+  record += " ";
+
+  for (int n = 0; n < patch.length; n++)
+  {
+    snprintf(text, sizeof(text), "%02x", patch.patched[n]);
+    record += text;
+  }
+
+  record += " " + patch.function + " " + patch.path + "\n";
+
+  return record;
+}
+
+int Modify::write_records(
+  const char *undo_filename,
+  const std::vector<std::string> &records)
+{
+  FILE *out = fopen(undo_filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Error: Cannot rewrite undo record %s (%s)\n",
+      undo_filename, strerror(errno));
+    return -1;
+  }
+
+  for (auto &record : records) { fputs(record.c_str(), out); }
+
+  if (fclose(out) != 0)
+  {
+    printf("Error: Cannot rewrite undo record %s (%s)\n",
+      undo_filename, strerror(errno));
+    return -1;
+  }
+
+  return 0;
+}
+
+int Modify::get_stub(int bitwidth, uint64_t ret_value, uint8_t *stub)
+{
+  if (bitwidth == 32)
+  {
+    // mov eax, ret_value; ret
+    stub[0] = 0xb8;
+    stub[1] = ret_value & 0xff;
+    stub[2] = (ret_value >> 8) & 0xff;
+    stub[3] = (ret_value >> 16) & 0xff;
+    stub[4] = (ret_value >> 24) & 0xff;
+    stub[5] = 0xc3;
+
+    return 6;
+  }
+
+  // mov rax, ret_value; ret
+  stub[0] = 0x48;
+  stub[1] = 0xb8;
+
+  for (int n = 0; n < 8; n++) { stub[2 + n] = (ret_value >> (n * 8)) & 0xff; }
+
+  stub[10] = 0xc3;
+
+  return 11;
+}
+
+int Modify::find_function(Elf *elf, const char *name, Symbol &symbol)
+{
+  Cursor cursor(elf, elf->get_symbol_table_offset());
+  uint64_t end = cursor.offset + elf->get_symbol_table_length();
+
+  while (cursor.offset < end)
+  {
+    elf->read_symbol(cursor, symbol);
+
+    if (symbol.st_shndx == 0) { continue; }
+    if ((symbol.st_info & 0xf) != STT_FUNC) { continue; }
+
+    const char *symbol_name =
+      elf->get_cstring(elf->str_sym_tbl_offset + symbol.st_name);
+
+    if (strcmp(symbol_name, name) == 0) { return 0; }
+  }
+
+  if (elf->find_dynamic_symbol(name, symbol) >= 0 &&
+      symbol.st_shndx != 0 &&
+      (symbol.st_info & 0xf) == STT_FUNC)
+  {
+    return 0;
+  }
+
+  return -1;
+}
+
+int Modify::find_function_live(
+  Process &process,
+  const char *filename,
+  const char *function_name,
+  Patch &patch)
+{
+  char wanted[PATH_MAX];
+
+  if (filename != nullptr && realpath(filename, wanted) == NULL)
+  {
+    printf("Error: Cannot find %s\n", filename);
+    return -1;
+  }
+
+  // Modules are in address order, which puts the executable first. The
+  // names are looked up in the files on disk so static functions in
+  // .symtab can be patched too.
+  for (auto &module : process.get_modules())
+  {
+    if (module.path[0] != '/') { continue; }
+    if (filename != nullptr && module.path != wanted) { continue; }
+
+    Elf *elf = Elf::open_elf(module.path.c_str());
+
+    if (elf == nullptr) { continue; }
+
+    Symbol symbol;
+
+    if (find_function(elf, function_name, symbol) != 0)
+    {
+      delete elf;
+      continue;
+    }
+
+    // The header page in memory has to be the file's or the symbol
+    // values mean nothing.
+    const uint64_t length = elf->get_program_offset() +
+      (uint64_t)elf->get_program_count() * elf->get_program_size();
+
+    const uint8_t *header = elf->get_data(0, length);
+
+    if (length > (uint64_t)elf->buffer_len ||
+        header == nullptr ||
+        memcmp(header, module.image, length) != 0)
+    {
+      printf("Error: %s changed on disk since process %d loaded it.\n",
+        module.path.c_str(), process.get_pid());
+      delete elf;
+      return -1;
+    }
+
+    if (! (elf->header.e_machine == EM_X86_32 ||
+           elf->header.e_machine == EM_X86_64))
+    {
+      printf("Error: Unsupported machine type for function modification.\n");
+      delete elf;
+      return -1;
+    }
+
+    patch.address = module.base + symbol.st_value;
+    patch.size = symbol.st_size;
+    patch.bitwidth = elf->bitwidth;
+    patch.path = module.path;
+
+    delete elf;
+
+    return 0;
+  }
+
+  printf("Error: Function %s not found in process %d.\n",
+    function_name, process.get_pid());
+
+  return -1;
+}
+
+int Modify::write_live(Process &process, Patch &patch, bool undo)
+{
+  const uint8_t *expected = undo ? patch.patched : patch.original;
+  const uint8_t *replacement = undo ? patch.original : patch.patched;
+  uint8_t current[sizeof(patch.original)];
+  char filename[64];
+
+  snprintf(filename, sizeof(filename), "/proc/%d/mem", process.get_pid());
+
+  // /proc/<pid>/mem can write to read-only text, process_vm_writev()
+  // can't.
+  int fd = open(filename, O_RDWR);
+
+  if (fd == -1)
+  {
+    printf("Error: Cannot open %s (%s)\n", filename, strerror(errno));
+    return -1;
+  }
+
+  // A thread sitting inside the bytes being replaced would resume in the
+  // middle of an instruction. Let it run for a moment and try again.
+  for (int attempt = 0; attempt < max_attempts; attempt++)
+  {
+    if (attempt != 0) { usleep(1000); }
+
+    if (process.stop() != 0)
+    {
+      printf("Error: Cannot stop process %d\n", process.get_pid());
+      close(fd);
+      return -1;
+    }
+
+    int busy = 0;
+
+    for (auto &thread : process.get_threads())
+    {
+      uint64_t pc;
+
+      if (!thread.stopped || !process.get_register(thread, "pc", pc))
+      {
+        printf("Error: Cannot check where thread %d is.\n", thread.tid);
+        process.resume();
+        close(fd);
+        return -1;
+      }
+
+      if (pc > patch.address && pc < patch.address + patch.length)
+      {
+        busy = thread.tid;
+        break;
+      }
+    }
+
+    if (busy != 0)
+    {
+      process.resume();
+      continue;
+    }
+
+    if (pread(fd, current, patch.length, patch.address) != patch.length)
+    {
+      printf("Error: Cannot read 0x%" PRIx64 " (%s)\n",
+        patch.address, strerror(errno));
+      process.resume();
+      close(fd);
+      return -1;
+    }
+
+    // Already back to the original (an earlier -undo that stopped part
+    // way, or the code was reloaded), nothing to do.
+    if (undo && memcmp(current, replacement, patch.length) == 0)
+    {
+      process.resume();
+      close(fd);
+      return 0;
+    }
+
+    if (undo && memcmp(current, expected, patch.length) != 0)
+    {
+      printf("Error: Bytes at 0x%" PRIx64 " aren't the ones patched in.\n",
+        patch.address);
+      process.resume();
+      close(fd);
+      return -1;
+    }
+
+    if (!undo) { memcpy(patch.original, current, patch.length); }
+
+    const bool written =
+      pwrite(fd, replacement, patch.length, patch.address) == patch.length &&
+      pread(fd, current, patch.length, patch.address) == patch.length &&
+      memcmp(current, replacement, patch.length) == 0;
+
+    process.resume();
+    close(fd);
+
+    if (!written)
+    {
+      printf("Error: Cannot write 0x%" PRIx64 " (%s)\n",
+        patch.address, strerror(errno));
+      return -1;
+    }
+
+    return 0;
+  }
+
+  printf("Error: A thread kept running inside 0x%" PRIx64 "-0x%" PRIx64
+         ", giving up.\n",
+    patch.address, patch.address + patch.length);
+
+  close(fd);
+
+  return -1;
+}
+
@@ -13,6 +13,11 @@
 #define MAGIC_ELF_MODIFY_H
 
 #include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Elf.h"
+#include "Process.h"
 
 class Modify
 {
@@ -28,7 +33,50 @@ public:
     uint64_t value,
     uint32_t pid);
 
+  // Same stub written into a running process. All threads are stopped
+  // while it's written and none may be inside the replaced bytes. The
+  // old bytes are appended to undo_filename for undo_live().
+  static int modify_function_live(
+    int pid,
+    const char *filename,
+    const char *function_name,
+    uint64_t ret_value,
+    const char *undo_filename);
+
+  static int undo_live(const char *undo_filename);
+
 private:
+  struct Patch
+  {
+    uint64_t address;
+    uint64_t size;
+    int bitwidth;
+    int length;
+    uint8_t original[16];
+    uint8_t patched[16];
+    std::string function;
+    std::string path;
+  };
+
+  static int get_stub(int bitwidth, uint64_t ret_value, uint8_t *stub);
+  static std::string get_undo_record(int pid, const Patch &patch);
+
+  static int write_records(
+    const char *undo_filename,
+    const std::vector<std::string> &records);
+
+  static int find_function(Elf *elf, const char *name, Symbol &symbol);
+
+  static int find_function_live(
+    Process &process,
+    const char *filename,
+    const char *function_name,
+    Patch &patch);
+
+  static int write_live(Process &process, Patch &patch, bool undo);
+
+  static const int max_attempts = 20;
+
   Modify();
   ~Modify();
 };
@@ -0,0 +1,40 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_NOTE_H
+#define MAGIC_ELF_NOTE_H
+
+#include <stdint.h>
+
+// One entry of a PT_NOTE segment as returned by Elf::read_note().
+// desc is the file offset of the descriptor.
+struct Note
+{
+  Note() :
+    type   { 0 },
+    descsz { 0 },
+    desc   { 0 }
+  {
+    name[0] = 0;
+  }
+
+  ~Note()
+  {
+  }
+
+  uint32_t type;
+  uint32_t descsz;
+  uint64_t desc;
+  char name[1024];
+};
+
+#endif
+
@@ -0,0 +1,75 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_PARALLEL_H
+#define MAGIC_ELF_PARALLEL_H
+
+#include <stdint.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Split [0, count) into one contiguous range per thread. Each range
+// is passed its thread number so callers can keep per-thread results
+// and merge them afterwards without locking.
+class Parallel
+{
+public:
+  static int get_thread_count()
+  {
+    int count = std::thread::hardware_concurrency();
+
+    return count < 1 ? 1 : count;
+  }
+
+  static int get_thread_count(uint64_t count, uint64_t min_per_thread)
+  {
+    uint64_t threads = get_thread_count();
+
+    if (count / min_per_thread < threads) { threads = count / min_per_thread; }
+
+    return threads < 1 ? 1 : threads;
+  }
+
+  static void for_range(
+    int threads,
+    uint64_t count,
+    std::function<void(int, uint64_t, uint64_t)> function)
+  {
+    if (threads <= 1)
+    {
+      function(0, 0, count);
+      return;
+    }
+
+    std::vector<std::thread> workers;
+    const uint64_t step = (count + threads - 1) / threads;
+
+    for (int n = 0; n < threads; n++)
+    {
+      const uint64_t start = step * n;
+      const uint64_t end = start + step < count ? start + step : count;
+
+      if (start >= end) { break; }
+
+      workers.emplace_back(function, n, start, end);
+    }
+
+    for (auto &worker : workers) { worker.join(); }
+  }
+
+private:
+  Parallel() { }
+  ~Parallel() { }
+};
+
+#endif
+
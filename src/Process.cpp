@@ -0,0 +1,941 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <set>
+
+#include "defines.h"
+#include "Process.h"
+
+// process_vm_readv() takes at most this many iovecs per call.
+static const int max_iovecs = 1024;
+static const int max_stop_rounds = 100;
+
+Process::Process() :
+  pid         { 0 },
+  stop_time   { 0, 0 },
+  stop_usec   { 0 },
+  read_calls  { 0 },
+  read_ranges { 0 },
+  read_bytes  { 0 }
+{
+}
+
+Process::~Process()
+{
+  // Never leave the process stopped on an early return.
+  resume();
+
+  for (auto &module : modules)
+  {
+    delete module.elf;
+    munmap(module.image, module.image_length);
+  }
+}
+
+int Process::attach(int pid)
+{
+  this->pid = pid;
+
+  if (read_maps() != 0) { return -1; }
+  if (read_tasks() < 0) { return -1; }
+
+  std::sort(threads.begin(), threads.end(),
+    [](const Thread &a, const Thread &b) { return a.tid < b.tid; });
+
+  return 0;
+}
+
+int Process::read_maps()
+{
+  char filename[64];
+  char line[4096];
+
+  snprintf(filename, sizeof(filename), "/proc/%d/maps", pid);
+
+  FILE *in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Error: Cannot open %s (%s)\n", filename, strerror(errno));
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    Mapping mapping;
+    int path_start = 0;
+
+    line[strcspn(line, "\n")] = 0;
+
+    if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %4s %" SCNx64 " %*s %*s %n",
+        &mapping.start, &mapping.end, mapping.perms, &mapping.offset,
+        &path_start) < 4)
+    {
+      continue;
+    }
+
+    if (path_start != 0) { mapping.path = line + path_start; }
+
+    mappings.push_back(mapping);
+  }
+
+  fclose(in);
+
+  return 0;
+}
+
+int Process::read_tasks()
+{
+  char filename[64];
+
+  snprintf(filename, sizeof(filename), "/proc/%d/task", pid);
+
+  DIR *dir = opendir(filename);
+
+  if (dir == NULL)
+  {
+    printf("Error: Cannot open %s (%s)\n", filename, strerror(errno));
+    return -1;
+  }
+
+  std::set<int> known;
+
+  for (auto &thread : threads) { known.insert(thread.tid); }
+
+  struct dirent *entry;
+  int added = 0;
+
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (entry->d_name[0] < '0' || entry->d_name[0] > '9') { continue; }
+
+    const int tid = atoi(entry->d_name);
+
+    if (known.find(tid) != known.end()) { continue; }
+
+    Thread thread;
+    thread.tid = tid;
+    thread.seized = false;
+    thread.stopped = false;
+    thread.exited = false;
+    thread.signal = 0;
+    thread.stack_address = 0;
+
+    threads.push_back(thread);
+    added++;
+  }
+
+  closedir(dir);
+
+  return added;
+}
+
+int Process::stop()
+{
+  int stopped = 0;
+  size_t first = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &stop_time);
+
+  // A thread that isn't stopped yet can start new ones, so the task list
+  // is read again after each round until it has nothing new. Once every
+  // thread is stopped nothing else can appear.
+  for (int round = 0; round < max_stop_rounds; round++)
+  {
+    stopped += stop_threads(first);
+    first = threads.size();
+
+    if (read_tasks() <= 0) { break; }
+  }
+
+  threads.erase(
+    std::remove_if(threads.begin(), threads.end(),
+      [](const Thread &thread) { return thread.exited; }),
+    threads.end());
+
+  std::sort(threads.begin(), threads.end(),
+    [](const Thread &a, const Thread &b) { return a.tid < b.tid; });
+
+  return stopped == 0 ? -1 : 0;
+}
+
+int Process::stop_threads(size_t first)
+{
+  int stopped = 0;
+
+  // Seizing doesn't stop anything yet, so the stop window only covers
+  // interrupt, wait, read registers and whatever the caller does before
+  // resume().
+  for (size_t n = first; n < threads.size(); n++)
+  {
+    Thread &thread = threads[n];
+
+    thread.seized = ptrace(PTRACE_SEIZE, thread.tid, NULL, NULL) == 0;
+
+    if (thread.seized) { continue; }
+
+    if (errno == ESRCH)
+    {
+      thread.exited = true;
+      continue;
+    }
+
+    printf("Error: Cannot attach to thread %d (%s)\n",
+      thread.tid, strerror(errno));
+  }
+
+  for (size_t n = first; n < threads.size(); n++)
+  {
+    if (threads[n].seized) { ptrace(PTRACE_INTERRUPT, threads[n].tid, NULL, NULL); }
+  }
+
+  for (size_t n = first; n < threads.size(); n++)
+  {
+    Thread &thread = threads[n];
+
+    if (!thread.seized) { continue; }
+
+    int status;
+
+    if (waitpid(thread.tid, &status, __WALL) != thread.tid) { continue; }
+
+    if (WIFEXITED(status) || WIFSIGNALED(status))
+    {
+      thread.seized = false;
+      thread.exited = true;
+      continue;
+    }
+
+    if (!WIFSTOPPED(status)) { continue; }
+
+    // A signal that arrived at the same time as the interrupt has to be
+    // handed back on detach or it would be lost.
+    if ((status >> 16) != PTRACE_EVENT_STOP)
+    {
+      thread.signal = WSTOPSIG(status);
+    }
+
+    uint8_t registers[4096];
+    struct iovec iov = { registers, sizeof(registers) };
+
+    if (ptrace(PTRACE_GETREGSET, thread.tid, NT_PRSTATUS, &iov) == 0)
+    {
+      thread.registers.assign(registers, registers + iov.iov_len);
+    }
+
+    iov.iov_len = sizeof(registers);
+
+    if (ptrace(PTRACE_GETREGSET, thread.tid, NT_PRFPREG, &iov) == 0)
+    {
+      thread.fp_registers.assign(registers, registers + iov.iov_len);
+    }
+
+    thread.stopped = true;
+    stopped++;
+  }
+
+  return stopped;
+}
+
+void Process::resume()
+{
+  struct timespec end;
+
+  for (auto &thread : threads)
+  {
+    if (!thread.seized) { continue; }
+
+    ptrace(PTRACE_DETACH, thread.tid, NULL, (void *)(long)thread.signal);
+
+    thread.seized = false;
+    thread.stopped = false;
+    thread.signal = 0;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  stop_usec =
+    (end.tv_sec - stop_time.tv_sec) * 1000000 +
+    (end.tv_nsec - stop_time.tv_nsec) / 1000;
+}
+
+int Process::read_memory(std::vector<Read> &reads)
+{
+  struct iovec local[max_iovecs];
+  struct iovec remote[max_iovecs];
+  size_t n = 0;
+
+  while (n < reads.size())
+  {
+    int count = 0;
+
+    while (count < max_iovecs && n + count < reads.size())
+    {
+      Read &read = reads[n + count];
+
+      local[count].iov_base = read.data;
+      local[count].iov_len = read.length;
+      remote[count].iov_base = (void *)(uintptr_t)read.address;
+      remote[count].iov_len = read.length;
+      count++;
+    }
+
+    ssize_t length = process_vm_readv(pid, local, count, remote, count, 0);
+
+    read_calls++;
+
+    // The transfer stops at the first range that can't be read. Mark
+    // everything before it good and carry on after it.
+    uint64_t done = length < 0 ? 0 : length;
+    int index;
+
+    for (index = 0; index < count; index++)
+    {
+      Read &read = reads[n + index];
+
+      if (done < read.length) { break; }
+
+      read.ok = true;
+      done -= read.length;
+
+      read_ranges++;
+      read_bytes += read.length;
+    }
+
+    if (index < count)
+    {
+      if (length < 0 && errno != EFAULT)
+      {
+        printf("Error: Cannot read memory of %d (%s)\n", pid, strerror(errno));
+        return -1;
+      }
+
+      reads[n + index].ok = false;
+      index++;
+    }
+
+    n += index;
+  }
+
+  return 0;
+}
+
+int Process::load_modules()
+{
+  std::vector<std::vector<uint8_t> > pages;
+  std::vector<const Mapping *> candidates;
+  std::vector<Read> reads;
+  std::set<std::string> seen;
+
+  // First round: the first page of every mapping that could be the
+  // start of an ELF image.
+  for (auto &mapping : mappings)
+  {
+    if (mapping.offset != 0 || mapping.perms[0] != 'r') { continue; }
+    if (mapping.path[0] != '/' && mapping.path != "[vdso]") { continue; }
+    if (seen.find(mapping.path) != seen.end()) { continue; }
+
+    seen.insert(mapping.path);
+    candidates.push_back(&mapping);
+  }
+
+  pages.resize(candidates.size());
+
+  for (size_t n = 0; n < candidates.size(); n++)
+  {
+    const uint64_t length = std::min(
+      (uint64_t)4096,
+      candidates[n]->end - candidates[n]->start);
+
+    pages[n].resize(length);
+
+    reads.push_back({ candidates[n]->start, length, pages[n].data(), false });
+  }
+
+  if (read_memory(reads) != 0) { return -1; }
+
+  for (size_t n = 0; n < candidates.size(); n++)
+  {
+    if (!reads[n].ok) { continue; }
+
+    add_module(*candidates[n], pages[n].data(), pages[n].size());
+  }
+
+  // Second round: the dynamic sections.
+  reads.clear();
+
+  for (auto &module : modules)
+  {
+    for (int count = 0; count < module.elf->get_program_count(); count++)
+    {
+      Program program;
+      module.elf->get_program(count, program);
+
+      if (program.p_type != PT_DYNAMIC) { continue; }
+
+      Read read = { module.base + program.p_vaddr, program.p_filesz };
+
+      if (to_image(module, read)) { reads.push_back(read); }
+      break;
+    }
+  }
+
+  if (read_memory(reads) != 0) { return -1; }
+
+  // Third round: hash tables, .dynsym and .dynstr, which normally sit
+  // next to each other so each module is one range.
+  reads.clear();
+
+  for (auto &module : modules)
+  {
+    fix_dynamic(module);
+
+    uint64_t start, end;
+    get_table_range(module, start, end);
+
+    if (start >= end) { continue; }
+
+    Read read = { module.base + start, end - start };
+
+    if (to_image(module, read)) { reads.push_back(read); }
+  }
+
+  if (read_memory(reads) != 0) { return -1; }
+
+  for (auto &module : modules)
+  {
+    delete module.elf;
+    module.elf = Elf::open_elf_from_mem(module.image, module.image_length);
+
+    add_symbols(module);
+  }
+
+  return 0;
+}
+
+int Process::add_module(
+  const Mapping &mapping,
+  const uint8_t *page,
+  uint64_t length)
+{
+  const int ei_class = sizeof(void *) == 8 ? 2 : 1;
+
+  if (length < 64 || memcmp(page, "\x7f" "ELF", 4) != 0) { return -1; }
+  if (page[4] != ei_class) { return -1; }
+
+  // The program headers have to be in the first page for the header
+  // page alone to be parsed.
+  uint64_t phoff;
+  uint16_t phentsize, phnum;
+
+  if (ei_class == 2)
+  {
+    memcpy(&phoff, page + 32, 8);
+    memcpy(&phentsize, page + 54, 2);
+    memcpy(&phnum, page + 56, 2);
+  }
+    else
+  {
+    uint32_t phoff32;
+    memcpy(&phoff32, page + 28, 4);
+    memcpy(&phentsize, page + 42, 2);
+    memcpy(&phnum, page + 44, 2);
+    phoff = phoff32;
+  }
+
+  if (phnum == 0 || phoff + (uint64_t)phnum * phentsize > length) { return -1; }
+
+  Module module;
+  module.path = mapping.path;
+  module.start = mapping.start;
+  module.end = mapping.end;
+  module.elf = Elf::open_elf_from_mem((void *)page, length);
+  module.image = nullptr;
+  module.image_length = 0;
+
+  if (module.elf == nullptr) { return -1; }
+
+  uint64_t low = UINT64_MAX, high = 0;
+
+  for (int count = 0; count < module.elf->get_program_count(); count++)
+  {
+    Program program;
+    module.elf->get_program(count, program);
+
+    if (program.p_type != PT_LOAD) { continue; }
+
+    module.loads.push_back(program);
+
+    module.image_length =
+      std::max(module.image_length, program.p_offset + program.p_filesz);
+
+    low = std::min(low, program.p_vaddr);
+    high = std::max(high, program.p_vaddr + program.p_memsz);
+  }
+
+  if (module.loads.size() == 0 || module.image_length < length)
+  {
+    delete module.elf;
+    return -1;
+  }
+
+  // The first PT_LOAD is mapped at the page holding its p_vaddr.
+  module.base = mapping.start - (module.loads[0].p_vaddr & ~(uint64_t)0xfff);
+  module.end = std::max(module.end, module.base + high);
+
+  // The image is laid out like the file but only the parts that get read
+  // are ever touched, so it costs about as much as what was read.
+  void *image = mmap(
+    NULL,
+    module.image_length,
+    PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+    -1,
+    0);
+
+  if (image == MAP_FAILED)
+  {
+    delete module.elf;
+    return -1;
+  }
+
+  module.image = (uint8_t *)image;
+  memcpy(module.image, page, length);
+
+  // Parse the headers from the image from here on as page goes away.
+  delete module.elf;
+  module.elf = Elf::open_elf_from_mem(module.image, length);
+
+  modules.push_back(module);
+
+  return 0;
+}
+
+void Process::fix_dynamic(Module &module)
+{
+  // ld.so relocates the pointers in the dynamic section in place. Take
+  // the load address back out so they match the file again.
+  if (module.base == 0) { return; }
+
+  const int64_t tags[] =
+  {
+    DT_PLTGOT, DT_HASH, DT_STRTAB, DT_SYMTAB, DT_RELA, DT_REL, DT_JMPREL,
+    DT_GNU_HASH, DT_VERSYM, DT_VERDEF, DT_VERNEED, DT_RELR
+  };
+
+  const Program &last = module.loads.back();
+  const uint64_t high = module.base + last.p_vaddr + last.p_memsz;
+
+  for (int count = 0; count < module.elf->get_program_count(); count++)
+  {
+    Program program;
+    module.elf->get_program(count, program);
+
+    if (program.p_type != PT_DYNAMIC) { continue; }
+
+    const int word = sizeof(void *);
+
+    for (uint64_t n = 0; n + word * 2 <= program.p_filesz; n += word * 2)
+    {
+      uint8_t *entry = module.image + program.p_offset + n;
+      uintptr_t tag, value;
+
+      memcpy(&tag, entry, word);
+      memcpy(&value, entry + word, word);
+
+      if (tag == DT_NULL) { break; }
+
+      if (std::find(std::begin(tags), std::end(tags), (int64_t)tag) ==
+          std::end(tags))
+      {
+        continue;
+      }
+
+      if (value >= module.base && value < high)
+      {
+        value -= module.base;
+        memcpy(entry + word, &value, word);
+      }
+    }
+
+    break;
+  }
+
+  // Pick up the fixed entries.
+  delete module.elf;
+  module.elf = Elf::open_elf_from_mem(module.image, module.image_length);
+}
+
+void Process::get_table_range(Module &module, uint64_t &start, uint64_t &end)
+{
+  const Elf *elf = module.elf;
+  uint64_t strtab, strsz, value;
+
+  start = 0;
+  end = 0;
+
+  if (!elf->get_dynamic(DT_STRTAB, strtab) || !elf->get_dynamic(DT_STRSZ, strsz))
+  {
+    return;
+  }
+
+  start = strtab;
+  end = strtab + strsz;
+
+  bool past_strtab = false;
+
+  const int64_t tags[] = { DT_GNU_HASH, DT_HASH, DT_SYMTAB };
+
+  for (int64_t tag : tags)
+  {
+    if (!elf->get_dynamic(tag, value)) { continue; }
+
+    if (value < start) { start = value; }
+    if (value > strtab) { past_strtab = true; }
+  }
+
+  // The tables are in the same PT_LOAD. If one comes after .dynstr its
+  // size isn't known, so read to the end of the segment.
+  for (auto &program : module.loads)
+  {
+    if (start < program.p_vaddr ||
+        start >= program.p_vaddr + program.p_filesz)
+    {
+      continue;
+    }
+
+    const uint64_t segment_end = program.p_vaddr + program.p_filesz;
+
+    if (past_strtab || end > segment_end) { end = segment_end; }
+
+    return;
+  }
+
+  start = 0;
+  end = 0;
+}
+
+bool Process::to_image(Module &module, Read &read)
+{
+  const uint64_t address = read.address - module.base;
+
+  for (auto &program : module.loads)
+  {
+    if (address < program.p_vaddr ||
+        address >= program.p_vaddr + program.p_filesz)
+    {
+      continue;
+    }
+
+    const uint64_t offset = program.p_offset + (address - program.p_vaddr);
+
+    read.length = std::min(read.length, program.p_filesz - (address - program.p_vaddr));
+    read.data = module.image + offset;
+    read.ok = false;
+
+    return read.length != 0;
+  }
+
+  return false;
+}
+
+void Process::add_symbols(Module &module)
+{
+  const Elf *elf = module.elf;
+
+  if (elf == nullptr || elf->dynsym_offset == 0 || elf->dynsym_entsize == 0)
+  {
+    return;
+  }
+
+  const uint64_t count = elf->get_dynamic_symbol_count();
+
+  for (uint64_t n = 1; n < count; n++)
+  {
+    const uint64_t offset = elf->dynsym_offset + n * elf->dynsym_entsize;
+
+    if (offset + elf->dynsym_entsize > module.image_length) { break; }
+
+    Symbol symbol;
+    elf->get_symbol(offset, symbol);
+
+    if (symbol.st_shndx == 0 || symbol.st_value == 0) { continue; }
+    if (symbol.st_name >= elf->dynstr_length) { continue; }
+
+    module.symbols.push_back(symbol);
+  }
+
+  std::sort(module.symbols.begin(), module.symbols.end(),
+    [](const Symbol &a, const Symbol &b) { return a.st_value < b.st_value; });
+}
+
+int Process::read_stacks(uint64_t length)
+{
+  std::vector<Read> reads;
+  std::vector<Thread *> readers;
+
+  for (auto &thread : threads)
+  {
+    uint64_t sp;
+
+    if (!get_register(thread, "sp", sp)) { continue; }
+
+    const Mapping *mapping = find_mapping(sp);
+
+    if (mapping == nullptr) { continue; }
+
+    const uint64_t size = std::min(length, mapping->end - sp) / 8;
+
+    thread.stack.resize(size);
+    thread.stack_address = sp;
+
+    reads.push_back({ sp, size * 8, (uint8_t *)thread.stack.data(), false });
+    readers.push_back(&thread);
+  }
+
+  if (read_memory(reads) != 0) { return -1; }
+
+  for (size_t n = 0; n < reads.size(); n++)
+  {
+    if (!reads[n].ok) { readers[n]->stack.clear(); }
+  }
+
+  return 0;
+}
+
+bool Process::get_register(const Thread &thread, const char *name, uint64_t &value)
+{
+  // "pc" and "sp" pick the right register for the machine.
+  const char *names[] = { name, nullptr, nullptr };
+
+  if (strcmp(name, "pc") == 0)
+  {
+    names[0] = "rip";
+    names[1] = "eip";
+  }
+    else
+  if (strcmp(name, "sp") == 0)
+  {
+    names[0] = "rsp";
+    names[1] = "esp";
+  }
+
+  if (modules.size() == 0 || thread.registers.size() == 0) { return false; }
+
+  const Elf *elf = modules[0].elf;
+
+  for (int n = 0; names[n] != nullptr; n++)
+  {
+    uint64_t offset;
+
+    if (elf->get_register_index(names[n], offset) < 0) { continue; }
+
+    const int size = elf->bitwidth / 8;
+
+    if (offset + size > thread.registers.size()) { return false; }
+
+    if (size == 8)
+    {
+      memcpy(&value, thread.registers.data() + offset, 8);
+    }
+      else
+    {
+      uint32_t value32;
+      memcpy(&value32, thread.registers.data() + offset, 4);
+      value = value32;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+const Process::Mapping *Process::find_mapping(uint64_t address)
+{
+  for (auto &mapping : mappings)
+  {
+    if (mapping.contains(address)) { return &mapping; }
+  }
+
+  return nullptr;
+}
+
+Process::Module *Process::find_module(uint64_t address)
+{
+  const Mapping *mapping = find_mapping(address);
+
+  if (mapping == nullptr) { return nullptr; }
+
+  for (auto &module : modules)
+  {
+    if (module.path == mapping->path) { return &module; }
+  }
+
+  return nullptr;
+}
+
+const char *Process::find_symbol(Module &module, uint64_t address, uint64_t &offset)
+{
+  const uint64_t value = address - module.base;
+
+  auto iter = std::upper_bound(
+    module.symbols.begin(),
+    module.symbols.end(),
+    value,
+    [](uint64_t value, const Symbol &symbol) { return value < symbol.st_value; });
+
+  if (iter == module.symbols.begin()) { return nullptr; }
+
+  --iter;
+
+  if (iter->st_size != 0 && value >= iter->st_value + iter->st_size)
+  {
+    return nullptr;
+  }
+
+  offset = value - iter->st_value;
+
+  return module.elf->get_dynamic_string(iter->st_name);
+}
+
+static void print_location(Process &process, uint64_t address, Demangle *demangle)
+{
+  Process::Module *module = process.find_module(address);
+
+  if (module == nullptr) { return; }
+
+  printf(" <%s base+0x%" PRIx64, module->path.c_str(), address - module->base);
+
+  uint64_t offset = 0;
+  const char *name = process.find_symbol(*module, address, offset);
+
+  if (name != nullptr)
+  {
+    if (demangle != nullptr) { name = demangle->demangle(name); }
+
+    printf(" %s+0x%" PRIx64, name, offset);
+  }
+
+  printf(">");
+}
+
+int Process::print(int pid, Demangle *demangle)
+{
+  Process process;
+
+  if (process.attach(pid) != 0) { return -1; }
+
+  if (process.load_modules() != 0) { return -1; }
+
+  if (process.get_modules().size() == 0)
+  {
+    printf("Error: No ELF images found in process %d\n", pid);
+    return -1;
+  }
+
+  // The stacks are read before resuming so they match the registers.
+  // Without ptrace permission the rest still works.
+  const bool have_registers = process.stop() == 0;
+
+  if (have_registers) { process.read_stacks(4096); }
+
+  process.resume();
+
+  printf("Process %d: %s\n", pid, process.modules[0].path.c_str());
+  printf("  mappings: %d  modules: %d  threads: %d\n\n",
+    (int)process.mappings.size(),
+    (int)process.modules.size(),
+    (int)process.threads.size());
+
+  printf("Modules\n");
+  printf("---------------------------------------------\n");
+
+  for (auto &module : process.modules)
+  {
+    printf("  0x%016" PRIx64 "-0x%016" PRIx64 " base=0x%" PRIx64
+           " dynsym=%d %s\n",
+      module.start,
+      module.end,
+      module.base,
+      (int)module.symbols.size(),
+      module.path.c_str());
+  }
+
+  printf("\n");
+
+  for (auto &thread : process.threads)
+  {
+    uint64_t pc, sp;
+
+    printf("Thread %d\n", thread.tid);
+    printf("---------------------------------------------\n");
+
+    if (!process.get_register(thread, "pc", pc) ||
+        !process.get_register(thread, "sp", sp))
+    {
+      printf("  (no registers)\n\n");
+      continue;
+    }
+
+    printf("  pc=0x%016" PRIx64, pc);
+    print_location(process, pc, demangle);
+    printf("\n");
+    printf("  sp=0x%016" PRIx64 "\n", sp);
+
+    // Words on the stack that point into code are likely return
+    // addresses.
+    int count = 0;
+
+    for (size_t n = 0; n < thread.stack.size() && count < 16; n++)
+    {
+      const uint64_t value = thread.stack[n];
+      const Mapping *mapping = process.find_mapping(value);
+
+      if (mapping == nullptr || !mapping->is_executable()) { continue; }
+
+      printf("    [sp+0x%04x] 0x%016" PRIx64, (int)n * 8, value);
+      print_location(process, value, demangle);
+      printf("\n");
+      count++;
+    }
+
+    printf("\n");
+  }
+
+  if (have_registers)
+  {
+    printf("Threads stopped for %" PRIu64 " us\n", process.stop_usec);
+  }
+
+  printf("Read %" PRIu64 " ranges, %" PRIu64 " bytes in %" PRIu64
+         " process_vm_readv() calls\n",
+    process.read_ranges.load(),
+    process.read_bytes.load(),
+    process.read_calls.load());
+
+  return 0;
+}
+
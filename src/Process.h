@@ -0,0 +1,142 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_PROCESS_H
+#define MAGIC_ELF_PROCESS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+
+// A running process looked at without dumping a core. Mappings come
+// from /proc/<pid>/maps and memory is read with process_vm_readv(),
+// batching every range needed in a round into as few calls as
+// possible. For each mapped ELF module only the headers, the dynamic
+// section and the hash/symbol/string tables are read into a sparse
+// image laid out like the file, so the normal Elf parsers work on it
+// through open_elf_from_mem(). Registers are read with ptrace(): every
+// thread is stopped, its registers and top of stack are read and it's
+// released again in one short window.
+class Process
+{
+public:
+  Process();
+  ~Process();
+
+  struct Mapping
+  {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    char perms[5];
+    std::string path;
+
+    bool contains(uint64_t address) const
+    {
+      return address >= start && address < end;
+    }
+
+    bool is_executable() const { return perms[2] == 'x'; }
+  };
+
+  struct Module
+  {
+    std::string path;
+    uint64_t start;
+    uint64_t end;
+    uint64_t base;
+    uint8_t *image;
+    uint64_t image_length;
+    Elf *elf;
+    std::vector<Program> loads;
+
+    // Defined dynamic symbols sorted by value (relative to base).
+    std::vector<Symbol> symbols;
+  };
+
+  struct Thread
+  {
+    int tid;
+    bool seized;
+    bool stopped;
+    bool exited;
+
+    // NT_PRSTATUS and NT_PRFPREG register sets, laid out like the ones
+    // in a core file.
+    std::vector<uint8_t> registers;
+    std::vector<uint8_t> fp_registers;
+    int signal;
+
+    std::vector<uint64_t> stack;
+    uint64_t stack_address;
+  };
+
+  struct Read
+  {
+    uint64_t address;
+    uint64_t length;
+    uint8_t *data;
+    bool ok;
+  };
+
+  int attach(int pid);
+  int stop();
+  void resume();
+  int load_modules();
+  int read_stacks(uint64_t length);
+  int read_memory(std::vector<Read> &reads);
+
+  bool get_register(const Thread &thread, const char *name, uint64_t &value);
+  const Mapping *find_mapping(uint64_t address);
+  Module *find_module(uint64_t address);
+  const char *find_symbol(Module &module, uint64_t address, uint64_t &offset);
+
+  int get_pid() { return pid; }
+  uint64_t get_stop_usec() { return stop_usec; }
+  uint64_t get_read_calls() { return read_calls.load(); }
+  uint64_t get_read_bytes() { return read_bytes.load(); }
+  std::vector<Mapping> &get_mappings() { return mappings; }
+  std::vector<Module> &get_modules() { return modules; }
+  std::vector<Thread> &get_threads() { return threads; }
+
+  static int print(int pid, Demangle *demangle);
+
+private:
+  int read_maps();
+  int read_tasks();
+  int stop_threads(size_t first);
+  int add_module(const Mapping &mapping, const uint8_t *page, uint64_t length);
+  void add_symbols(Module &module);
+  void fix_dynamic(Module &module);
+  void get_table_range(Module &module, uint64_t &start, uint64_t &end);
+  bool to_image(Module &module, Read &read);
+
+  int pid;
+  std::vector<Mapping> mappings;
+  std::vector<Module> modules;
+  std::vector<Thread> threads;
+
+  struct timespec stop_time;
+  uint64_t stop_usec;
+
+  // read_memory() can be called from several threads at once.
+  std::atomic<uint64_t> read_calls;
+  std::atomic<uint64_t> read_ranges;
+  std::atomic<uint64_t> read_bytes;
+};
+
+#endif
+
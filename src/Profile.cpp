@@ -0,0 +1,486 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include <algorithm>
+
+#include "defines.h"
+#include "Profile.h"
+
+#define HOT_PERCENT 90
+#define TOP_COUNT 20
+
+int Profile::print(
+  const char *filename,
+  const char *samples_filename,
+  const char *ordering_filename,
+  const char *base,
+  Demangle *demangle)
+{
+  Elf *elf = Elf::open_elf(filename);
+
+  if (elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  const char *dso = strrchr(filename, '/');
+  dso = dso == NULL ? filename : dso + 1;
+
+  std::vector<uint64_t> samples;
+  std::vector<Function> functions;
+
+  if (read_samples(samples_filename, elf, dso, base, samples) != 0 ||
+      read_functions(elf, functions) != 0)
+  {
+    delete elf;
+    return -1;
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  // Both lists are sorted by address so symbolizing is one merge pass.
+  // Functions don't overlap after read_functions().
+  std::vector<uint64_t> hits;
+  uint64_t unknown = 0;
+  size_t f = 0;
+
+  for (uint64_t address : samples)
+  {
+    while (f < functions.size() &&
+           functions[f].address + functions[f].size <= address)
+    {
+      f++;
+    }
+
+    if (f < functions.size() && address >= functions[f].address)
+    {
+      functions[f].samples++;
+      hits.push_back(address);
+    }
+      else
+    {
+      unknown++;
+    }
+  }
+
+  std::sort(functions.begin(), functions.end(),
+    [](const Function &a, const Function &b)
+    {
+      return a.samples > b.samples;
+    });
+
+  while (functions.size() != 0 && functions.back().samples == 0)
+  {
+    functions.pop_back();
+  }
+
+  std::vector<const char *> names;
+
+  for (auto &function : functions) { names.push_back(function.name); }
+
+  if (demangle != nullptr) { demangle->demangle_batch(names); }
+
+  printf("Profile: %" PRIu64 " samples, %" PRIu64 " in %d functions, %"
+         PRIu64 " outside any function\n\n",
+    (uint64_t)samples.size(),
+    (uint64_t)hits.size(),
+    (int)functions.size(),
+    unknown);
+
+  printf("%10s %6s %6s %8s  %s\n", "samples", "%", "cum%", "size", "function");
+
+  uint64_t total = 0;
+  uint64_t ideal_bytes = 0;
+
+  for (int n = 0; n < (int)functions.size(); n++)
+  {
+    const bool hot = total * 100 < hits.size() * HOT_PERCENT;
+
+    total += functions[n].samples;
+
+    // What the hot functions would take if they were packed together.
+    if (hot) { ideal_bytes += functions[n].size; }
+
+    if (n >= TOP_COUNT) { continue; }
+
+    printf("%10" PRIu64 " %5.1f%% %5.1f%% %8" PRIu64 "  %s\n",
+      functions[n].samples,
+      (double)functions[n].samples * 100 / hits.size(),
+      (double)total * 100 / hits.size(),
+      functions[n].size,
+      names[n]);
+  }
+
+  printf("\n");
+
+  print_pages(hits, 12, "4KB", ideal_bytes);
+  print_pages(hits, 21, "2MB", ideal_bytes);
+
+  if (ordering_filename != nullptr)
+  {
+    FILE *out = fopen(ordering_filename, "w");
+
+    if (out == NULL)
+    {
+      printf("Error: Cannot open %s for writing\n", ordering_filename);
+      delete elf;
+      return -1;
+    }
+
+    // Mangled names, hottest first, the way lld/gold want them.
+    for (auto &function : functions)
+    {
+      fprintf(out, "%s\n", function.name);
+    }
+
+    fclose(out);
+
+    printf("Wrote %d functions to %s\n\n",
+      (int)functions.size(), ordering_filename);
+  }
+
+  delete elf;
+
+  return 0;
+}
+
+int Profile::read_samples(
+  const char *filename,
+  Elf *elf,
+  const char *dso,
+  const char *base,
+  std::vector<uint64_t> &samples)
+{
+  FILE *in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  // Samples are run time addresses. The load bias is taken away from
+  // them so they line up with the symbol table: -base is the start of
+  // the first mapping of the file (as in /proc/<pid>/maps), otherwise
+  // perf's mmap records are used when the script has them. Binaries
+  // that aren't PIE have a bias of 0.
+  uint64_t bias = 0;
+
+  if (base != nullptr)
+  {
+    for (int count = 0; count < elf->get_program_count(); count++)
+    {
+      Program program;
+      elf->get_program(count, program);
+
+      if (program.p_type != PT_LOAD) { continue; }
+
+      bias = strtoull(base, NULL, 16) - (program.p_vaddr & ~0xfffULL);
+      break;
+    }
+  }
+
+  char buffer[4096];
+  int length = fread(buffer, 1, sizeof(buffer), in);
+
+  // A NUL byte means a raw list of 64 bit little endian addresses.
+  if (memchr(buffer, 0, length) != NULL)
+  {
+    fseek(in, 0, SEEK_SET);
+
+    uint64_t address[512];
+    int count;
+
+    while ((count = fread(address, 8, 512, in)) > 0)
+    {
+      for (int n = 0; n < count; n++)
+      {
+        samples.push_back(address[n] - bias);
+      }
+    }
+
+    fclose(in);
+
+    return 0;
+  }
+
+  fseek(in, 0, SEEK_SET);
+
+  // perf script output. A sample is either one line ending in
+  // "address sym (dso)", or with callchains (-g) a header line followed
+  // by one tab indented "address sym (dso)" line per frame and a blank
+  // line. Only the first frame is the sampled address, the rest are
+  // callers. The address is the last hex number before the "(dso)"
+  // (periods and pids come before it) and tokens of only a-f letters are
+  // taken to be symbol names. Samples in a different DSO are skipped.
+  char line[4096];
+  bool in_callchain = false;
+  bool have_ip = false;
+
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    if (strstr(line, "PERF_RECORD_MMAP") != NULL)
+    {
+      if (base == nullptr) { read_mmap(line, elf, dso, bias); }
+      continue;
+    }
+
+    const char *first = line + strspn(line, " \t\r\n");
+
+    if (*first == 0)
+    {
+      in_callchain = false;
+      continue;
+    }
+
+    // Frame lines start with the address, header lines with the command.
+    if (first[0] == '0' && first[1] == 'x') { first += 2; }
+
+    const int digits = strspn(first, "0123456789abcdefABCDEF");
+    const bool is_frame = digits != 0 && isspace(first[digits]);
+
+    char *open = strrchr(line, '(');
+
+    if (!is_frame)
+    {
+      // A header line with no "(dso)" has a callchain after it.
+      if (open == NULL)
+      {
+        in_callchain = true;
+        have_ip = false;
+        continue;
+      }
+
+      in_callchain = false;
+    }
+      else
+    if (in_callchain)
+    {
+      if (have_ip) { continue; }
+      have_ip = true;
+    }
+
+    if (open != NULL)
+    {
+      const char *close = strchr(open, ')');
+
+      if (close != NULL && dso != nullptr && !is_dso(open + 1, close, dso))
+      {
+        continue;
+      }
+
+      *open = 0;
+    }
+
+    const char *address = NULL;
+
+    for (char *token = strtok(line, " \t\r\n:"); token != NULL;
+         token = strtok(NULL, " \t\r\n:"))
+    {
+      if (token[0] == '0' && token[1] == 'x') { token += 2; }
+
+      int digits = 0;
+      bool has_digit = false;
+
+      for (; isxdigit(token[digits]); digits++)
+      {
+        if (isdigit(token[digits])) { has_digit = true; }
+      }
+
+      if (digits >= 4 && token[digits] == 0 && has_digit) { address = token; }
+    }
+
+    if (address != NULL)
+    {
+      samples.push_back(strtoull(address, NULL, 16) - bias);
+    }
+  }
+
+  fclose(in);
+
+  return 0;
+}
+
+void Profile::read_mmap(const char *line, Elf *elf, const char *dso, uint64_t &bias)
+{
+  // PERF_RECORD_MMAP 1/1: [0x400000(0x1000) @ 0 ...]: x /path
+  // PERF_RECORD_MMAP2 1/1: [0x55d0(0x1000) @ 0x1000 08:01 12 0]: r-xp /path
+  const char *open = strchr(line, '[');
+  const char *at = strchr(line, '@');
+  const char *close = strstr(line, "]: ");
+
+  if (open == NULL || at == NULL || close == NULL) { return; }
+
+  const char *perms = close + 3;
+  const char *space = strchr(perms, ' ');
+
+  if (space == NULL) { return; }
+
+  const char *path = space + 1;
+  const char *end = path + strcspn(path, "\r\n");
+
+  if (memchr(perms, 'x', space - perms) == NULL) { return; }
+  if (dso != nullptr && !is_dso(path, end, dso)) { return; }
+
+  const uint64_t start = strtoull(open + 1, NULL, 16);
+  const uint64_t file_offset = strtoull(at + 1, NULL, 16);
+
+  for (int count = 0; count < elf->get_program_count(); count++)
+  {
+    Program program;
+    elf->get_program(count, program);
+
+    if (program.p_type != PT_LOAD) { continue; }
+
+    if (file_offset >= (program.p_offset & ~0xfffULL) &&
+        file_offset < program.p_offset + program.p_filesz)
+    {
+      bias = start - (program.p_vaddr - program.p_offset + file_offset);
+      return;
+    }
+  }
+}
+
+bool Profile::is_dso(const char *path, const char *end, const char *dso)
+{
+  const char *name = path;
+
+  for (const char *s = path; s < end; s++)
+  {
+    if (*s == '/') { name = s + 1; }
+  }
+
+  return (int)strlen(dso) == end - name && strncmp(name, dso, end - name) == 0;
+}
+
+int Profile::read_functions(Elf *elf, std::vector<Function> &functions)
+{
+  Section section;
+  Symbols symbols;
+
+  if (elf->find_symbol_table(section) < 0 ||
+      elf->read_symbols(section, symbols) != 0)
+  {
+    printf("Error: No symbol table\n");
+    return -1;
+  }
+
+  for (uint64_t n = 0; n < symbols.size(); n++)
+  {
+    if ((symbols.st_info[n] & 0xf) != 2 || symbols.st_shndx[n] == 0)
+    {
+      continue;
+    }
+
+    Function function;
+    function.address = symbols.st_value[n];
+    function.size = symbols.st_size[n];
+    function.name = symbols.get_name(n);
+    function.samples = 0;
+
+    functions.push_back(function);
+  }
+
+  std::sort(functions.begin(), functions.end(),
+    [](const Function &a, const Function &b)
+    {
+      if (a.address != b.address) { return a.address < b.address; }
+      return a.size > b.size;
+    });
+
+  // Aliases (same address) and zero sized symbols get merged into the
+  // function before them so each address maps to one function.
+  std::vector<Function> merged;
+
+  for (auto &function : functions)
+  {
+    if (merged.size() != 0 && function.address < merged.back().address + merged.back().size)
+    {
+      continue;
+    }
+
+    if (function.size == 0) { continue; }
+
+    merged.push_back(function);
+  }
+
+  functions.swap(merged);
+
+  return 0;
+}
+
+void Profile::print_pages(
+  std::vector<uint64_t> &samples,
+  int shift,
+  const char *name,
+  uint64_t ideal_bytes)
+{
+  // samples is sorted, so each page's samples are next to each other.
+  std::vector<std::pair<uint64_t, uint64_t>> pages;
+
+  for (uint64_t address : samples)
+  {
+    const uint64_t page = address >> shift;
+
+    if (pages.size() != 0 && pages.back().first == page)
+    {
+      pages.back().second++;
+    }
+      else
+    {
+      pages.push_back(std::make_pair(page, 1));
+    }
+  }
+
+  std::sort(pages.begin(), pages.end(),
+    [](const std::pair<uint64_t, uint64_t> &a,
+       const std::pair<uint64_t, uint64_t> &b)
+    {
+      return a.second > b.second;
+    });
+
+  uint64_t total = 0;
+  int hot_pages = 0;
+
+  while (hot_pages < (int)pages.size() && total * 100 < samples.size() * HOT_PERCENT)
+  {
+    total += pages[hot_pages++].second;
+  }
+
+  const uint64_t page_size = 1ULL << shift;
+
+  printf("%s pages\n", name);
+  printf("---------------------------------------------\n");
+  printf("  pages with samples: %d\n", (int)pages.size());
+  printf("  pages holding %d%% of samples: %d (%" PRIu64 " if the hot functions"
+         " were packed together)\n",
+    HOT_PERCENT,
+    hot_pages,
+    (ideal_bytes + page_size - 1) / page_size);
+
+  for (int n = 0; n < (int)pages.size() && n < 10; n++)
+  {
+    printf("    0x%016" PRIx64 " %10" PRIu64 " %5.1f%%\n",
+      pages[n].first << shift,
+      pages[n].second,
+      (double)pages[n].second * 100 / samples.size());
+  }
+
+  printf("\n");
+}
+
@@ -0,0 +1,70 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_PROFILE_H
+#define MAGIC_ELF_PROFILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+
+// Symbolize sampled instruction addresses (perf script output or a raw
+// file of 64 bit addresses) against an ELF file's function symbols and
+// show how spread out the hot code is: samples per function, per 4KB
+// and per 2MB page, and how many pages hold 90% of the samples. The hot
+// functions can be written out as a linker --symbol-ordering-file.
+// Addresses are moved back by the load bias (given, or from perf's mmap
+// records) and with callchains only the sampled frame is counted.
+class Profile
+{
+public:
+  static int print(
+    const char *filename,
+    const char *samples_filename,
+    const char *ordering_filename,
+    const char *base,
+    Demangle *demangle);
+
+  static int read_samples(
+    const char *filename,
+    Elf *elf,
+    const char *dso,
+    const char *base,
+    std::vector<uint64_t> &samples);
+
+private:
+  Profile();
+  ~Profile();
+
+  struct Function
+  {
+    uint64_t address;
+    uint64_t size;
+    const char *name;
+    uint64_t samples;
+  };
+
+  static void read_mmap(const char *line, Elf *elf, const char *dso, uint64_t &bias);
+  static bool is_dso(const char *path, const char *end, const char *dso);
+  static int read_functions(Elf *elf, std::vector<Function> &functions);
+
+  static void print_pages(
+    std::vector<uint64_t> &samples,
+    int shift,
+    const char *name,
+    uint64_t ideal_bytes);
+};
+
+#endif
+
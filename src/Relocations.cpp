@@ -0,0 +1,97 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "defines.h"
+#include "Relocations.h"
+
+const char *Relocations::get_type_name(int e_machine, uint32_t type)
+{
+  const char *x86_32_types[] =
+  {
+    "NONE",          "386_32",        "PC32",          "GOT32",
+    "PLT32",         "COPY",          "GLOB_DAT",      "JMP_SLOT",
+    "RELATIVE",      "GOTOFF",        "GOTPC",         "32PLT",
+    NULL,            NULL,            "TLS_TPOFF",     "TLS_IE",
+    "TLS_GOTIE",     "TLS_LE",        "TLS_GD",        "TLS_LDM",
+    "16",            "PC16",          "8",             "PC8",
+    "TLS_GD_32",     "TLS_GD_PUSH",   "TLS_GD_CALL",   "TLS_GD_POP",
+    "TLS_LDM_32",    "TLS_LDM_PUSH",  "TLS_LDM_CALL",  "TLS_LDM_POP",
+    "TLS_LDO_32",    "TLS_IE_32",     "TLS_LE_32",     "TLS_DTPMOD32",
+    "TLS_DTPOFF32",  "TLS_TPOFF32",   "SIZE32",        "TLS_GOTDESC",
+    "TLS_DESC_CALL", "TLS_DESC",      "IRELATIVE",     "GOT32X",
+  };
+
+  const char *x86_64_types[] =
+  {
+    "NONE",          "64",            "PC32",          "GOT32",
+    "PLT32",         "COPY",          "GLOB_DAT",      "JUMP_SLOT",
+    "RELATIVE",      "GOTPCREL",      "32",            "32S",
+    "16",            "PC16",          "8",             "PC8",
+    "DTPMOD64",      "DTPOFF64",      "TPOFF64",       "TLSGD",
+    "TLSLD",         "DTPOFF32",      "GOTTPOFF",      "TPOFF32",
+    "PC64",          "GOTOFF64",      "GOTPC32",       "GOT64",
+    "GOTPCREL64",    "GOTPC64",       "GOTPLT64",      "PLTOFF64",
+    "SIZE32",        "SIZE64",        "GOTPC32_TLSDESC", "TLSDESC_CALL",
+    "TLSDESC",       "IRELATIVE",     "RELATIVE64",    NULL,
+    NULL,            "GOTPCRELX",     "REX_GOTPCRELX",
+  };
+
+  const char *name = NULL;
+
+  switch (e_machine)
+  {
+    case EM_X86_32:
+      if (type < sizeof(x86_32_types) / sizeof(char *))
+      {
+        name = x86_32_types[type];
+      }
+      break;
+    case EM_X86_64:
+      if (type < sizeof(x86_64_types) / sizeof(char *))
+      {
+        name = x86_64_types[type];
+      }
+      break;
+    default:
+      break;
+  }
+
+  return name == NULL ? "" : name;
+}
+
+int Relocations::get_kind(int e_machine, uint32_t type, uint32_t sym)
+{
+  if (type == 0) { return KIND_NONE; }
+
+  switch (e_machine)
+  {
+    case EM_X86_32:
+      if (type == 8)  { return KIND_RELATIVE; }
+      if (type == 42) { return KIND_IRELATIVE; }
+      if (type == 7)  { return KIND_JUMP_SLOT; }
+      if (type == 5)  { return KIND_COPY; }
+      break;
+    case EM_X86_64:
+      if (type == 8 || type == 38) { return KIND_RELATIVE; }
+      if (type == 37) { return KIND_IRELATIVE; }
+      if (type == 7)  { return KIND_JUMP_SLOT; }
+      if (type == 5)  { return KIND_COPY; }
+      break;
+    default:
+      break;
+  }
+
+  // Anything else only needs a symbol lookup if it names a symbol.
+  return sym == 0 ? KIND_RELATIVE : KIND_SYMBOLIC;
+}
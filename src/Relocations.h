@@ -0,0 +1,61 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_RELOCATIONS_H
+#define MAGIC_ELF_RELOCATIONS_H
+
+#include <stdint.h>
+#include <vector>
+
+// All entries of one SHT_REL / SHT_RELA section decoded into columns.
+struct Relocations
+{
+  Relocations() :
+    is_rela { false }
+  {
+  }
+
+  ~Relocations()
+  {
+  }
+
+  void clear()
+  {
+    r_offset.clear();
+    r_sym.clear();
+    r_type.clear();
+    r_addend.clear();
+  }
+
+  uint64_t size() const { return r_offset.size(); }
+
+  enum
+  {
+    KIND_NONE,
+    KIND_RELATIVE,
+    KIND_IRELATIVE,
+    KIND_JUMP_SLOT,
+    KIND_COPY,
+    KIND_SYMBOLIC
+  };
+
+  static const char *get_type_name(int e_machine, uint32_t type);
+  static int get_kind(int e_machine, uint32_t type, uint32_t sym);
+
+  bool is_rela;
+  std::vector<uint64_t> r_offset;
+  std::vector<uint32_t> r_sym;
+  std::vector<uint32_t> r_type;
+  std::vector<int64_t> r_addend;
+};
+
+#endif
+
@@ -0,0 +1,130 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "GnuHash.h"
+#include "Resolver.h"
+
+Resolver::Resolver()
+{
+}
+
+Resolver::~Resolver()
+{
+}
+
+int Resolver::load(const char *filename)
+{
+  modules.clear();
+  definition_cache.clear();
+
+  return library_cache.load_closure(filename, modules);
+}
+
+int Resolver::resolve(const char *name, std::vector<Definition> &definitions)
+{
+  auto iter = definition_cache.find(name);
+
+  if (iter != definition_cache.end())
+  {
+    definitions = iter->second;
+    return definitions.size();
+  }
+
+  const uint32_t h1 = GnuHash::hash(name);
+
+  definitions.clear();
+
+  for (int n = 0; n < (int)modules.size(); n++)
+  {
+    Definition definition;
+
+    definition.index = modules[n].elf->find_dynamic_symbol(
+      name, h1, definition.symbol);
+
+    if (definition.index < 0 || definition.symbol.st_shndx == 0) { continue; }
+
+    definition.module = n;
+    definitions.push_back(definition);
+  }
+
+  definition_cache[name] = definitions;
+
+  return definitions.size();
+}
+
+void Resolver::print_resolve(const char *name)
+{
+  std::vector<Definition> definitions;
+
+  resolve(name, definitions);
+
+  printf("%s\n", name);
+
+  if (definitions.size() == 0)
+  {
+    printf("  (not defined)\n");
+    return;
+  }
+
+  for (int n = 0; n < (int)definitions.size(); n++)
+  {
+    Definition &definition = definitions[n];
+
+    printf("  %-11s 0x%08" PRIx64 " %6" PRId64 " %-6s %-6s %s\n",
+      n == 0 ? "defined" : "interposed",
+      definition.symbol.st_value,
+      definition.symbol.st_size,
+      definition.symbol.get_symbol_type(),
+      definition.symbol.get_symbol_binding(),
+      modules[definition.module].path.c_str());
+  }
+}
+
+int Resolver::print_resolve_list(const char *names)
+{
+  char name[1024];
+
+  if (strcmp(names, "-") == 0)
+  {
+    // One name per line from stdin, for large batches.
+    while (fgets(name, sizeof(name), stdin) != NULL)
+    {
+      name[strcspn(name, "\r\n")] = 0;
+      if (name[0] != 0) { print_resolve(name); }
+    }
+
+    return 0;
+  }
+
+  while (*names != 0)
+  {
+    int length = strcspn(names, ",");
+
+    if (length > 0 && length < (int)sizeof(name))
+    {
+      memcpy(name, names, length);
+      name[length] = 0;
+      print_resolve(name);
+    }
+
+    names += length;
+    if (*names == ',') { names++; }
+  }
+
+  return 0;
+}
+
@@ -0,0 +1,61 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_RESOLVER_H
+#define MAGIC_ELF_RESOLVER_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "LibraryCache.h"
+#include "Symbol.h"
+
+// An executable and its DT_NEEDED closure in load order. Symbol names
+// are looked up in every module's hash table (the GNU hash is computed
+// once per name and shared by all modules), so the first definition is
+// the one ld.so binds to and any later ones are interposed by it.
+class Resolver
+{
+public:
+  Resolver();
+  ~Resolver();
+
+  struct Definition
+  {
+    int module;
+    int index;
+    Symbol symbol;
+  };
+
+  int load(const char *filename);
+  int resolve(const char *name, std::vector<Definition> &definitions);
+  void print_resolve(const char *name);
+  int print_resolve_list(const char *names);
+
+  int get_module_count() { return modules.size(); }
+
+  const char *get_module_path(int index)
+  {
+    return modules[index].path.c_str();
+  }
+
+  Elf *get_module_elf(int index) { return modules[index].elf; }
+
+private:
+  LibraryCache library_cache;
+  std::vector<LibraryCache::Module> modules;
+  std::map<std::string, std::vector<Definition>> definition_cache;
+};
+
+#endif
+
@@ -33,6 +33,7 @@ const char *Section::get_section_type()
     case 17:         return "(SHT_GROUP)";
     case 18:         return "(SHT_SYMTAB_SHNDX)";
     case 0x60000000: return "(SHT_LOOS)";
+    case 0x6ffffff6: return "(SHT_GNU_HASH)";
     case 0x6fffffff: return "(SHT_HIOS)";
     case 0x70000000: return "(SHT_LOPROC)";
     case 0x7fffffff: return "(SHT_HIPROC)";
@@ -56,6 +57,7 @@ std::string Section::get_flags_type()
   if ((sh_flags & 0x00000100) != 0) { value += "SHF_OS_NONCONFORMING "; }
   if ((sh_flags & 0x00000200) != 0) { value += "SHF_GROUP "; }
   if ((sh_flags & 0x00000400) != 0) { value += "SHF_TLS "; }
+  if ((sh_flags & 0x00000800) != 0) { value += "SHF_COMPRESSED "; }
   if ((sh_flags & 0x0ff00000) != 0) { value += "SHF_MASKOS "; }
   if ((sh_flags & 0xf0000000) != 0) { value += "SHF_MASKPROC "; }
 
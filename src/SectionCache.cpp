@@ -0,0 +1,65 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdint.h>
+
+#include "SectionCache.h"
+
+SectionCache::SectionCache() :
+  bytes { 0 },
+  clock { 0 }
+{
+}
+
+SectionCache::~SectionCache()
+{
+}
+
+SectionCache::Buffer SectionCache::get(uint64_t offset)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto iter = entries.find(offset);
+
+  if (iter == entries.end()) { return Buffer(); }
+
+  iter->second.last_used = ++clock;
+
+  return iter->second.buffer;
+}
+
+void SectionCache::put(uint64_t offset, Buffer buffer)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (entries.find(offset) != entries.end()) { return; }
+
+  bytes += buffer->size();
+
+  while (bytes > max_bytes && entries.size() != 0)
+  {
+    auto oldest = entries.begin();
+
+    for (auto iter = entries.begin(); iter != entries.end(); iter++)
+    {
+      if (iter->second.last_used < oldest->second.last_used)
+      {
+        oldest = iter;
+      }
+    }
+
+    bytes -= oldest->second.buffer->size();
+    entries.erase(oldest);
+  }
+
+  entries[offset] = { buffer, ++clock };
+}
+
@@ -0,0 +1,51 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_SECTION_CACHE_H
+#define MAGIC_ELF_SECTION_CACHE_H
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Decompressed contents of SHF_COMPRESSED sections keyed by sh_offset.
+// Least recently used buffers are dropped once the total goes over
+// max_bytes.
+class SectionCache
+{
+public:
+  SectionCache();
+  ~SectionCache();
+
+  typedef std::shared_ptr<std::vector<uint8_t> > Buffer;
+
+  Buffer get(uint64_t offset);
+  void put(uint64_t offset, Buffer buffer);
+
+private:
+  struct Entry
+  {
+    Buffer buffer;
+    uint64_t last_used;
+  };
+
+  static const uint64_t max_bytes = 256 * 1024 * 1024;
+
+  std::map<uint64_t, Entry> entries;
+  uint64_t bytes;
+  uint64_t clock;
+  std::mutex mutex;
+};
+
+#endif
+
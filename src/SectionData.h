@@ -0,0 +1,44 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_SECTION_DATA_H
+#define MAGIC_ELF_SECTION_DATA_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+// Contents of a section. For SHF_COMPRESSED sections data points into
+// a decompressed buffer which stays valid while this holds a reference
+// to it, even if the cache has since dropped it.
+struct SectionData
+{
+  SectionData() :
+    data            { nullptr },
+    size            { 0 },
+    compressed_size { 0 },
+    compression     { 0 }
+  {
+  }
+
+  ~SectionData()
+  {
+  }
+
+  const uint8_t *data;
+  uint64_t size;
+  uint64_t compressed_size;
+  uint32_t compression;
+  std::shared_ptr<std::vector<uint8_t> > decompressed;
+};
+
+#endif
+
@@ -0,0 +1,396 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <vector>
+
+#include "Server.h"
+
+Server::Server(int max_open) :
+  max_open { max_open < 1 ? 1 : max_open },
+  hits     { 0 },
+  misses   { 0 }
+{
+}
+
+Server::~Server()
+{
+}
+
+int Server::run(const char *socket_path)
+{
+  struct sockaddr_un address;
+
+  if (strlen(socket_path) >= sizeof(address.sun_path))
+  {
+    printf("Error: Socket path is too long.\n");
+    return -1;
+  }
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (listen_fd == -1)
+  {
+    printf("Error: Cannot create socket.\n");
+    return -1;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+
+  // Only a stale socket gets replaced, never some other file.
+  struct stat stat_buf;
+
+  if (lstat(socket_path, &stat_buf) == 0)
+  {
+    if (!S_ISSOCK(stat_buf.st_mode))
+    {
+      printf("Error: %s exists and isn't a socket.\n", socket_path);
+      close(listen_fd);
+      return -1;
+    }
+
+    unlink(socket_path);
+  }
+
+  if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(listen_fd, 128) != 0)
+  {
+    printf("Error: Cannot listen on %s (%s)\n", socket_path, strerror(errno));
+    close(listen_fd);
+    return -1;
+  }
+
+  printf("Listening on %s (max_open=%d)\n", socket_path, max_open);
+  fflush(stdout);
+
+  while (true)
+  {
+    int fd = accept(listen_fd, NULL, NULL);
+
+    if (fd == -1)
+    {
+      if (errno == EINTR || errno == ECONNABORTED) { continue; }
+
+      printf("Error: accept() failed (%s)\n", strerror(errno));
+      break;
+    }
+
+    std::thread(&Server::serve, this, fd).detach();
+  }
+
+  close(listen_fd);
+  unlink(socket_path);
+
+  return -1;
+}
+
+void Server::serve(int fd)
+{
+  std::string request;
+  std::string response;
+  std::vector<uint8_t> output;
+
+  while (true)
+  {
+    uint8_t length[4];
+
+    if (read_all(fd, length, 4) != 0) { break; }
+
+    const uint32_t request_length =
+      length[0] | (length[1] << 8) | (length[2] << 16) | (length[3] << 24);
+
+    if (request_length > max_request) { break; }
+
+    request.resize(request_length);
+
+    if (read_all(fd, &request[0], request_length) != 0) { break; }
+
+    handle_request(request, response);
+
+    // Length and text go out in one write.
+    const uint32_t response_length = response.size();
+
+    output.resize(4 + response_length);
+    output[0] = response_length & 0xff;
+    output[1] = (response_length >> 8) & 0xff;
+    output[2] = (response_length >> 16) & 0xff;
+    output[3] = (response_length >> 24) & 0xff;
+    memcpy(output.data() + 4, response.data(), response_length);
+
+    if (write_all(fd, output.data(), output.size()) != 0) { break; }
+  }
+
+  close(fd);
+}
+
+void Server::handle_request(const std::string &request, std::string &response)
+{
+  char text[256];
+  std::vector<std::string> fields;
+  size_t start = 0;
+
+  while (start < request.size())
+  {
+    size_t end = request.find(' ', start);
+
+    if (end == std::string::npos) { end = request.size(); }
+    if (end != start) { fields.push_back(request.substr(start, end - start)); }
+
+    start = end + 1;
+  }
+
+  if (fields.size() == 0)
+  {
+    response = "error empty request";
+    return;
+  }
+
+  const std::string &command = fields[0];
+
+  if (command == "stats")
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    snprintf(text, sizeof(text), "ok open=%d hits=%" PRIu64 " misses=%" PRIu64,
+      (int)lru.size(), hits, misses);
+    response = text;
+    return;
+  }
+
+  const size_t arguments =
+    command == "register" ? 4 :
+    command == "symbol" || command == "address" || command == "offset" ? 3 :
+    0;
+
+  if (arguments == 0)
+  {
+    response = "error unknown command " + command;
+    return;
+  }
+
+  if (fields.size() != arguments)
+  {
+    response = "error wrong number of arguments for " + command;
+    return;
+  }
+
+  std::string error;
+  FilePtr file = get_file(fields[1], error);
+
+  if (!file)
+  {
+    response = "error " + error;
+    return;
+  }
+
+  magic_elf_t *handle = file->handle;
+  struct magic_elf_symbol symbol;
+
+  if (command == "symbol")
+  {
+    if (magic_elf_find_symbol(handle, fields[2].c_str(), &symbol) != 0)
+    {
+      response = "error symbol not found";
+      return;
+    }
+
+    const int64_t offset = magic_elf_address_to_offset(handle, symbol.value);
+
+    snprintf(text, sizeof(text), "ok 0x%" PRIx64 " 0x%" PRIx64 " 0x%" PRIx64,
+      symbol.value, symbol.size, offset < 0 ? 0 : (uint64_t)offset);
+    response = text;
+  }
+    else
+  if (command == "address")
+  {
+    const uint64_t address = strtoull(fields[2].c_str(), NULL, 16);
+    uint64_t offset;
+
+    if (magic_elf_find_address(handle, address, &symbol, &offset) != 0)
+    {
+      response = "error no symbol at address";
+      return;
+    }
+
+    snprintf(text, sizeof(text), " 0x%" PRIx64, offset);
+    response = "ok ";
+    response += symbol.name;
+    response += text;
+  }
+    else
+  if (command == "offset")
+  {
+    const uint64_t address = strtoull(fields[2].c_str(), NULL, 16);
+    const int64_t offset = magic_elf_address_to_offset(handle, address);
+
+    if (offset < 0)
+    {
+      response = "error address not in file";
+      return;
+    }
+
+    snprintf(text, sizeof(text), "ok 0x%" PRIx64, (uint64_t)offset);
+    response = text;
+  }
+    else
+  {
+    const int pid = atoi(fields[2].c_str());
+    const int count = magic_elf_get_thread_count(handle);
+    uint64_t value;
+    int thread;
+
+    for (thread = 0; thread < count; thread++)
+    {
+      if (magic_elf_get_thread_pid(handle, thread) == pid) { break; }
+    }
+
+    if (thread == count)
+    {
+      response = "error no thread with that pid";
+      return;
+    }
+
+    if (magic_elf_get_register(handle, thread, fields[3].c_str(), &value) != 0)
+    {
+      response = "error unknown register";
+      return;
+    }
+
+    snprintf(text, sizeof(text), "ok 0x%" PRIx64, value);
+    response = text;
+  }
+}
+
+Server::FilePtr Server::get_file(const std::string &path, std::string &error)
+{
+  struct stat stat_buf;
+
+  if (stat(path.c_str(), &stat_buf) != 0)
+  {
+    error = "cannot stat " + path;
+    return FilePtr();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto iter = files.find(path);
+
+    if (iter != files.end())
+    {
+      FilePtr file = iter->second->second;
+
+      if (file->dev == stat_buf.st_dev &&
+          file->ino == stat_buf.st_ino &&
+          file->size == stat_buf.st_size &&
+          file->mtime.tv_sec == stat_buf.st_mtim.tv_sec &&
+          file->mtime.tv_nsec == stat_buf.st_mtim.tv_nsec)
+      {
+        lru.splice(lru.begin(), lru, iter->second);
+        hits++;
+        return file;
+      }
+
+      // Rebuilt since it was opened. Anyone still using the old
+      // mapping keeps it alive until they're done.
+      lru.erase(iter->second);
+      files.erase(iter);
+    }
+
+    misses++;
+  }
+
+  // Opening and indexing happens outside the lock so a big file doesn't
+  // hold up queries on files that are already open.
+  FilePtr file(new File());
+
+  file->handle = magic_elf_open(path.c_str());
+
+  if (file->handle == nullptr)
+  {
+    error = "cannot open " + path;
+    return FilePtr();
+  }
+
+  magic_elf_load_indexes(file->handle);
+
+  file->dev = stat_buf.st_dev;
+  file->ino = stat_buf.st_ino;
+  file->size = stat_buf.st_size;
+  file->mtime = stat_buf.st_mtim;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Another thread may have opened it in the meantime.
+  auto iter = files.find(path);
+
+  if (iter != files.end()) { return iter->second->second; }
+
+  lru.push_front(std::make_pair(path, file));
+  files[path] = lru.begin();
+
+  while ((int)lru.size() > max_open)
+  {
+    files.erase(lru.back().first);
+    lru.pop_back();
+  }
+
+  return file;
+}
+
+int Server::read_all(int fd, void *data, uint32_t length)
+{
+  uint8_t *buffer = (uint8_t *)data;
+
+  while (length != 0)
+  {
+    ssize_t count = read(fd, buffer, length);
+
+    if (count < 0 && errno == EINTR) { continue; }
+    if (count <= 0) { return -1; }
+
+    buffer += count;
+    length -= count;
+  }
+
+  return 0;
+}
+
+int Server::write_all(int fd, const void *data, uint32_t length)
+{
+  const uint8_t *buffer = (const uint8_t *)data;
+
+  while (length != 0)
+  {
+    ssize_t count = send(fd, buffer, length, MSG_NOSIGNAL);
+
+    if (count < 0 && errno == EINTR) { continue; }
+    if (count <= 0) { return -1; }
+
+    buffer += count;
+    length -= count;
+  }
+
+  return 0;
+}
+
@@ -0,0 +1,81 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_SERVER_H
+#define MAGIC_ELF_SERVER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "magic_elf_lib.h"
+
+// Answers queries on a Unix domain socket so files only get mapped and
+// indexed once. Requests and responses are a 4 byte little endian
+// length followed by that many bytes of text:
+//
+//   symbol <file> <name>         ok <value> <size> <file offset>
+//   address <file> <address>     ok <name> <offset into symbol>
+//   offset <file> <address>      ok <file offset>
+//   register <file> <pid> <reg>  ok <value>
+//   stats                        ok open=<n> hits=<n> misses=<n>
+//
+// Numbers are hex. A failed query gets "error <message>". Each
+// connection is served by its own thread and the open files are shared
+// through an LRU. A file that changed on disk is opened again.
+class Server
+{
+public:
+  Server(int max_open = 256);
+  ~Server();
+
+  int run(const char *socket_path);
+  void handle_request(const std::string &request, std::string &response);
+
+private:
+  struct File
+  {
+    File() : handle { nullptr } { }
+    ~File() { if (handle != nullptr) { magic_elf_close(handle); } }
+
+    magic_elf_t *handle;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+  };
+
+  typedef std::shared_ptr<File> FilePtr;
+  typedef std::list<std::pair<std::string, FilePtr> > Lru;
+
+  void serve(int fd);
+  FilePtr get_file(const std::string &path, std::string &error);
+
+  static int read_all(int fd, void *data, uint32_t length);
+  static int write_all(int fd, const void *data, uint32_t length);
+
+  static const uint32_t max_request = 64 * 1024;
+
+  std::mutex mutex;
+  Lru lru;
+  std::unordered_map<std::string, Lru::iterator> files;
+  int max_open;
+  uint64_t hits;
+  uint64_t misses;
+};
+
+#endif
+
@@ -0,0 +1,281 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <algorithm>
+
+#include "defines.h"
+#include "Startup.h"
+
+int Startup::analyze(const char *filename)
+{
+  LibraryCache library_cache;
+  std::vector<LibraryCache::Module> modules;
+  std::map<std::string, Lookup> lookup_cache;
+
+  if (library_cache.load_closure(filename, modules) != 0)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  std::vector<Cost> costs(modules.size());
+
+  for (int n = 0; n < (int)modules.size(); n++)
+  {
+    Elf *elf = modules[n].elf;
+    Cost &cost = costs[n];
+    Relocations relocations;
+    uint64_t value;
+
+    cost.bind_now = elf->is_bind_now();
+    cost.symbolic_flag =
+      elf->get_dynamic(DT_SYMBOLIC, value) ||
+      (elf->get_dynamic(DT_FLAGS, value) && (value & DF_SYMBOLIC) != 0);
+
+    if (elf->read_dynamic_relocations(relocations, false) == 0)
+    {
+      count_relocations(modules, n, relocations, false, lookup_cache, cost);
+    }
+
+    if (elf->read_dynamic_relocations(relocations, true) == 0)
+    {
+      count_relocations(modules, n, relocations, true, lookup_cache, cost);
+    }
+
+    cost.relative += elf->get_relr_count();
+  }
+
+  // The dynamic loader is mapped no matter what, so don't suggest
+  // merging it into anything.
+  std::string interpreter;
+  Program program;
+
+  for (int n = 0; n < modules[0].elf->get_program_count(); n++)
+  {
+    modules[0].elf->get_program(n, program);
+
+    if (program.p_type == PT_INTERP)
+    {
+      char *path = realpath(modules[0].elf->get_cstring(program.p_offset), NULL);
+      if (path != NULL) { interpreter = path; free(path); }
+      break;
+    }
+  }
+
+  std::vector<int> order(modules.size());
+
+  for (int n = 0; n < (int)order.size(); n++) { order[n] = n; }
+
+  std::sort(order.begin(), order.end(),
+    [&costs](int a, int b) { return costs[a].get_cost() > costs[b].get_cost(); });
+
+  printf("Startup Cost (modules=%d)\n", (int)modules.size());
+  printf("---------------------------------------------\n");
+  printf("%10s %9s %9s %9s %7s %5s %8s %9s %7s  %s\n",
+    "cost", "relative", "irelative", "symbolic", "plt", "copy",
+    "lookups", "searched", "self", "library");
+
+  Cost total;
+
+  for (int n : order)
+  {
+    Cost &cost = costs[n];
+
+    printf("%10" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %7" PRIu64
+           " %5" PRIu64 " %8" PRIu64 " %9" PRIu64 " %7" PRIu64 "  %s%s\n",
+      cost.get_cost(),
+      cost.relative,
+      cost.irelative,
+      cost.symbolic,
+      cost.plt,
+      cost.copy,
+      cost.lookups,
+      cost.searched,
+      cost.self,
+      modules[n].path.c_str(),
+      cost.bind_now ? " (BIND_NOW)" : "");
+
+    total.relative += cost.relative;
+    total.irelative += cost.irelative;
+    total.symbolic += cost.symbolic;
+    total.plt += cost.plt;
+    total.copy += cost.copy;
+    total.lookups += cost.lookups;
+    total.searched += cost.searched;
+    total.self += cost.self;
+    total.unresolved += cost.unresolved;
+  }
+
+  printf("%10" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %7" PRIu64
+         " %5" PRIu64 " %8" PRIu64 " %9" PRIu64 " %7" PRIu64 "  (total)\n\n",
+    total.get_cost(),
+    total.relative,
+    total.irelative,
+    total.symbolic,
+    total.plt,
+    total.copy,
+    total.lookups,
+    total.searched,
+    total.self);
+
+  printf("  lookups: symbol lookups done at startup (lazy PLT slots excluded)\n");
+  printf(" searched: modules searched by those lookups\n");
+  printf("     self: lookups that resolved to the module doing them\n\n");
+
+  if (total.unresolved != 0)
+  {
+    printf("Unresolved lookups: %" PRIu64 " (weak or versioned symbols?)\n\n",
+      total.unresolved);
+  }
+
+  printf("Hints\n");
+  printf("---------------------------------------------\n");
+
+  for (int n : order)
+  {
+    Cost &cost = costs[n];
+    const char *path = modules[n].path.c_str();
+
+    if (cost.self != 0 && !cost.symbolic_flag && n != 0)
+    {
+      printf("  %s: -Bsymbolic would remove %" PRIu64 " of %" PRIu64
+             " lookups\n", path, cost.self, cost.lookups);
+    }
+
+    if (cost.relative > 1000 && cost.relative > cost.searched * 10 &&
+        modules[n].elf->get_relr_count() == 0)
+    {
+      printf("  %s: %" PRIu64 " relative relocations, prelink or link"
+             " with -z pack-relative-relocs\n", path, cost.relative);
+    }
+
+    if (cost.copy != 0)
+    {
+      printf("  %s: %" PRIu64 " copy relocations\n", path, cost.copy);
+    }
+
+    if (n != 0 && cost.get_cost() < 100 && modules.size() > 2 &&
+        modules[n].path != interpreter)
+    {
+      printf("  %s: small, candidate to merge into another module\n", path);
+    }
+  }
+
+  printf("\n");
+
+  return 0;
+}
+
+void Startup::count_relocations(
+  std::vector<LibraryCache::Module> &modules,
+  int index,
+  Relocations &relocations,
+  bool is_plt,
+  std::map<std::string, Lookup> &lookup_cache,
+  Cost &cost)
+{
+  Elf *elf = modules[index].elf;
+  uint32_t last_sym = 0;
+
+  for (uint64_t n = 0; n < relocations.size(); n++)
+  {
+    const uint32_t sym = relocations.r_sym[n];
+    const int kind =
+      Relocations::get_kind(elf->header.e_machine, relocations.r_type[n], sym);
+
+    switch (kind)
+    {
+      case Relocations::KIND_NONE:
+        continue;
+      case Relocations::KIND_RELATIVE:
+        cost.relative++;
+        continue;
+      case Relocations::KIND_IRELATIVE:
+        cost.irelative++;
+        continue;
+      case Relocations::KIND_JUMP_SLOT:
+        cost.plt++;
+        if (!cost.bind_now) { continue; }
+        break;
+      case Relocations::KIND_COPY:
+        cost.copy++;
+        break;
+      default:
+        if (is_plt) { cost.plt++; } else { cost.symbolic++; }
+        break;
+    }
+
+    // ld.so remembers the last symbol it looked up for a module.
+    if (sym == last_sym) { continue; }
+    last_sym = sym;
+
+    if (elf->dynsym_offset == 0) { continue; }
+
+    Symbol symbol;
+    elf->get_symbol(elf->dynsym_offset + (sym * elf->dynsym_entsize), symbol);
+
+    std::string name = elf->get_dynamic_string(symbol.st_name);
+
+    Lookup result = lookup(
+      modules,
+      index,
+      name.c_str(),
+      cost.symbolic_flag,
+      lookup_cache);
+
+    cost.lookups++;
+    cost.searched += result.searched;
+
+    if (result.module == -1) { cost.unresolved++; }
+    if (result.module == index) { cost.self++; }
+  }
+}
+
+Startup::Lookup Startup::lookup(
+  std::vector<LibraryCache::Module> &modules,
+  int index,
+  const char *name,
+  bool self_first,
+  std::map<std::string, Lookup> &lookup_cache)
+{
+  Symbol symbol;
+
+  if (self_first && modules[index].elf->find_dynamic_symbol(name, symbol) >= 0)
+  {
+    return { index, 1 };
+  }
+
+  auto iter = lookup_cache.find(name);
+
+  if (iter != lookup_cache.end()) { return iter->second; }
+
+  Lookup result = { -1, (int)modules.size() };
+
+  for (int n = 0; n < (int)modules.size(); n++)
+  {
+    if (modules[n].elf->find_dynamic_symbol(name, symbol) >= 0 &&
+        symbol.st_shndx != 0)
+    {
+      result = { n, n + 1 };
+      break;
+    }
+  }
+
+  lookup_cache[name] = result;
+
+  return result;
+}
+
@@ -0,0 +1,96 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_STARTUP_H
+#define MAGIC_ELF_STARTUP_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "LibraryCache.h"
+
+// Estimate how much work the dynamic loader does for an executable:
+// follow DT_NEEDED, then count every module's relocations by kind and
+// resolve its symbol lookups against the global scope the way ld.so
+// would to see how many modules each lookup searches.
+class Startup
+{
+public:
+  static int analyze(const char *filename);
+
+private:
+  Startup();
+  ~Startup();
+
+  struct Cost
+  {
+    Cost() :
+      relative   { 0 },
+      irelative  { 0 },
+      symbolic   { 0 },
+      plt        { 0 },
+      copy       { 0 },
+      lookups    { 0 },
+      self       { 0 },
+      searched   { 0 },
+      unresolved { 0 },
+      bind_now   { false },
+      symbolic_flag { false }
+    {
+    }
+
+    uint64_t get_cost() const
+    {
+      // A relative relocation is an add and a store. A lookup hashes the
+      // name and checks each module's bloom filter (and sometimes its
+      // chain), which is roughly an order of magnitude more per module.
+      return relative + (irelative * 20) + (searched * 10);
+    }
+
+    uint64_t relative;
+    uint64_t irelative;
+    uint64_t symbolic;
+    uint64_t plt;
+    uint64_t copy;
+    uint64_t lookups;
+    uint64_t self;
+    uint64_t searched;
+    uint64_t unresolved;
+    bool bind_now;
+    bool symbolic_flag;
+  };
+
+  struct Lookup
+  {
+    int module;
+    int searched;
+  };
+
+  static void count_relocations(
+    std::vector<LibraryCache::Module> &modules,
+    int index,
+    Relocations &relocations,
+    bool is_plt,
+    std::map<std::string, Lookup> &lookup_cache,
+    Cost &cost);
+
+  static Lookup lookup(
+    std::vector<LibraryCache::Module> &modules,
+    int index,
+    const char *name,
+    bool self_first,
+    std::map<std::string, Lookup> &lookup_cache);
+};
+
+#endif
+
@@ -0,0 +1,262 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "defines.h"
+#include "Elf.h"
+#include "Stream.h"
+
+int Stream::process(int fd, const char *copy_filename)
+{
+  std::vector<uint8_t> prefix;
+  Copy copy;
+
+  if (copy_filename != nullptr && open_copy(copy, copy_filename) != 0)
+  {
+    printf("Error: Cannot open %s for writing.\n", copy_filename);
+    return -1;
+  }
+
+  // ELF identification, then the rest of the header for this class.
+  if (read_to(fd, prefix, 16) != 0 ||
+      memcmp(prefix.data(), "\x7f" "ELF", 4) != 0)
+  {
+    printf("Error: Input is not an ELF file.\n");
+    close_copy(copy);
+    return -1;
+  }
+
+  if (read_to(fd, prefix, prefix[4] == 1 ? 52 : 64) != 0)
+  {
+    printf("Error: Truncated ELF header.\n");
+    close_copy(copy);
+    return -1;
+  }
+
+  Elf *elf = Elf::open_elf_from_mem(prefix.data(), prefix.size());
+
+  const uint64_t phdr_end =
+    elf->get_program_offset() +
+    ((uint64_t)elf->get_program_count() * elf->get_program_size());
+
+  delete elf;
+
+  if (phdr_end > max_prefix || read_to(fd, prefix, phdr_end) != 0)
+  {
+    printf("Error: Cannot read program headers.\n");
+    close_copy(copy);
+    return -1;
+  }
+
+  // Linux puts the notes right after the program headers, so reading
+  // up to the end of the last PT_NOTE keeps this to a few MB.
+  elf = Elf::open_elf_from_mem(prefix.data(), prefix.size());
+
+  uint64_t notes_end = phdr_end;
+
+  for (int count = 0; count < elf->get_program_count(); count++)
+  {
+    Program program;
+    elf->get_program(count, program);
+
+    if (program.p_type == PT_NOTE &&
+        program.p_offset + program.p_filesz > notes_end)
+    {
+      notes_end = program.p_offset + program.p_filesz;
+    }
+  }
+
+  delete elf;
+
+  // print_core_summary() walks the notes in place, so without them in
+  // the buffer there's nothing it can safely show.
+  const bool has_notes = notes_end <= max_prefix;
+
+  if (!has_notes)
+  {
+    printf("Warning: Notes end at 0x%" PRIx64 ", not buffering them.\n",
+      notes_end);
+    notes_end = phdr_end;
+  }
+
+  if (read_to(fd, prefix, notes_end) != 0)
+  {
+    printf("Error: Truncated core notes.\n");
+    close_copy(copy);
+    return -1;
+  }
+
+  if (has_notes)
+  {
+    elf = Elf::open_elf_from_mem(prefix.data(), prefix.size());
+    elf->print_core_summary();
+    delete elf;
+  }
+
+  fflush(stdout);
+
+  if (write_copy(copy, prefix.data(), prefix.size()) != 0)
+  {
+    printf("Error: Cannot write %s.\n", copy_filename);
+    close_copy(copy);
+    return -1;
+  }
+
+  uint64_t total = prefix.size();
+
+  prefix.clear();
+  prefix.shrink_to_fit();
+
+  std::vector<uint8_t> chunk(chunk_size);
+
+  while (true)
+  {
+    ssize_t n = read(fd, chunk.data(), chunk.size());
+
+    if (n == 0) { break; }
+
+    if (n < 0)
+    {
+      if (errno == EINTR) { continue; }
+      printf("Error: Read failed after %" PRIu64 " bytes.\n", total);
+      close_copy(copy);
+      return -1;
+    }
+
+    if (write_copy(copy, chunk.data(), n) != 0)
+    {
+      printf("Error: Cannot write %s.\n", copy_filename);
+      close_copy(copy);
+      return -1;
+    }
+
+    total += n;
+  }
+
+  printf("Read %" PRIu64 " bytes.\n", total);
+
+  if (copy_filename != nullptr)
+  {
+    if (close_copy(copy) != 0)
+    {
+      printf("Error: Cannot write %s.\n", copy_filename);
+      return -1;
+    }
+
+    printf("Wrote %s.\n", copy_filename);
+  }
+
+  return 0;
+}
+
+int Stream::read_to(int fd, std::vector<uint8_t> &prefix, uint64_t length)
+{
+  uint64_t ptr = prefix.size();
+
+  if (length <= ptr) { return 0; }
+
+  prefix.resize(length);
+
+  while (ptr < length)
+  {
+    ssize_t n = read(fd, prefix.data() + ptr, length - ptr);
+
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n <= 0) { return -1; }
+
+    ptr += n;
+  }
+
+  return 0;
+}
+
+int Stream::open_copy(Copy &copy, const char *filename)
+{
+  const int length = strlen(filename);
+
+  // A .gz name gets a compressed copy. Otherwise the copy is written
+  // sparse: pages of zeros are seeked over instead of written.
+  if (length > 3 && strcmp(filename + length - 3, ".gz") == 0)
+  {
+    copy.gz = gzopen(filename, "wb1");
+    return copy.gz == nullptr ? -1 : 0;
+  }
+
+  copy.fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+  return copy.fd == -1 ? -1 : 0;
+}
+
+int Stream::write_copy(Copy &copy, const uint8_t *data, uint64_t length)
+{
+  if (copy.gz != nullptr)
+  {
+    if (gzwrite(copy.gz, data, length) != (int)length) { return -1; }
+    copy.length += length;
+    return 0;
+  }
+
+  if (copy.fd == -1) { return 0; }
+
+  static const uint8_t zeros[page_size] = { 0 };
+  uint64_t ptr = 0;
+
+  while (ptr < length)
+  {
+    uint64_t size = length - ptr;
+    if (size > page_size) { size = page_size; }
+
+    if (size == page_size && memcmp(data + ptr, zeros, page_size) == 0)
+    {
+      if (lseek(copy.fd, page_size, SEEK_CUR) == -1) { return -1; }
+    }
+      else
+    {
+      if (write(copy.fd, data + ptr, size) != (ssize_t)size) { return -1; }
+    }
+
+    ptr += size;
+  }
+
+  copy.length += length;
+
+  return 0;
+}
+
+int Stream::close_copy(Copy &copy)
+{
+  int err = 0;
+
+  if (copy.gz != nullptr)
+  {
+    if (gzclose(copy.gz) != Z_OK) { err = -1; }
+    copy.gz = nullptr;
+  }
+
+  if (copy.fd != -1)
+  {
+    // Trailing holes don't extend the file on their own.
+    if (ftruncate(copy.fd, copy.length) != 0) { err = -1; }
+    if (close(copy.fd) != 0) { err = -1; }
+    copy.fd = -1;
+  }
+
+  return err;
+}
+
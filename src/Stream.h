@@ -0,0 +1,52 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_STREAM_H
+#define MAGIC_ELF_STREAM_H
+
+#include <stdint.h>
+#include <vector>
+#include <zlib.h>
+
+// Single pass processing of a core file arriving on a pipe (for example
+// from a core_pattern "|/usr/bin/magic_elf -stream" handler). Only the
+// ELF header, program headers and notes are kept in memory. The rest of
+// the core is copied through in fixed size chunks.
+class Stream
+{
+public:
+  static int process(int fd, const char *copy_filename);
+
+private:
+  Stream();
+  ~Stream();
+
+  struct Copy
+  {
+    Copy() : fd { -1 }, gz { nullptr }, length { 0 } { }
+
+    int fd;
+    gzFile gz;
+    uint64_t length;
+  };
+
+  static int read_to(int fd, std::vector<uint8_t> &prefix, uint64_t length);
+  static int open_copy(Copy &copy, const char *filename);
+  static int write_copy(Copy &copy, const uint8_t *data, uint64_t length);
+  static int close_copy(Copy &copy);
+
+  static const uint64_t max_prefix = 64 * 1024 * 1024;
+  static const int chunk_size = 1024 * 1024;
+  static const int page_size = 4096;
+};
+
+#endif
+
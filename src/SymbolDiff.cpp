@@ -0,0 +1,258 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <algorithm>
+
+#include "SymbolDiff.h"
+
+int SymbolDiff::print(
+  const char *old_filename,
+  const char *new_filename,
+  Demangle *demangle)
+{
+  Elf *old_elf = NULL;
+  Elf *new_elf = NULL;
+  Symbols old_symbols;
+  Symbols new_symbols;
+  std::vector<std::string> old_sections;
+  std::vector<std::string> new_sections;
+
+  if (load(old_filename, old_elf, old_symbols, old_sections) != 0 ||
+      load(new_filename, new_elf, new_symbols, new_sections) != 0)
+  {
+    if (old_elf != NULL) { delete old_elf; }
+    return -1;
+  }
+
+  Table table;
+  std::map<std::string, Entry> sections;
+
+  table.reserve(std::max(old_symbols.size(), new_symbols.size()));
+
+  add(old_symbols, old_sections, false, table, sections);
+  add(new_symbols, new_sections, true, table, sections);
+
+  std::vector<std::pair<const char *, Entry>> changed;
+  uint64_t added = 0, removed = 0, resized = 0;
+  int64_t added_bytes = 0, removed_bytes = 0, resized_bytes = 0;
+
+  for (auto &iter : table)
+  {
+    const Entry &entry = iter.second;
+
+    if (entry.old_count == 0)
+    {
+      added++;
+      added_bytes += entry.get_delta();
+    }
+      else
+    if (entry.new_count == 0)
+    {
+      removed++;
+      removed_bytes += entry.get_delta();
+    }
+      else
+    if (entry.old_size != entry.new_size)
+    {
+      resized++;
+      resized_bytes += entry.get_delta();
+    }
+      else
+    {
+      continue;
+    }
+
+    changed.push_back(iter);
+  }
+
+  printf("Symbol diff: %s -> %s\n", old_filename, new_filename);
+  printf("---------------------------------------------\n");
+  printf("    added: %8" PRIu64 " %+12" PRId64 " bytes\n", added, added_bytes);
+  printf("  removed: %8" PRIu64 " %+12" PRId64 " bytes\n", removed, removed_bytes);
+  printf("  resized: %8" PRIu64 " %+12" PRId64 " bytes\n", resized, resized_bytes);
+  printf("    total: %8" PRIu64 " %+12" PRId64 " bytes\n\n",
+    added + removed + resized,
+    added_bytes + removed_bytes + resized_bytes);
+
+  print_entries(changed, demangle);
+
+  std::vector<std::pair<std::string, Entry>> list(sections.begin(), sections.end());
+
+  std::sort(list.begin(), list.end(),
+    [](const std::pair<std::string, Entry> &a,
+       const std::pair<std::string, Entry> &b)
+    {
+      return llabs(a.second.get_delta()) > llabs(b.second.get_delta());
+    });
+
+  printf("By section\n");
+  printf("---------------------------------------------\n");
+  printf("%12s %12s %12s  %s\n", "old", "new", "delta", "section");
+
+  for (auto &section : list)
+  {
+    printf("%12" PRIu64 " %12" PRIu64 " %+12" PRId64 "  %s\n",
+      section.second.old_size,
+      section.second.new_size,
+      section.second.get_delta(),
+      section.first.c_str());
+  }
+
+  printf("\n");
+
+  delete old_elf;
+  delete new_elf;
+
+  return 0;
+}
+
+int SymbolDiff::load(
+  const char *filename,
+  Elf *&elf,
+  Symbols &symbols,
+  std::vector<std::string> &section_names)
+{
+  elf = Elf::open_elf(filename);
+
+  if (elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  Section section;
+
+  if (elf->find_symbol_table(section) < 0 ||
+      elf->read_symbols(section, symbols) != 0)
+  {
+    printf("Error: No symbol table in %s\n", filename);
+    delete elf;
+    elf = NULL;
+    return -1;
+  }
+
+  section_names.resize(elf->get_section_count());
+
+  for (int n = 0; n < elf->get_section_count(); n++)
+  {
+    elf->get_section(n, section);
+    section_names[n] = elf->get_section_name(section);
+  }
+
+  return 0;
+}
+
+void SymbolDiff::add(
+  Symbols &symbols,
+  std::vector<std::string> &section_names,
+  bool is_new,
+  Table &table,
+  std::map<std::string, Entry> &sections)
+{
+  // Per section totals are summed by index first, then by name.
+  std::vector<uint64_t> totals(section_names.size());
+
+  for (uint64_t n = 0; n < symbols.size(); n++)
+  {
+    const uint16_t shndx = symbols.st_shndx[n];
+    const uint8_t type = symbols.st_info[n] & 0xf;
+
+    // Undefined, section and file symbols.
+    if (shndx == 0 || type == 3 || type == 4) { continue; }
+
+    const char *name = symbols.get_name(n);
+
+    if (name[0] == 0) { continue; }
+
+    Entry &entry = table[name];
+
+    if (is_new)
+    {
+      entry.new_size += symbols.st_size[n];
+      entry.new_count++;
+    }
+      else
+    {
+      entry.old_size += symbols.st_size[n];
+      entry.old_count++;
+    }
+
+    if (shndx < totals.size())
+    {
+      totals[shndx] += symbols.st_size[n];
+    }
+  }
+
+  for (uint32_t n = 0; n < totals.size(); n++)
+  {
+    if (totals[n] == 0) { continue; }
+
+    Entry &entry = sections[section_names[n]];
+
+    if (is_new)
+    {
+      entry.new_size += totals[n];
+    }
+      else
+    {
+      entry.old_size += totals[n];
+    }
+  }
+}
+
+void SymbolDiff::print_entries(
+  std::vector<std::pair<const char *, Entry>> &entries,
+  Demangle *demangle)
+{
+  std::sort(entries.begin(), entries.end(),
+    [](const std::pair<const char *, Entry> &a,
+       const std::pair<const char *, Entry> &b)
+    {
+      const int64_t delta_a = llabs(a.second.get_delta());
+      const int64_t delta_b = llabs(b.second.get_delta());
+
+      if (delta_a != delta_b) { return delta_a > delta_b; }
+
+      return strcmp(a.first, b.first) < 0;
+    });
+
+  printf("%12s %12s %12s    %s\n", "old", "new", "delta", "name");
+
+  std::vector<const char *> names;
+
+  for (auto &iter : entries) { names.push_back(iter.first); }
+
+  if (demangle != nullptr) { demangle->demangle_batch(names); }
+
+  int n = 0;
+
+  for (auto &iter : entries)
+  {
+    const Entry &entry = iter.second;
+    const char status =
+      entry.old_count == 0 ? '+' : (entry.new_count == 0 ? '-' : '~');
+
+    printf("%12" PRIu64 " %12" PRIu64 " %+12" PRId64 "  %c %s\n",
+      entry.old_size,
+      entry.new_size,
+      entry.get_delta(),
+      status,
+      names[n++]);
+  }
+
+  printf("\n");
+}
+
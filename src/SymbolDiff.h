@@ -0,0 +1,91 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_SYMBOL_DIFF_H
+#define MAGIC_ELF_SYMBOL_DIFF_H
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+#include "GnuHash.h"
+#include "Symbols.h"
+
+// Compare the symbol tables of two builds: added, removed and resized
+// symbols plus per section totals, biggest change first. Symbols are
+// matched by name through a hash table so this is linear in the number
+// of symbols. Local symbols sharing a name are summed together.
+class SymbolDiff
+{
+public:
+  static int print(
+    const char *old_filename,
+    const char *new_filename,
+    Demangle *demangle);
+
+private:
+  SymbolDiff();
+  ~SymbolDiff();
+
+  struct Entry
+  {
+    Entry() : old_size { 0 }, new_size { 0 }, old_count { 0 }, new_count { 0 }
+    {
+    }
+
+    int64_t get_delta() const { return (int64_t)(new_size - old_size); }
+
+    uint64_t old_size;
+    uint64_t new_size;
+    uint32_t old_count;
+    uint32_t new_count;
+  };
+
+  struct NameHash
+  {
+    size_t operator()(const char *name) const { return GnuHash::hash(name); }
+  };
+
+  struct NameEqual
+  {
+    bool operator()(const char *a, const char *b) const
+    {
+      return strcmp(a, b) == 0;
+    }
+  };
+
+  typedef std::unordered_map<const char *, Entry, NameHash, NameEqual> Table;
+
+  static int load(
+    const char *filename,
+    Elf *&elf,
+    Symbols &symbols,
+    std::vector<std::string> &section_names);
+
+  static void add(
+    Symbols &symbols,
+    std::vector<std::string> &section_names,
+    bool is_new,
+    Table &table,
+    std::map<std::string, Entry> &sections);
+
+  static void print_entries(
+    std::vector<std::pair<const char *, Entry>> &entries,
+    Demangle *demangle);
+};
+
+#endif
+
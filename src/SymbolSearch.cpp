@@ -0,0 +1,369 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+#include "SymbolSearch.h"
+
+int SymbolSearch::print(
+  const char *filename,
+  const char *pattern,
+  Demangle *demangle)
+{
+  const int pattern_length = strlen(pattern);
+  const bool is_regex =
+    pattern_length >= 2 && pattern[0] == '/' && pattern[pattern_length - 1] == '/';
+  std::string expression;
+  regex_t regex;
+
+  if (is_regex)
+  {
+    expression.assign(pattern + 1, pattern_length - 2);
+
+    if (regcomp(&regex, expression.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+    {
+      printf("Error: Invalid regex %s\n", pattern);
+      return -1;
+    }
+
+    pattern = expression.c_str();
+  }
+
+  Elf *elf = Elf::open_elf(filename);
+
+  if (elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    if (is_regex) { regfree(&regex); }
+    return -1;
+  }
+
+  std::string literal;
+  get_literal(pattern, is_regex, literal);
+
+  int matches = 0;
+
+  printf("%-18s %10s  %-6s %-6s %-8s %s\n",
+    "value", "size", "type", "bind", "table", "name");
+
+  for (int n = 0; n < elf->get_section_count(); n++)
+  {
+    Section section;
+    Symbols symbols;
+
+    elf->get_section(n, section);
+
+    if (section.sh_type != SHT_SYMTAB && section.sh_type != SHT_DYNSYM)
+    {
+      continue;
+    }
+
+    if (elf->read_symbols(section, symbols) != 0 || symbols.strtab == nullptr)
+    {
+      continue;
+    }
+
+    std::vector<uint64_t> candidates;
+    get_candidates(symbols, literal, candidates);
+
+    std::vector<uint64_t> found;
+    std::vector<const char *> names;
+
+    for (uint64_t index : candidates)
+    {
+      const char *name = symbols.get_name(index);
+
+      const bool match = is_regex ?
+        regexec(&regex, name, 0, NULL, 0) == 0 :
+        fnmatch(pattern, name, 0) == 0;
+
+      if (!match) { continue; }
+
+      found.push_back(index);
+      names.push_back(name);
+    }
+
+    if (demangle != nullptr) { demangle->demangle_batch(names); }
+
+    const char *table = section.sh_type == SHT_SYMTAB ? ".symtab" : ".dynsym";
+
+    for (int i = 0; i < (int)found.size(); i++)
+    {
+      Symbol symbol;
+      symbol.st_info = symbols.st_info[found[i]];
+
+      printf("0x%016" PRIx64 " %10" PRIu64 "  %-6s %-6s %-8s %s\n",
+        symbols.st_value[found[i]],
+        symbols.st_size[found[i]],
+        symbol.get_symbol_type(),
+        symbol.get_symbol_binding(),
+        table,
+        names[i]);
+    }
+
+    matches += found.size();
+  }
+
+  printf("\n%d symbols match %s\n\n", matches, pattern);
+
+  if (is_regex) { regfree(&regex); }
+
+  delete elf;
+
+  return 0;
+}
+
+int64_t SymbolSearch::find(
+  const uint8_t *data,
+  uint64_t length,
+  uint64_t start,
+  const std::string &literal)
+{
+  const uint64_t literal_length = literal.size();
+  uint64_t n = start;
+
+  if (literal_length == 0 || literal_length > length) { return -1; }
+
+#ifdef __SSE2__
+  // Compare 16 positions at a time against the first and last byte of
+  // the literal; only positions where both match get a memcmp().
+  const __m128i first = _mm_set1_epi8(literal[0]);
+  const __m128i last = _mm_set1_epi8(literal[literal_length - 1]);
+
+  for (; n + literal_length - 1 + 16 <= length; n += 16)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i *)(data + n));
+    const __m128i b =
+      _mm_loadu_si128((const __m128i *)(data + n + literal_length - 1));
+
+    int mask = _mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+    while (mask != 0)
+    {
+      const int bit = __builtin_ctz(mask);
+
+      if (memcmp(data + n + bit, literal.c_str(), literal_length) == 0)
+      {
+        return n + bit;
+      }
+
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; n + literal_length <= length; n++)
+  {
+    if (data[n] == (uint8_t)literal[0] &&
+        memcmp(data + n, literal.c_str(), literal_length) == 0)
+    {
+      return n;
+    }
+  }
+
+  return -1;
+}
+
+void SymbolSearch::get_literal(
+  const char *pattern,
+  bool is_regex,
+  std::string &literal)
+{
+  // Longest run of plain characters that every match has to contain.
+  // Anything that isn't surely required (groups, which can be optional
+  // or repeated, and characters with a ? * or {} after them) ends the
+  // run. An empty literal means every name gets matched.
+  std::string current;
+
+  literal.clear();
+
+  if (is_regex && strchr(pattern, '|') != NULL) { return; }
+
+  auto end_run = [&]()
+  {
+    if (current.size() > literal.size()) { literal = current; }
+    current.clear();
+  };
+
+  for (const char *s = pattern; *s != 0; s++)
+  {
+    if (*s == '\\' && s[1] != 0)
+    {
+      s++;
+
+      // \d, \w and friends are classes, not the letter.
+      if (is_regex && isalnum(*s))
+      {
+        end_run();
+        continue;
+      }
+
+      current.push_back(*s);
+      continue;
+    }
+
+    if (!is_regex)
+    {
+      if (strchr("*?[]", *s) == NULL)
+      {
+        current.push_back(*s);
+        continue;
+      }
+
+      end_run();
+
+      if (*s == '[')
+      {
+        // Skip the whole bracket expression. A ']' right after the '['
+        // is part of the set.
+        if (s[1] == 0 || s[2] == 0) { return; }
+        const char *end = strchr(s + 2, ']');
+        if (end == NULL) { return; }
+        s = end;
+      }
+
+      continue;
+    }
+
+    if (strchr("*?{", *s) != NULL && current.size() != 0)
+    {
+      // The character before is optional or repeated.
+      current.pop_back();
+    }
+
+    if (strchr(".[]()*+?{}^$", *s) == NULL)
+    {
+      current.push_back(*s);
+      continue;
+    }
+
+    end_run();
+
+    const char *end = nullptr;
+
+    if (*s == '[')
+    {
+      if (s[1] != 0 && s[2] != 0) { end = strchr(s + 2, ']'); }
+    }
+      else
+    if (*s == '{')
+    {
+      end = strchr(s + 1, '}');
+    }
+      else
+    if (*s == '(')
+    {
+      // Nothing inside a group is used.
+      int depth = 0;
+
+      for (end = s; *end != 0; end++)
+      {
+        if (*end == '\\' && end[1] != 0) { end++; continue; }
+        if (*end == '(') { depth++; }
+        if (*end == ')' && --depth == 0) { break; }
+      }
+
+      if (*end == 0) { end = nullptr; }
+    }
+      else
+    {
+      continue;
+    }
+
+    // Something unbalanced, fall back to checking every name.
+    if (end == nullptr)
+    {
+      literal.clear();
+      return;
+    }
+
+    s = end;
+  }
+
+  end_run();
+}
+
+void SymbolSearch::get_candidates(
+  const Symbols &symbols,
+  const std::string &literal,
+  std::vector<uint64_t> &candidates)
+{
+  if (literal.size() == 0)
+  {
+    for (uint64_t n = 1; n < symbols.size(); n++) { candidates.push_back(n); }
+    return;
+  }
+
+  // st_name -> symbol index, sorted so every symbol whose name starts
+  // inside a string table entry can be found with a binary search. The
+  // linker merges common suffixes, so a name can start in the middle of
+  // another one.
+  std::vector<std::pair<uint32_t, uint32_t>> by_name;
+
+  by_name.reserve(symbols.size());
+
+  for (uint64_t n = 1; n < symbols.size(); n++)
+  {
+    if (symbols.st_name[n] != 0) { by_name.push_back(std::make_pair(symbols.st_name[n], n)); }
+  }
+
+  std::sort(by_name.begin(), by_name.end());
+
+  const uint8_t *data = (const uint8_t *)symbols.strtab;
+  const uint64_t length = symbols.strtab_length;
+  uint64_t offset = 0;
+
+  while (true)
+  {
+    const int64_t hit = find(data, length, offset, literal);
+
+    if (hit < 0) { break; }
+
+    uint64_t start = hit;
+    while (start > 0 && data[start - 1] != 0) { start--; }
+
+    const uint8_t *end = (const uint8_t *)memchr(data + hit, 0, length - hit);
+    const uint64_t entry_end = end == NULL ? length : end - data;
+    offset = entry_end + 1;
+
+    // Every name starting at or before the last hit in this entry runs
+    // through it.
+    uint64_t last = hit;
+    int64_t next;
+
+    while ((next = find(data, entry_end, last + 1, literal)) >= 0) { last = next; }
+
+    auto iter = std::lower_bound(
+      by_name.begin(), by_name.end(), std::make_pair((uint32_t)start, (uint32_t)0));
+
+    for (; iter != by_name.end() && iter->first <= last; iter++)
+    {
+      candidates.push_back(iter->second);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+}
+
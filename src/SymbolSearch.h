@@ -0,0 +1,51 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_SYMBOL_SEARCH_H
+#define MAGIC_ELF_SYMBOL_SEARCH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+#include "Symbols.h"
+
+// Find every symbol matching a glob (*Allocator*) or, if the pattern is
+// written as /regex/, an extended regex. The longest literal piece of
+// the pattern is searched for in the raw string table first, and only
+// symbols whose names contain it are run through fnmatch()/regexec().
+class SymbolSearch
+{
+public:
+  static int print(const char *filename, const char *pattern, Demangle *demangle);
+
+  static int64_t find(
+    const uint8_t *data,
+    uint64_t length,
+    uint64_t start,
+    const std::string &literal);
+
+  static void get_literal(const char *pattern, bool is_regex, std::string &literal);
+
+private:
+  SymbolSearch();
+  ~SymbolSearch();
+
+  static void get_candidates(
+    const Symbols &symbols,
+    const std::string &literal,
+    std::vector<uint64_t> &candidates);
+};
+
+#endif
+
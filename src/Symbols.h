@@ -0,0 +1,75 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_SYMBOLS_H
+#define MAGIC_ELF_SYMBOLS_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+// All entries of one SHT_SYMTAB / SHT_DYNSYM section decoded into
+// columns. The string table stays in the mapped file, except for
+// compressed files where it's copied out (the chunk it came from can be
+// dropped) and shared by copies of the Symbols.
+struct Symbols
+{
+  Symbols() :
+    strtab        { nullptr },
+    strtab_length { 0 }
+  {
+  }
+
+  ~Symbols()
+  {
+  }
+
+  void clear()
+  {
+    st_name.clear();
+    st_info.clear();
+    st_shndx.clear();
+    st_value.clear();
+    st_size.clear();
+    strtab = nullptr;
+    strtab_length = 0;
+    strtab_copy.reset();
+  }
+
+  void resize(uint64_t count)
+  {
+    st_name.resize(count);
+    st_info.resize(count);
+    st_shndx.resize(count);
+    st_value.resize(count);
+    st_size.resize(count);
+  }
+
+  uint64_t size() const { return st_name.size(); }
+
+  const char *get_name(uint64_t index) const
+  {
+    if (st_name[index] >= strtab_length) { return ""; }
+    return strtab + st_name[index];
+  }
+
+  std::vector<uint32_t> st_name;
+  std::vector<uint8_t> st_info;
+  std::vector<uint16_t> st_shndx;
+  std::vector<uint64_t> st_value;
+  std::vector<uint64_t> st_size;
+  const char *strtab;
+  uint64_t strtab_length;
+  std::shared_ptr<std::vector<char>> strtab_copy;
+};
+
+#endif
+
@@ -0,0 +1,509 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+#include "Parallel.h"
+#include "TextCheck.h"
+
+int TextCheck::print(const char *filename, Demangle *demangle)
+{
+  struct timespec start, end;
+  std::vector<MappedFile> mapped_files;
+
+  Elf *core = Elf::open_elf(filename);
+
+  if (core == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  if (core->header.e_type != ET_CORE)
+  {
+    printf("Error: %s is not a core file.\n", filename);
+    delete core;
+    return -1;
+  }
+
+  if (core->read_core_mapped_files(mapped_files) <= 0)
+  {
+    printf("Error: %s has no NT_FILE note.\n", filename);
+    delete core;
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  std::vector<Module> modules;
+  std::map<std::string, int> module_index;
+  std::vector<Job> jobs;
+  int not_in_core = 0;
+
+  for (auto &mapped_file : mapped_files)
+  {
+    Program program;
+    uint64_t offset;
+
+    if (core->get_program_header(program, offset, mapped_file.start) < 0 ||
+        program.p_type != PT_LOAD ||
+        (program.p_flags & 1) == 0)
+    {
+      continue;
+    }
+
+    // Only what the kernel dumped can be compared.
+    const uint64_t start = mapped_file.start;
+    const uint64_t end = std::min(mapped_file.end, program.p_vaddr + program.p_filesz);
+
+    if (start >= end)
+    {
+      not_in_core++;
+      continue;
+    }
+
+    auto iter = module_index.find(mapped_file.name);
+
+    if (iter == module_index.end())
+    {
+      Module module;
+      module.path = mapped_file.name;
+      module.elf = nullptr;
+      module.base = 0;
+      module.segments = 0;
+      module.compared = 0;
+
+      load_module(module);
+
+      iter = module_index.insert(
+        std::make_pair(mapped_file.name, (int)modules.size())).first;
+      modules.push_back(module);
+    }
+
+    Module &module = modules[iter->second];
+
+    if (module.elf == nullptr) { continue; }
+
+    uint64_t base;
+
+    if (!get_base(module.elf, start, mapped_file.file_offset, base))
+    {
+      printf("Error: %s has no code at file offset 0x%" PRIx64 "\n",
+        module.path.c_str(), mapped_file.file_offset);
+      continue;
+    }
+
+    module.base = base;
+
+    uint64_t length = end - start;
+
+    if (mapped_file.file_offset + length > (uint64_t)module.elf->buffer_len)
+    {
+      if (mapped_file.file_offset >= (uint64_t)module.elf->buffer_len) { continue; }
+      length = module.elf->buffer_len - mapped_file.file_offset;
+    }
+
+    const uint64_t core_offset = program.p_offset + (start - program.p_vaddr);
+
+    module.segments++;
+    module.compared += length;
+
+    for (uint64_t n = 0; n < length; n += chunk_size)
+    {
+      Job job;
+      job.module = iter->second;
+      job.address = start + n;
+      job.length = std::min((uint64_t)chunk_size, length - n);
+      job.core_offset = core_offset + n;
+      job.file_offset = mapped_file.file_offset + n;
+
+      jobs.push_back(job);
+    }
+  }
+
+  const int threads = Parallel::get_thread_count(jobs.size(), 16);
+  std::vector<std::vector<Range>> thread_ranges(threads);
+  std::vector<std::vector<uint64_t>> thread_failed(threads);
+
+  // Each job is read when its thread gets to it. Compressed files are
+  // copied into the thread's buffers since another thread's reads can
+  // drop the chunk a pointer would point into.
+  Parallel::for_range(
+    threads,
+    jobs.size(),
+    [&](int thread, uint64_t start, uint64_t end)
+    {
+      std::vector<uint8_t> buffer_a;
+      std::vector<uint8_t> buffer_b;
+
+      for (uint64_t n = start; n < end; n++)
+      {
+        const Job &job = jobs[n];
+        const uint8_t *a = read(core, job.core_offset, job.length, buffer_a);
+        const uint8_t *b =
+          read(modules[job.module].elf, job.file_offset, job.length, buffer_b);
+
+        if (a == nullptr || b == nullptr)
+        {
+          printf("Error: Cannot read 0x%" PRIx64 " bytes at 0x%" PRIx64 "\n",
+            job.length, job.address);
+          thread_failed[thread].push_back(n);
+          continue;
+        }
+
+        compare(a, b, job, thread_ranges[thread]);
+      }
+    });
+
+  int failed = 0;
+
+  for (auto &list : thread_failed)
+  {
+    for (uint64_t n : list)
+    {
+      modules[jobs[n].module].compared -= jobs[n].length;
+      failed++;
+    }
+  }
+
+  // Join ranges that were split across chunks, then drop relocated
+  // words.
+  std::vector<Range> ranges;
+
+  for (auto &list : thread_ranges)
+  {
+    ranges.insert(ranges.end(), list.begin(), list.end());
+  }
+
+  std::sort(ranges.begin(), ranges.end(),
+    [](const Range &a, const Range &b) { return a.start < b.start; });
+
+  std::vector<Range> merged;
+
+  for (auto &range : ranges)
+  {
+    if (merged.size() != 0 &&
+        merged.back().module == range.module &&
+        merged.back().end == range.start)
+    {
+      merged.back().end = range.end;
+      continue;
+    }
+
+    merged.push_back(range);
+  }
+
+  std::vector<Range> differ;
+  uint64_t ignored = 0;
+
+  for (auto &range : merged)
+  {
+    remove_relocated(modules[range.module], range, differ, ignored);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  uint64_t compared = 0;
+  uint64_t differ_bytes = 0;
+  int segments = 0;
+
+  for (int n = 0; n < (int)modules.size(); n++)
+  {
+    Module &module = modules[n];
+
+    if (module.elf == nullptr)
+    {
+      printf("%s: cannot open\n\n", module.path.c_str());
+      continue;
+    }
+
+    int count = 0;
+    uint64_t bytes = 0;
+
+    for (auto &range : differ)
+    {
+      if (range.module != n) { continue; }
+      count++;
+      bytes += range.end - range.start;
+    }
+
+    printf("%s: base=0x%" PRIx64 ", %" PRIu64 " bytes in %d segments, ",
+      module.path.c_str(), module.base, module.compared, module.segments);
+
+    if (count == 0)
+    {
+      printf("matches\n\n");
+    }
+      else
+    {
+      printf("%d ranges differ (%" PRIu64 " bytes)\n", count, bytes);
+
+      for (auto &range : differ)
+      {
+        if (range.module != n) { continue; }
+
+        uint64_t offset;
+        const char *name = find_function(module, range.start, offset);
+
+        printf("  0x%016" PRIx64 "-0x%016" PRIx64 " %6" PRIu64 " bytes",
+          range.start, range.end, range.end - range.start);
+
+        if (name != nullptr)
+        {
+          if (demangle != nullptr) { name = demangle->demangle(name); }
+
+          printf("  %s+0x%" PRIx64, name, offset);
+        }
+
+        printf("\n");
+      }
+
+      printf("\n");
+    }
+
+    compared += module.compared;
+    differ_bytes += bytes;
+    segments += module.segments;
+  }
+
+  const double ms =
+    (end.tv_sec - start.tv_sec) * 1000.0 +
+    (end.tv_nsec - start.tv_nsec) / 1000000.0;
+
+  printf("Compared %" PRIu64 " bytes in %d segments: %d ranges, %" PRIu64
+         " bytes differ, %" PRIu64 " relocated bytes ignored (%.1f ms, %d threads)\n",
+    compared, segments, (int)differ.size(), differ_bytes, ignored, ms, threads);
+
+  if (not_in_core != 0)
+  {
+    printf("%d executable mappings have no data in the core "
+           "(see coredump_filter)\n", not_in_core);
+  }
+
+  if (failed != 0)
+  {
+    printf("Error: %d chunks couldn't be read and weren't compared\n", failed);
+  }
+
+  for (auto &module : modules) { delete module.elf; }
+
+  delete core;
+
+  return failed == 0 ? 0 : -1;
+}
+
+int TextCheck::load_module(Module &module)
+{
+  module.elf = Elf::open_elf(module.path.c_str());
+
+  if (module.elf == nullptr) { return -1; }
+
+  Elf *elf = module.elf;
+  Relocations relocations;
+
+  for (int pass = 0; pass < 2; pass++)
+  {
+    if (elf->read_dynamic_relocations(relocations, pass == 0) != 0) { continue; }
+
+    module.relocated.insert(
+      module.relocated.end(),
+      relocations.r_offset.begin(),
+      relocations.r_offset.end());
+  }
+
+  std::sort(module.relocated.begin(), module.relocated.end());
+
+  Section section;
+  Symbols symbols;
+
+  if (elf->find_symbol_table(section) >= 0 &&
+      elf->read_symbols(section, symbols) == 0)
+  {
+    for (uint64_t n = 0; n < symbols.size(); n++)
+    {
+      if ((symbols.st_info[n] & 0xf) != STT_FUNC || symbols.st_shndx[n] == 0)
+      {
+        continue;
+      }
+
+      Function function;
+      function.address = symbols.st_value[n];
+      function.size = symbols.st_size[n];
+      function.name = symbols.get_name(n);
+
+      module.functions.push_back(function);
+    }
+  }
+
+  std::sort(module.functions.begin(), module.functions.end(),
+    [](const Function &a, const Function &b) { return a.address < b.address; });
+
+  return 0;
+}
+
+bool TextCheck::get_base(
+  Elf *elf,
+  uint64_t start,
+  uint64_t file_offset,
+  uint64_t &base)
+{
+  for (int count = 0; count < elf->get_program_count(); count++)
+  {
+    Program program;
+    elf->get_program(count, program);
+
+    if (program.p_type != PT_LOAD) { continue; }
+
+    if (file_offset >= program.p_offset &&
+        file_offset < program.p_offset + program.p_filesz)
+    {
+      base = start - (program.p_vaddr + (file_offset - program.p_offset));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const uint8_t *TextCheck::read(
+  Elf *elf,
+  uint64_t offset,
+  uint64_t length,
+  std::vector<uint8_t> &buffer)
+{
+  if (elf->compressed == nullptr) { return elf->get_data(offset, length); }
+
+  buffer.resize(length);
+
+  if (elf->read_data(offset, length, buffer.data()) != 0) { return nullptr; }
+
+  return buffer.data();
+}
+
+void TextCheck::compare(
+  const uint8_t *a,
+  const uint8_t *b,
+  const Job &job,
+  std::vector<Range> &ranges)
+{
+  // memcmp() is already vectorized and almost every chunk is equal.
+  if (memcmp(a, b, job.length) == 0) { return; }
+
+  uint64_t n = 0;
+
+  auto add = [&](uint64_t position)
+  {
+    const uint64_t address = job.address + position;
+
+    if (ranges.size() != 0 && ranges.back().end == address)
+    {
+      ranges.back().end++;
+      return;
+    }
+
+    ranges.push_back({ job.module, address, address + 1 });
+  };
+
+#ifdef __SSE2__
+  for (; n + 16 <= job.length; n += 16)
+  {
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i *)(a + n)),
+      _mm_loadu_si128((const __m128i *)(b + n))));
+
+    mask = ~mask & 0xffff;
+
+    while (mask != 0)
+    {
+      add(n + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; n < job.length; n++)
+  {
+    if (a[n] != b[n]) { add(n); }
+  }
+}
+
+void TextCheck::remove_relocated(
+  const Module &module,
+  const Range &range,
+  std::vector<Range> &ranges,
+  uint64_t &ignored)
+{
+  const uint64_t word = module.elf->bitwidth / 8;
+  uint64_t start = range.start;
+
+  // Relocated words that overlap the range, in file addresses.
+  auto iter = std::lower_bound(
+    module.relocated.begin(),
+    module.relocated.end(),
+    range.start - module.base < word ? 0 : range.start - module.base - word + 1);
+
+  for (; iter != module.relocated.end(); ++iter)
+  {
+    const uint64_t low = *iter + module.base;
+    const uint64_t high = low + word;
+
+    if (low >= range.end) { break; }
+    if (high <= start) { continue; }
+
+    if (low > start) { ranges.push_back({ range.module, start, low }); }
+
+    const uint64_t covered_end = std::min(high, range.end);
+    ignored += covered_end - std::max(low, start);
+    start = covered_end;
+  }
+
+  if (start < range.end) { ranges.push_back({ range.module, start, range.end }); }
+}
+
+const char *TextCheck::find_function(
+  const Module &module,
+  uint64_t address,
+  uint64_t &offset)
+{
+  const uint64_t value = address - module.base;
+
+  auto iter = std::upper_bound(
+    module.functions.begin(),
+    module.functions.end(),
+    value,
+    [](uint64_t value, const Function &function)
+    {
+      return value < function.address;
+    });
+
+  if (iter == module.functions.begin()) { return nullptr; }
+
+  --iter;
+
+  if (iter->size != 0 && value >= iter->address + iter->size) { return nullptr; }
+
+  offset = value - iter->address;
+
+  return iter->name;
+}
+
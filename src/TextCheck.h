@@ -0,0 +1,106 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_TEXT_CHECK_H
+#define MAGIC_ELF_TEXT_CHECK_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+
+// Checks the code in a core against the files it was loaded from, to
+// spot hot patches and stray writes. Every executable PT_LOAD that has
+// data in the core is matched to its file through NT_FILE, and the
+// bytes are compared in chunks on all threads. Words that the dynamic
+// relocations write to are skipped since they're expected to differ.
+// Differences are listed by function.
+//
+// Kernels leave file-backed code out of cores unless coredump_filter
+// has bit 2 set (echo 0x3f > /proc/<pid>/coredump_filter).
+class TextCheck
+{
+public:
+  static int print(const char *filename, Demangle *demangle);
+
+private:
+  TextCheck();
+  ~TextCheck();
+
+  struct Function
+  {
+    uint64_t address;
+    uint64_t size;
+    const char *name;
+  };
+
+  struct Module
+  {
+    std::string path;
+    Elf *elf;
+    uint64_t base;
+    int segments;
+    uint64_t compared;
+
+    // Start of every relocated word (file addresses), sorted.
+    std::vector<uint64_t> relocated;
+    std::vector<Function> functions;
+  };
+
+  struct Job
+  {
+    int module;
+    uint64_t core_offset;
+    uint64_t file_offset;
+    uint64_t address;
+    uint64_t length;
+  };
+
+  struct Range
+  {
+    int module;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  static int load_module(Module &module);
+  static bool get_base(Elf *elf, uint64_t start, uint64_t file_offset, uint64_t &base);
+
+  static const uint8_t *read(
+    Elf *elf,
+    uint64_t offset,
+    uint64_t length,
+    std::vector<uint8_t> &buffer);
+
+  static void compare(
+    const uint8_t *a,
+    const uint8_t *b,
+    const Job &job,
+    std::vector<Range> &ranges);
+
+  static void remove_relocated(
+    const Module &module,
+    const Range &range,
+    std::vector<Range> &ranges,
+    uint64_t &ignored);
+
+  static const char *find_function(
+    const Module &module,
+    uint64_t address,
+    uint64_t &offset);
+
+  static const uint64_t chunk_size = 64 * 1024;
+};
+
+#endif
+
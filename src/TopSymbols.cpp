@@ -0,0 +1,398 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <algorithm>
+
+#include "Parallel.h"
+#include "TopSymbols.h"
+
+// Section indexes past the real sections are folded into these slots.
+#define SLOT_ABS     0
+#define SLOT_COMMON  1
+#define SLOT_OTHER   2
+#define SLOT_COUNT   3
+
+int TopSymbols::print(const char *filename, int count, Demangle *demangle)
+{
+  Elf *elf = Elf::open_elf(filename);
+
+  if (elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  Section section;
+  Symbols symbols;
+
+  if (elf->find_symbol_table(section) < 0 ||
+      elf->read_symbols(section, symbols) != 0)
+  {
+    printf("Error: No symbol table in %s\n", filename);
+    delete elf;
+    return -1;
+  }
+
+  const int section_count = elf->get_section_count();
+  const int threads = Parallel::get_thread_count(symbols.size(), 65536);
+  std::vector<Totals> totals(threads);
+
+  for (auto &t : totals)
+  {
+    t.by_section.resize(section_count + SLOT_COUNT);
+  }
+
+  Parallel::for_range(threads, symbols.size(),
+    [&](int thread, uint64_t start, uint64_t end)
+    {
+      aggregate(symbols, start, end, count, totals[thread]);
+    });
+
+  // Merge everything into the first thread's totals.
+  Totals &merged = totals[0];
+
+  for (int n = 1; n < threads; n++)
+  {
+    for (int i = 0; i < section_count + SLOT_COUNT; i++)
+    {
+      merged.by_section[i].add(totals[n].by_section[i]);
+    }
+
+    for (int b = 0; b < 16; b++)
+    {
+      for (int t = 0; t < 16; t++)
+      {
+        merged.by_type[b][t].add(totals[n].by_type[b][t]);
+      }
+    }
+
+    for (auto &family : totals[n].by_family)
+    {
+      merged.by_family[family.first].add(family.second);
+    }
+
+    merged.top.insert(merged.top.end(), totals[n].top.begin(), totals[n].top.end());
+  }
+
+  auto bigger = [&symbols](uint64_t a, uint64_t b)
+  {
+    return symbols.st_size[a] > symbols.st_size[b];
+  };
+
+  if ((int)merged.top.size() > count)
+  {
+    std::partial_sort(
+      merged.top.begin(), merged.top.begin() + count, merged.top.end(), bigger);
+    merged.top.resize(count);
+  }
+    else
+  {
+    std::sort(merged.top.begin(), merged.top.end(), bigger);
+  }
+
+  Total total;
+
+  for (auto &t : merged.by_section) { total.add(t); }
+
+  printf("Top %d symbols by size (%" PRIu64 " defined symbols, %" PRIu64
+         " bytes)\n", count, total.count, total.size);
+  printf("---------------------------------------------\n");
+  printf("%10s  %-6s %-6s %-20s %s\n", "size", "type", "bind", "section", "name");
+
+  std::vector<const char *> names;
+
+  for (uint64_t index : merged.top) { names.push_back(symbols.get_name(index)); }
+
+  if (demangle != nullptr) { demangle->demangle_batch(names); }
+
+  int i = 0;
+
+  for (uint64_t index : merged.top)
+  {
+    Symbol symbol;
+    symbol.st_info = symbols.st_info[index];
+
+    const uint16_t shndx = symbols.st_shndx[index];
+    std::string section_name = "";
+
+    if (shndx < section_count)
+    {
+      Section s;
+      elf->get_section(shndx, s);
+      section_name = elf->get_section_name(s);
+    }
+
+    printf("%10" PRIu64 "  %-6s %-6s %-20s %s\n",
+      symbols.st_size[index],
+      symbol.get_symbol_type(),
+      symbol.get_symbol_binding(),
+      section_name.c_str(),
+      names[i++]);
+  }
+
+  printf("\n");
+
+  std::vector<std::pair<std::string, Total>> list;
+
+  for (int n = 0; n < section_count; n++)
+  {
+    if (merged.by_section[n].count == 0) { continue; }
+
+    Section s;
+    elf->get_section(n, s);
+    list.push_back(std::make_pair(elf->get_section_name(s), merged.by_section[n]));
+  }
+
+  const char *slot_names[] = { "ABS", "COMMON", "OTHER" };
+
+  for (int n = 0; n < SLOT_COUNT; n++)
+  {
+    if (merged.by_section[section_count + n].count == 0) { continue; }
+
+    list.push_back(
+      std::make_pair(slot_names[n], merged.by_section[section_count + n]));
+  }
+
+  print_totals("By section", list, count, total.size);
+
+  list.clear();
+
+  for (auto &family : merged.by_family)
+  {
+    list.push_back(std::make_pair(family.first, family.second));
+  }
+
+  print_totals("By template", list, count, total.size);
+
+  list.clear();
+
+  for (int b = 0; b < 16; b++)
+  {
+    for (int t = 0; t < 16; t++)
+    {
+      if (merged.by_type[b][t].count == 0) { continue; }
+
+      Symbol symbol;
+      symbol.st_info = (b << 4) | t;
+
+      std::string name =
+        std::string(symbol.get_symbol_binding()) + " " + symbol.get_symbol_type();
+
+      list.push_back(std::make_pair(name, merged.by_type[b][t]));
+    }
+  }
+
+  print_totals("By binding/type", list, count, total.size);
+
+  delete elf;
+
+  return 0;
+}
+
+void TopSymbols::get_family(const char *demangled, std::string &family)
+{
+  // Collapse template arguments to <> and drop the parameter list so
+  // every instantiation of a template ends up with the same name.
+  int depth = 0;
+
+  family.clear();
+
+  for (const char *s = demangled; *s != 0; s++)
+  {
+    if (depth == 0 && strncmp(s, "operator", 8) == 0)
+    {
+      // operator<, operator<<=, operator() etc. aren't brackets.
+      const char *ops[] =
+      {
+        "<=>", "<<=", ">>=", "()", "[]", "->", "<<", ">>", "<=", ">=", "<", ">"
+      };
+
+      family.append("operator");
+      s += 8;
+
+      for (const char *op : ops)
+      {
+        const int len = strlen(op);
+
+        if (strncmp(s, op, len) == 0)
+        {
+          family.append(op);
+          s += len;
+          break;
+        }
+      }
+
+      s--;
+      continue;
+    }
+
+    if (*s == '<')
+    {
+      if (depth == 0) { family.append("<>"); }
+      depth++;
+    }
+      else
+    if (*s == '>')
+    {
+      if (depth > 0) { depth--; }
+    }
+      else
+    if (depth == 0)
+    {
+      family.push_back(*s);
+    }
+  }
+
+  // Strip " [clone .isra.0]" etc, then the parameters and any const.
+  size_t clone = family.find(" [clone ");
+
+  if (clone != std::string::npos) { family.resize(clone); }
+
+  if ((family.size() != 0 && family.back() == ')') ||
+      (family.size() > 6 && family.compare(family.size() - 6, 6, " const") == 0))
+  {
+    int level = 0;
+
+    for (int n = family.size() - 1; n >= 0; n--)
+    {
+      if (family[n] == ')') { level++; }
+        else
+      if (family[n] == '(')
+      {
+        level--;
+        if (level == 0) { family.resize(n); break; }
+      }
+    }
+  }
+}
+
+void TopSymbols::aggregate(
+  const Symbols &symbols,
+  uint64_t start,
+  uint64_t end,
+  int count,
+  Totals &totals)
+{
+  const int section_count = totals.by_section.size() - SLOT_COUNT;
+  char *buffer = NULL;
+  size_t length = 0;
+  std::string demangled;
+  std::string family;
+
+  for (uint64_t n = start; n < end; n++)
+  {
+    const uint16_t shndx = symbols.st_shndx[n];
+    const uint64_t size = symbols.st_size[n];
+    const uint8_t info = symbols.st_info[n];
+
+    if (shndx == 0) { continue; }
+
+    // Section and file symbols would count everything twice.
+    if ((info & 0xf) == 3 || (info & 0xf) == 4) { continue; }
+
+    if (shndx < section_count)
+    {
+      totals.by_section[shndx].add(size);
+    }
+      else
+    if (shndx == 0xfff1)
+    {
+      totals.by_section[section_count + SLOT_ABS].add(size);
+    }
+      else
+    if (shndx == 0xfff2)
+    {
+      totals.by_section[section_count + SLOT_COMMON].add(size);
+    }
+      else
+    {
+      totals.by_section[section_count + SLOT_OTHER].add(size);
+    }
+
+    totals.by_type[info >> 4][info & 0xf].add(size);
+
+    if (size == 0) { continue; }
+
+    totals.top.push_back(n);
+
+    // Keep each thread's list short: trim back to the biggest count
+    // whenever it doubles.
+    if ((int)totals.top.size() >= count * 2 + 1024)
+    {
+      std::nth_element(
+        totals.top.begin(), totals.top.begin() + count, totals.top.end(),
+        [&symbols](uint64_t a, uint64_t b)
+        {
+          return symbols.st_size[a] > symbols.st_size[b];
+        });
+
+      totals.top.resize(count);
+    }
+
+    const char *name = symbols.get_name(n);
+
+    // Template arguments are always mangled as I...E, so names with no
+    // 'I' can skip the (slow) demangler.
+    if (name[0] != '_' || name[1] != 'Z' || strchr(name, 'I') == NULL)
+    {
+      continue;
+    }
+
+    if (!Demangle::demangle_name(name, demangled, buffer, length)) { continue; }
+
+    if (demangled.find('<') == std::string::npos) { continue; }
+
+    get_family(demangled.c_str(), family);
+
+    // Only templated names; a plain function taking a std::string
+    // would otherwise show up as a family of one.
+    if (family.find("<>") == std::string::npos) { continue; }
+
+    totals.by_family[family].add(size);
+  }
+
+  free(buffer);
+}
+
+void TopSymbols::print_totals(
+  const char *title,
+  std::vector<std::pair<std::string, Total>> &list,
+  int count,
+  uint64_t total_size)
+{
+  std::sort(list.begin(), list.end(),
+    [](const std::pair<std::string, Total> &a,
+       const std::pair<std::string, Total> &b)
+    {
+      return a.second.size > b.second.size;
+    });
+
+  printf("%s\n", title);
+  printf("---------------------------------------------\n");
+  printf("%10s %6s %8s  %s\n", "size", "%", "symbols", "name");
+
+  for (int n = 0; n < (int)list.size() && n < count; n++)
+  {
+    printf("%10" PRIu64 " %5.1f%% %8" PRIu64 "  %s\n",
+      list[n].second.size,
+      total_size == 0 ? 0.0 : (double)list[n].second.size * 100 / total_size,
+      list[n].second.count,
+      list[n].first.c_str());
+  }
+
+  printf("\n");
+}
+
@@ -0,0 +1,77 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_TOP_SYMBOLS_H
+#define MAGIC_ELF_TOP_SYMBOLS_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+#include "Symbols.h"
+
+// Where the bytes in a binary go: the biggest symbols, and symbol
+// sizes summed up by section, by template (every instantiation of
+// std::vector<>::push_back<> counted together) and by binding/type.
+class TopSymbols
+{
+public:
+  static int print(const char *filename, int count, Demangle *demangle);
+
+  static void get_family(const char *demangled, std::string &family);
+
+private:
+  TopSymbols();
+  ~TopSymbols();
+
+  struct Total
+  {
+    Total() : count { 0 }, size { 0 } { }
+
+    void add(uint64_t size) { this->count++; this->size += size; }
+
+    void add(const Total &total)
+    {
+      count += total.count;
+      size += total.size;
+    }
+
+    uint64_t count;
+    uint64_t size;
+  };
+
+  struct Totals
+  {
+    std::vector<Total> by_section;
+    Total by_type[16][16];
+    std::unordered_map<std::string, Total> by_family;
+    std::vector<uint64_t> top;
+  };
+
+  static void aggregate(
+    const Symbols &symbols,
+    uint64_t start,
+    uint64_t end,
+    int count,
+    Totals &totals);
+
+  static void print_totals(
+    const char *title,
+    std::vector<std::pair<std::string, Total>> &list,
+    int count,
+    uint64_t total_size);
+};
+
+#endif
+
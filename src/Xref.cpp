@@ -0,0 +1,488 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <fnmatch.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+#include "Parallel.h"
+#include "Xref.h"
+
+int Xref::print(const char *filename, const char *pattern, Demangle *demangle)
+{
+  struct timespec start, end;
+
+  Elf *elf = Elf::open_elf(filename);
+
+  if (elf == NULL)
+  {
+    printf("Error: Cannot open %s\n", filename);
+    return -1;
+  }
+
+  if (! (elf->header.e_machine == EM_X86_32 ||
+         elf->header.e_machine == EM_X86_64))
+  {
+    printf("Error: -xref only decodes x86 code.\n");
+    delete elf;
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  std::vector<Function> functions;
+
+  if (read_functions(elf, functions) != 0)
+  {
+    delete elf;
+    return -1;
+  }
+
+  // Chunks of each executable section so one big .text still spreads
+  // over all the threads.
+  std::vector<Chunk> chunks;
+  uint64_t scanned = 0;
+  int section_count = 0;
+
+  for (int n = 0; n < elf->get_section_count(); n++)
+  {
+    Section section;
+    elf->get_section(n, section);
+
+    if (section.sh_type != SHT_PROGBITS) { continue; }
+    if ((section.sh_flags & SHF_EXECINSTR) == 0) { continue; }
+    if (section.sh_offset + section.sh_size > (uint64_t)elf->buffer_len) { continue; }
+
+    for (uint64_t offset = 0; offset < section.sh_size; offset += chunk_size)
+    {
+      Chunk chunk;
+      chunk.data = nullptr;
+      chunk.offset = section.sh_offset + offset;
+      chunk.address = section.sh_addr + offset;
+      chunk.length = section.sh_size - offset;
+      chunk.scan_length = std::min((uint64_t)chunk_size, chunk.length);
+      chunk.address_mask = elf->bitwidth == 32 ? 0xffffffff : UINT64_MAX;
+      chunks.push_back(chunk);
+    }
+
+    scanned += section.sh_size;
+    section_count++;
+  }
+
+  const int threads = Parallel::get_thread_count(chunks.size(), 1);
+  std::vector<std::vector<Site>> thread_sites(threads);
+  std::vector<uint64_t> thread_candidates(threads, 0);
+  std::vector<int> thread_failed(threads, 0);
+
+  // Each chunk is read when its thread gets to it, copied out of a
+  // compressed file since another thread's reads can drop its window.
+  Parallel::for_range(
+    threads,
+    chunks.size(),
+    [&](int thread, uint64_t start, uint64_t end)
+    {
+      std::vector<uint8_t> buffer;
+
+      for (uint64_t n = start; n < end; n++)
+      {
+        Chunk chunk = chunks[n];
+
+        // A call at the end of the chunk runs up to 4 bytes past it.
+        chunk.length = std::min(chunk.length, chunk.scan_length + 4);
+        chunk.data = read(elf, chunk.offset, chunk.length, buffer);
+
+        if (chunk.data == nullptr)
+        {
+          thread_failed[thread]++;
+          continue;
+        }
+
+        scan(chunk, functions, thread_sites[thread], thread_candidates[thread]);
+      }
+    });
+
+  // callee -> callers index.
+  std::vector<Site> sites;
+  uint64_t candidates = 0;
+  int failed = 0;
+
+  for (int n = 0; n < threads; n++)
+  {
+    sites.insert(sites.end(), thread_sites[n].begin(), thread_sites[n].end());
+    candidates += thread_candidates[n];
+    failed += thread_failed[n];
+  }
+
+  std::sort(sites.begin(), sites.end(),
+    [](const Site &a, const Site &b)
+    {
+      if (a.callee != b.callee) { return a.callee < b.callee; }
+      return a.address < b.address;
+    });
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  std::vector<const char *> names;
+
+  for (auto &function : functions) { names.push_back(function.name.c_str()); }
+
+  if (demangle != nullptr) { demangle->demangle_batch(names); }
+
+  int matches = 0;
+  uint64_t callees = 0;
+  uint64_t n = 0;
+
+  while (n < sites.size())
+  {
+    const uint32_t callee = sites[n].callee;
+    uint64_t last = n;
+
+    while (last < sites.size() && sites[last].callee == callee) { last++; }
+
+    callees++;
+
+    // "foo" also matches the PLT entry "foo@plt".
+    const std::string &name = functions[callee].name;
+    const size_t plt = name.size() > 4 ? name.size() - 4 : 0;
+    const bool match =
+      fnmatch(pattern, name.c_str(), 0) == 0 ||
+      fnmatch(pattern, names[callee], 0) == 0 ||
+      (plt != 0 && name.compare(plt, 4, "@plt") == 0 &&
+       fnmatch(pattern, name.substr(0, plt).c_str(), 0) == 0);
+
+    if (match)
+    {
+      int callers = 0;
+
+      for (uint64_t i = n; i < last; i++)
+      {
+        if (i == n || sites[i].caller != sites[i - 1].caller) { callers++; }
+      }
+
+      printf("Callers of %s (0x%" PRIx64 "): %d sites in %d functions\n",
+        names[callee], functions[callee].address, (int)(last - n), callers);
+
+      for (uint64_t i = n; i < last; i++)
+      {
+        printf("  0x%016" PRIx64 " %-4s ",
+          sites[i].address,
+          sites[i].is_jump ? "jmp" : "call");
+
+        if (sites[i].caller == no_caller)
+        {
+          printf("(no symbol)\n");
+          continue;
+        }
+
+        const Function &caller = functions[sites[i].caller];
+
+        printf("%s+0x%" PRIx64 "\n",
+          names[sites[i].caller],
+          sites[i].address - caller.address);
+      }
+
+      printf("\n");
+      matches++;
+    }
+
+    n = last;
+  }
+
+  if (matches == 0) { printf("No calls to %s found.\n\n", pattern); }
+
+  const double ms =
+    (end.tv_sec - start.tv_sec) * 1000.0 +
+    (end.tv_nsec - start.tv_nsec) / 1000000.0;
+
+  printf("Scanned %d sections, %" PRIu64 " bytes: %" PRIu64 " candidates, "
+         "%d call sites into %" PRIu64 " functions (%.1f ms, %d threads)\n",
+    section_count,
+    scanned,
+    candidates,
+    (int)sites.size(),
+    callees,
+    ms,
+    threads);
+
+  delete elf;
+
+  if (failed != 0)
+  {
+    printf("Error: %d chunks couldn't be read and weren't scanned\n", failed);
+    return -1;
+  }
+
+  return 0;
+}
+
+int Xref::read_functions(Elf *elf, std::vector<Function> &functions)
+{
+  Section section;
+  Symbols symbols;
+
+  if (elf->find_symbol_table(section) < 0 ||
+      elf->read_symbols(section, symbols) != 0)
+  {
+    printf("Error: No symbol table\n");
+    return -1;
+  }
+
+  for (uint64_t n = 0; n < symbols.size(); n++)
+  {
+    if ((symbols.st_info[n] & 0xf) != STT_FUNC || symbols.st_shndx[n] == 0)
+    {
+      continue;
+    }
+
+    if (symbols.st_size[n] == 0) { continue; }
+
+    Function function;
+    function.address = symbols.st_value[n];
+    function.size = symbols.st_size[n];
+    function.name = symbols.get_name(n);
+
+    functions.push_back(function);
+  }
+
+  read_plt(elf, functions);
+
+  std::sort(functions.begin(), functions.end(),
+    [](const Function &a, const Function &b)
+    {
+      if (a.address != b.address) { return a.address < b.address; }
+      return a.size > b.size;
+    });
+
+  // Aliases get merged into the first name at that address so every
+  // address belongs to one function.
+  std::vector<Function> merged;
+
+  for (auto &function : functions)
+  {
+    if (merged.size() != 0 &&
+        function.address < merged.back().address + merged.back().size)
+    {
+      continue;
+    }
+
+    merged.push_back(function);
+  }
+
+  functions.swap(merged);
+
+  return 0;
+}
+
+void Xref::read_plt(Elf *elf, std::vector<Function> &plt)
+{
+  // GOT slot -> symbol name from the relocations that fill the slots.
+  std::map<uint64_t, std::string> slots;
+  Relocations relocations;
+
+  for (int pass = 0; pass < 2; pass++)
+  {
+    if (elf->read_dynamic_relocations(relocations, pass == 0) != 0) { continue; }
+
+    for (uint64_t n = 0; n < relocations.size(); n++)
+    {
+      const uint32_t sym = relocations.r_sym[n];
+      const int kind =
+        Relocations::get_kind(elf->header.e_machine, relocations.r_type[n], sym);
+
+      if (sym == 0 || elf->dynsym_offset == 0) { continue; }
+      if (kind != Relocations::KIND_JUMP_SLOT && kind != Relocations::KIND_SYMBOLIC)
+      {
+        continue;
+      }
+
+      Symbol symbol;
+      elf->get_symbol(elf->dynsym_offset + sym * elf->dynsym_entsize, symbol);
+
+      slots[relocations.r_offset[n]] = elf->get_dynamic_string(symbol.st_name);
+    }
+  }
+
+  if (slots.size() == 0) { return; }
+
+  // Every PLT flavor (.plt, .plt.sec, .plt.got) ends its entries with
+  // jmp *slot, which is ff 25 and a rip relative (64 bit) or absolute
+  // (32 bit non-PIC) slot address. Entries are 16 byte aligned.
+  for (int n = 0; n < elf->get_section_count(); n++)
+  {
+    Section section;
+    elf->get_section(n, section);
+
+    const char *name = elf->get_section_name(section);
+
+    if (strncmp(name, ".plt", 4) != 0) { continue; }
+    if (section.sh_offset + section.sh_size > (uint64_t)elf->buffer_len) { continue; }
+
+    const uint8_t *data = elf->get_data(section.sh_offset, section.sh_size);
+
+    if (data == nullptr) { continue; }
+
+    for (uint64_t i = 0; i + 6 <= section.sh_size; i++)
+    {
+      if (data[i] != 0xff || data[i + 1] != 0x25) { continue; }
+
+      int32_t disp;
+      memcpy(&disp, data + i + 2, 4);
+
+      const uint64_t slot = elf->bitwidth == 64 ?
+        section.sh_addr + i + 6 + disp :
+        (uint32_t)disp;
+
+      auto iter = slots.find(slot);
+
+      if (iter == slots.end()) { continue; }
+
+      Function function;
+      function.address = section.sh_addr + (i & ~(uint64_t)15);
+      function.size = 16;
+      function.name = iter->second + "@plt";
+
+      plt.push_back(function);
+
+      i += 5;
+    }
+  }
+}
+
+int Xref::find_function(
+  const std::vector<Function> &functions,
+  uint64_t address,
+  bool exact)
+{
+  auto iter = std::upper_bound(
+    functions.begin(),
+    functions.end(),
+    address,
+    [](uint64_t address, const Function &function)
+    {
+      return address < function.address;
+    });
+
+  if (iter == functions.begin()) { return -1; }
+
+  --iter;
+
+  if (exact ?
+      iter->address != address :
+      address >= iter->address + iter->size)
+  {
+    return -1;
+  }
+
+  return iter - functions.begin();
+}
+
+const uint8_t *Xref::read(
+  Elf *elf,
+  uint64_t offset,
+  uint64_t length,
+  std::vector<uint8_t> &buffer)
+{
+  if (elf->compressed == nullptr) { return elf->get_data(offset, length); }
+
+  buffer.resize(length);
+
+  if (elf->read_data(offset, length, buffer.data()) != 0) { return nullptr; }
+
+  return buffer.data();
+}
+
+void Xref::scan(
+  const Chunk &chunk,
+  const std::vector<Function> &functions,
+  std::vector<Site> &sites,
+  uint64_t &candidates)
+{
+  const uint8_t *data = chunk.data;
+  uint64_t n = 0;
+
+  auto check = [&](uint64_t position)
+  {
+    if (position + 5 > chunk.length) { return; }
+
+    candidates++;
+
+    int32_t rel32;
+    memcpy(&rel32, data + position + 1, 4);
+
+    const uint64_t address = chunk.address + position;
+    const uint64_t target = (address + 5 + rel32) & chunk.address_mask;
+
+    const int callee = find_function(functions, target, true);
+
+    if (callee < 0) { return; }
+
+    // Code between symbols (stripped local functions) still gets its
+    // calls listed, just without a caller name.
+    const int caller = find_function(functions, address, false);
+    const bool is_jump = data[position] == 0xe9;
+
+    if (caller >= 0)
+    {
+      if (address + 5 > functions[caller].address + functions[caller].size)
+      {
+        return;
+      }
+
+      // A jmp to the top of its own function is a loop, not a call.
+      if (is_jump && caller == callee) { return; }
+    }
+
+    Site site;
+    site.address = address;
+    site.caller = caller < 0 ? no_caller : caller;
+    site.callee = callee;
+    site.is_jump = is_jump;
+
+    sites.push_back(site);
+  };
+
+#ifdef __SSE2__
+  // e8 and e9 only differ in the low bit, so one compare finds both.
+  const __m128i low_bit = _mm_set1_epi8((char)0xfe);
+  const __m128i opcode = _mm_set1_epi8((char)0xe8);
+
+  for (; n + 16 <= chunk.scan_length; n += 16)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i *)(data + n));
+
+    int mask = _mm_movemask_epi8(
+      _mm_cmpeq_epi8(_mm_and_si128(a, low_bit), opcode));
+
+    while (mask != 0)
+    {
+      check(n + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; n < chunk.scan_length; n++)
+  {
+    if ((data[n] & 0xfe) == 0xe8) { check(n); }
+  }
+}
+
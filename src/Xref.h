@@ -0,0 +1,90 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_XREF_H
+#define MAGIC_ELF_XREF_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Demangle.h"
+#include "Elf.h"
+
+// Who calls a function, from the machine code alone. Executable sections
+// are scanned 16 bytes at a time for the call rel32 (E8) and jmp rel32
+// (E9) opcodes. A candidate only counts if it lands exactly on the start
+// of a function or of a PLT entry and doesn't run past the end of the
+// function it's in, which throws out opcode bytes that were really part
+// of another instruction.
+// PLT entries are named through the GOT slot they jump through and the
+// JUMP_SLOT / GLOB_DAT relocation on that slot. Indirect calls and calls
+// from code without symbols aren't found.
+class Xref
+{
+public:
+  static int print(const char *filename, const char *pattern, Demangle *demangle);
+
+private:
+  Xref();
+  ~Xref();
+
+  struct Function
+  {
+    uint64_t address;
+    uint64_t size;
+    std::string name;
+  };
+
+  struct Site
+  {
+    uint64_t address;
+    uint32_t caller;
+    uint32_t callee;
+    bool is_jump;
+  };
+
+  struct Chunk
+  {
+    const uint8_t *data;
+    uint64_t offset;
+    uint64_t address;
+    uint64_t length;
+    uint64_t scan_length;
+    uint64_t address_mask;
+  };
+
+  static int read_functions(Elf *elf, std::vector<Function> &functions);
+  static void read_plt(Elf *elf, std::vector<Function> &plt);
+
+  static int find_function(
+    const std::vector<Function> &functions,
+    uint64_t address,
+    bool exact);
+
+  static const uint8_t *read(
+    Elf *elf,
+    uint64_t offset,
+    uint64_t length,
+    std::vector<uint8_t> &buffer);
+
+  static void scan(
+    const Chunk &chunk,
+    const std::vector<Function> &functions,
+    std::vector<Site> &sites,
+    uint64_t &candidates);
+
+  static const uint64_t chunk_size = 256 * 1024;
+  static const uint32_t no_caller = 0xffffffff;
+};
+
+#endif
+
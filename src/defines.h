@@ -30,6 +30,8 @@
 #define SHT_PREINIT_ARRAY 16
 #define SHT_GROUP         17
 #define SHT_SYMTAB_SHNDX  18
+#define SHT_GNU_HASH      0x6ffffff6
+#define SHT_GNU_VERSYM    0x6fffffff
 #define SHT_LOOS          0x60000000
 #define SHT_HIOS          0x6fffffff
 #define SHT_LOPROC        0x70000000
@@ -37,12 +39,77 @@
 #define SHT_LOUSER        0x80000000
 #define SHT_HIUSER        0xffffffff
 
+#define SHF_EXECINSTR  0x4
+#define SHF_COMPRESSED 0x800
+
+#define ELFCOMPRESS_ZLIB 1
+#define ELFCOMPRESS_ZSTD 2
+
+#define ET_CORE    4
+
+#define STT_FUNC   2
+
 #define PT_NULL    0
 #define PT_LOAD    1
 #define PT_DYNAMIC 2
 #define PT_INTERP  3
 #define PT_NOTE    4
 
+#define DT_NULL            0
+#define DT_NEEDED          1
+#define DT_PLTRELSZ        2
+#define DT_PLTGOT          3
+#define DT_HASH            4
+#define DT_STRTAB          5
+#define DT_SYMTAB          6
+#define DT_RELA            7
+#define DT_RELASZ          8
+#define DT_RELAENT         9
+#define DT_STRSZ           10
+#define DT_SYMENT          11
+#define DT_INIT            12
+#define DT_FINI            13
+#define DT_SONAME          14
+#define DT_RPATH           15
+#define DT_SYMBOLIC        16
+#define DT_REL             17
+#define DT_RELSZ           18
+#define DT_RELENT          19
+#define DT_PLTREL          20
+#define DT_DEBUG           21
+#define DT_TEXTREL         22
+#define DT_JMPREL          23
+#define DT_BIND_NOW        24
+#define DT_INIT_ARRAY      25
+#define DT_FINI_ARRAY      26
+#define DT_INIT_ARRAYSZ    27
+#define DT_FINI_ARRAYSZ    28
+#define DT_RUNPATH         29
+#define DT_FLAGS           30
+#define DT_PREINIT_ARRAY   32
+#define DT_PREINIT_ARRAYSZ 33
+#define DT_SYMTAB_SHNDX    34
+#define DT_RELRSZ          35
+#define DT_RELR            36
+#define DT_RELRENT         37
+#define DT_GNU_HASH        0x6ffffef5
+#define DT_VERSYM          0x6ffffff0
+#define DT_RELACOUNT       0x6ffffff9
+#define DT_RELCOUNT        0x6ffffffa
+#define DT_FLAGS_1         0x6ffffffb
+#define DT_VERDEF          0x6ffffffc
+#define DT_VERDEFNUM       0x6ffffffd
+#define DT_VERNEED         0x6ffffffe
+#define DT_VERNEEDNUM      0x6fffffff
+#define DT_AUXILIARY       0x7ffffffd
+#define DT_FILTER          0x7fffffff
+
+#define DF_SYMBOLIC 0x02
+#define DF_TEXTREL  0x04
+#define DF_BIND_NOW 0x08
+
+#define DF_1_NOW    0x01
+
 #define NT_PRSTATUS   1
 #define NT_PRFPREG    2
 #define NT_PRPSINFO   3
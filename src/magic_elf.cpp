@@ -14,11 +14,28 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
+#include "CoreDiff.h"
+#include "Demangle.h"
 #include "Display.h"
 #include "Elf.h"
+#include "FileDiff.h"
+#include "Gcore.h"
 #include "Java.h"
 #include "Modify.h"
+#include "Process.h"
+#include "Profile.h"
+#include "Resolver.h"
+#include "Server.h"
+#include "Startup.h"
+#include "Stream.h"
+#include "SymbolDiff.h"
+#include "SymbolSearch.h"
+#include "TextCheck.h"
+#include "TopSymbols.h"
+#include "Xref.h"
 
 int main(int argc, char *argv[])
 {
@@ -30,7 +47,34 @@ int main(int argc, char *argv[])
   uint32_t pid = 0;
   uint64_t value = 0;
   const char *reg = NULL;
+  const char *copy_filename = NULL;
   bool run_java_extract = false;
+  bool run_stream = false;
+  bool show_stats = false;
+  bool run_startup = false;
+  bool check_text = false;
+  const char *resolve_names = nullptr;
+  int top_symbols = 0;
+  const char *diff_old = nullptr;
+  const char *diff_new = nullptr;
+  bool diff_symbols = false;
+  const char *diff_core_a = nullptr;
+  const char *diff_core_b = nullptr;
+  int diff_core_ranges = 20;
+  const char *find_pattern = nullptr;
+  const char *xref_pattern = nullptr;
+  const char *profile_filename = nullptr;
+  const char *ordering_filename = nullptr;
+  const char *profile_base = nullptr;
+  const char *socket_path = nullptr;
+  int max_open = 256;
+  int live_pid = 0;
+  const char *gcore_filename = nullptr;
+  const char *undo_filename = nullptr;
+  uint64_t max_heap = 0;
+  bool gcore_consistent = false;
+  Demangle demangle_memo;
+  Demangle *demangle = nullptr;
   int r;
 
   printf(
@@ -42,10 +86,27 @@ int main(int argc, char *argv[])
   {
     printf(
       "Usage: magic_elf [ options ] <filename.so>\n"
-      "    -modify_function <function_name> <retvalue>\n"
+      "    -modify_function <function_name> <retvalue> [ -pid <pid> ]\n"
+      "    -undo <undo_record>                 (undo -modify_function -pid)\n"
       "    -modify_core <pid> <register> <value>\n"
       "    -show <symbol>\n"
-      "    -extract_java\n\n");
+      "    -extract_java\n"
+      "    -demangle\n"
+      "    -stats\n"
+      "    -startup\n"
+      "    -check-text                         (core code against its files)\n"
+      "    -resolve <symbol[,symbol...]|->\n"
+      "    -top-symbols [ count ]\n"
+      "    -find-symbols <glob|/regex/>\n"
+      "    -xref <glob>                        (callers of functions)\n"
+      "    -profile <samples> [ -ordering <filename> ] [ -base <hex> ]\n"
+      "    -diff <old> <new>\n"
+      "    -diff-symbols <old> <new>\n"
+      "    -diff-cores <a> <b> [ max_ranges ]  (memory of two cores)\n"
+      "    -server <socket> [ max_open ]\n"
+      "    -pid <pid>                          (running process)\n"
+      "    -gcore <pid> <output> [ max_heap_mb ] [ -consistent ]\n"
+      "    -stream [ -copy <filename[.gz]> ]   (core on stdin)\n\n");
     exit(0);
   }
 
@@ -95,6 +156,216 @@ int main(int argc, char *argv[])
       run_java_extract = true;
     }
       else
+    if (strcmp(argv[r],"-find-symbols") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -find-symbols requires 1 argument\n");
+        exit(1);
+      }
+
+      find_pattern = argv[r + 1];
+      r++;
+    }
+      else
+    if (strcmp(argv[r],"-xref") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -xref requires 1 argument\n");
+        exit(1);
+      }
+
+      xref_pattern = argv[r + 1];
+      r++;
+    }
+      else
+    if (strcmp(argv[r],"-profile") == 0 ||
+        strcmp(argv[r],"-ordering") == 0 ||
+        strcmp(argv[r],"-base") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: %s requires 1 argument\n", argv[r]);
+        exit(1);
+      }
+
+      if (argv[r][1] == 'p')
+      {
+        profile_filename = argv[r + 1];
+      }
+        else
+      if (argv[r][1] == 'b')
+      {
+        profile_base = argv[r + 1];
+      }
+        else
+      {
+        ordering_filename = argv[r + 1];
+      }
+
+      r++;
+    }
+      else
+    if (strcmp(argv[r],"-demangle") == 0)
+    {
+      demangle = &demangle_memo;
+    }
+      else
+    if (strcmp(argv[r],"-stats") == 0)
+    {
+      show_stats = true;
+    }
+      else
+    if (strcmp(argv[r],"-startup") == 0)
+    {
+      run_startup = true;
+    }
+      else
+    if (strcmp(argv[r],"-check-text") == 0)
+    {
+      check_text = true;
+    }
+      else
+    if (strcmp(argv[r],"-resolve") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -resolve requires 1 argument\n");
+        exit(1);
+      }
+
+      resolve_names = argv[r + 1];
+      r++;
+    }
+      else
+    if (strcmp(argv[r],"-top-symbols") == 0)
+    {
+      top_symbols = 20;
+
+      if (r + 1 < argc && argv[r + 1][0] >= '0' && argv[r + 1][0] <= '9')
+      {
+        top_symbols = atoi(argv[r + 1]);
+        r++;
+      }
+    }
+      else
+    if (strcmp(argv[r],"-diff") == 0 || strcmp(argv[r],"-diff-symbols") == 0)
+    {
+      if (r + 2 >= argc)
+      {
+        printf("Error: %s requires 2 arguments\n", argv[r]);
+        exit(1);
+      }
+
+      diff_symbols = strcmp(argv[r],"-diff-symbols") == 0;
+      diff_old = argv[r + 1];
+      diff_new = argv[r + 2];
+      r += 2;
+    }
+      else
+    if (strcmp(argv[r],"-diff-cores") == 0)
+    {
+      if (r + 2 >= argc)
+      {
+        printf("Error: -diff-cores requires 2 arguments\n");
+        exit(1);
+      }
+
+      diff_core_a = argv[r + 1];
+      diff_core_b = argv[r + 2];
+      r += 2;
+
+      if (r + 1 < argc && argv[r + 1][0] >= '0' && argv[r + 1][0] <= '9')
+      {
+        diff_core_ranges = atoi(argv[r + 1]);
+        r++;
+      }
+    }
+      else
+    if (strcmp(argv[r],"-server") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -server requires 1 argument\n");
+        exit(1);
+      }
+
+      socket_path = argv[r + 1];
+      r++;
+
+      if (r + 1 < argc && argv[r + 1][0] >= '0' && argv[r + 1][0] <= '9')
+      {
+        max_open = atoi(argv[r + 1]);
+        r++;
+      }
+    }
+      else
+    if (strcmp(argv[r],"-pid") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -pid requires 1 argument\n");
+        exit(1);
+      }
+
+      live_pid = atoi(argv[r + 1]);
+      r++;
+    }
+      else
+    if (strcmp(argv[r],"-undo") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -undo requires 1 argument\n");
+        exit(1);
+      }
+
+      undo_filename = argv[r + 1];
+      r++;
+    }
+      else
+    if (strcmp(argv[r],"-gcore") == 0)
+    {
+      if (r + 2 >= argc)
+      {
+        printf("Error: -gcore requires 2 arguments\n");
+        exit(1);
+      }
+
+      live_pid = atoi(argv[r + 1]);
+      gcore_filename = argv[r + 2];
+      r += 2;
+
+      if (r + 1 < argc && argv[r + 1][0] >= '0' && argv[r + 1][0] <= '9')
+      {
+        max_heap = strtoull(argv[r + 1], NULL, 10) * 1024 * 1024;
+        r++;
+      }
+    }
+      else
+    if (strcmp(argv[r],"-consistent") == 0)
+    {
+      gcore_consistent = true;
+    }
+      else
+    if (strcmp(argv[r],"-stream") == 0)
+    {
+      run_stream = true;
+    }
+      else
+    if (strcmp(argv[r],"-copy") == 0)
+    {
+      if (r + 1 >= argc)
+      {
+        printf("Error: -copy requires 1 argument\n");
+        exit(1);
+      }
+
+      copy_filename = argv[r + 1];
+      r++;
+    }
+      else
     if (argv[r][0] == '-')
     {
       printf("Unknown option '%s'\n", argv[r]);
@@ -106,6 +377,88 @@ int main(int argc, char *argv[])
     }
   }
 
+  if (run_stream)
+  {
+    int fd = 0;
+
+    if (filename != nullptr && strcmp(filename, "-") != 0)
+    {
+      fd = open(filename, O_RDONLY);
+
+      if (fd == -1)
+      {
+        printf("Error: Cannot open file %s\n", filename);
+        exit(1);
+      }
+    }
+
+    int err = Stream::process(fd, copy_filename);
+
+    if (fd != 0) { close(fd); }
+
+    exit(err == 0 ? 0 : 1);
+  }
+
+  if (socket_path != nullptr)
+  {
+    Server server(max_open);
+
+    exit(server.run(socket_path) == 0 ? 0 : 1);
+  }
+
+  if (gcore_filename != nullptr)
+  {
+    int err = Gcore::write(live_pid, gcore_filename, max_heap, gcore_consistent);
+
+    exit(err == 0 ? 0 : 1);
+  }
+
+  if (undo_filename != nullptr && function_name == NULL)
+  {
+    exit(Modify::undo_live(undo_filename) == 0 ? 0 : 1);
+  }
+
+  if (live_pid != 0 && function_name != NULL)
+  {
+    char record[64];
+
+    if (undo_filename == nullptr)
+    {
+      snprintf(record, sizeof(record), "magic_elf.%d.undo", live_pid);
+      undo_filename = record;
+    }
+
+    int err = Modify::modify_function_live(
+      live_pid,
+      filename,
+      function_name,
+      ret_value,
+      undo_filename);
+
+    exit(err == 0 ? 0 : 1);
+  }
+
+  if (live_pid != 0)
+  {
+    exit(Process::print(live_pid, demangle) == 0 ? 0 : 1);
+  }
+
+  if (diff_old != nullptr)
+  {
+    int err = diff_symbols ?
+      SymbolDiff::print(diff_old, diff_new, demangle) :
+      FileDiff::print(diff_old, diff_new);
+
+    exit(err == 0 ? 0 : 1);
+  }
+
+  if (diff_core_a != nullptr)
+  {
+    int err = CoreDiff::print(diff_core_a, diff_core_b, diff_core_ranges);
+
+    exit(err == 0 ? 0 : 1);
+  }
+
   if (filename == nullptr)
   {
     printf("Error: No filename selected.\n");
@@ -118,6 +471,61 @@ int main(int argc, char *argv[])
     exit(0);
   }
 
+  if (show_stats)
+  {
+    exit(Display::file_stats(filename) == 0 ? 0 : 1);
+  }
+
+  if (run_startup)
+  {
+    exit(Startup::analyze(filename) == 0 ? 0 : 1);
+  }
+
+  if (check_text)
+  {
+    exit(TextCheck::print(filename, demangle) == 0 ? 0 : 1);
+  }
+
+  if (profile_filename != nullptr)
+  {
+    int err = Profile::print(
+      filename,
+      profile_filename,
+      ordering_filename,
+      profile_base,
+      demangle);
+
+    exit(err == 0 ? 0 : 1);
+  }
+
+  if (find_pattern != nullptr)
+  {
+    exit(SymbolSearch::print(filename, find_pattern, demangle) == 0 ? 0 : 1);
+  }
+
+  if (xref_pattern != nullptr)
+  {
+    exit(Xref::print(filename, xref_pattern, demangle) == 0 ? 0 : 1);
+  }
+
+  if (top_symbols != 0)
+  {
+    exit(TopSymbols::print(filename, top_symbols, demangle) == 0 ? 0 : 1);
+  }
+
+  if (resolve_names != nullptr)
+  {
+    Resolver resolver;
+
+    if (resolver.load(filename) != 0)
+    {
+      printf("Error: Cannot open %s\n", filename);
+      exit(1);
+    }
+
+    exit(resolver.print_resolve_list(resolve_names) == 0 ? 0 : 1);
+  }
+
   if (reg != NULL)
   {
     int err = Modify::set_core_register_value(filename, reg, value, pid);
@@ -156,6 +564,8 @@ int main(int argc, char *argv[])
     exit(0);
   }
 
+  elf->demangle = demangle;
+
   if (symbol_name == NULL && function_name == NULL)
   {
     elf->print_header();
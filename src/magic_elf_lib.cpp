@@ -0,0 +1,656 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "defines.h"
+#include "Cursor.h"
+#include "Elf.h"
+#include "GnuHash.h"
+#include "PRStatus.h"
+#include "Symbols.h"
+#include "magic_elf_lib.h"
+
+namespace
+{
+
+struct NameHash
+{
+  size_t operator()(const char *name) const { return GnuHash::hash(name); }
+};
+
+struct NameEqual
+{
+  bool operator()(const char *a, const char *b) const
+  {
+    return strcmp(a, b) == 0;
+  }
+};
+
+struct NoteArea
+{
+  uint64_t offset;
+  uint64_t size;
+  uint64_t align;
+};
+
+struct Thread
+{
+  uint32_t pid;
+  uint64_t registers;
+  uint64_t end;
+};
+
+}
+
+// Everything derived from the file is built on first use and kept with
+// the handle.
+struct magic_elf
+{
+  magic_elf() :
+    elf             { nullptr },
+    sections_loaded { false },
+    symbols_loaded  { false },
+    notes_loaded    { false },
+    threads_loaded  { false }
+  {
+  }
+
+  ~magic_elf()
+  {
+    delete elf;
+  }
+
+  Elf *elf;
+
+  bool sections_loaded;
+  std::vector<Section> sections;
+  std::vector<std::string> section_names;
+
+  bool symbols_loaded;
+  Symbols symbols;
+  std::unordered_map<const char *, uint64_t, NameHash, NameEqual> by_name;
+  std::vector<uint64_t> by_address;
+
+  bool notes_loaded;
+  std::vector<NoteArea> note_areas;
+
+  bool threads_loaded;
+  std::vector<Thread> threads;
+};
+
+static void load_sections(magic_elf_t *handle)
+{
+  if (handle->sections_loaded) { return; }
+
+  handle->elf->get_sections(handle->sections, handle->section_names);
+  handle->sections_loaded = true;
+}
+
+static void load_symbols(magic_elf_t *handle)
+{
+  if (handle->symbols_loaded) { return; }
+
+  handle->symbols_loaded = true;
+
+  Section section;
+
+  if (handle->elf->find_symbol_table(section) < 0) { return; }
+  if (handle->elf->read_symbols(section, handle->symbols) != 0) { return; }
+
+  Symbols &symbols = handle->symbols;
+
+  for (uint64_t n = 1; n < symbols.size(); n++)
+  {
+    if (symbols.st_shndx[n] == 0) { continue; }
+
+    // First definition of a name wins, same as the symbol table order.
+    handle->by_name.emplace(symbols.get_name(n), n);
+
+    const int type = symbols.st_info[n] & 0xf;
+
+    if (symbols.st_size[n] != 0 && (type == 1 || type == 2))
+    {
+      handle->by_address.push_back(n);
+    }
+  }
+
+  std::sort(handle->by_address.begin(), handle->by_address.end(),
+    [&symbols](uint64_t a, uint64_t b)
+    {
+      return symbols.st_value[a] < symbols.st_value[b];
+    });
+}
+
+static void load_notes(magic_elf_t *handle)
+{
+  if (handle->notes_loaded) { return; }
+
+  handle->notes_loaded = true;
+
+  Elf *elf = handle->elf;
+
+  for (int n = 0; n < elf->get_program_count(); n++)
+  {
+    Program program;
+    elf->get_program(n, program);
+
+    if (program.p_type != PT_NOTE) { continue; }
+
+    NoteArea area = { program.p_offset, program.p_filesz, program.p_align };
+    handle->note_areas.push_back(area);
+  }
+
+  if (handle->note_areas.size() != 0) { return; }
+
+  load_sections(handle);
+
+  for (auto &section : handle->sections)
+  {
+    if (section.sh_type != SHT_NOTE) { continue; }
+
+    NoteArea area = { section.sh_offset, section.sh_size, section.sh_addralign };
+    handle->note_areas.push_back(area);
+  }
+}
+
+static void load_threads(magic_elf_t *handle)
+{
+  if (handle->threads_loaded) { return; }
+
+  handle->threads_loaded = true;
+
+  magic_elf_note_iter iter;
+  magic_elf_note note;
+
+  magic_elf_note_begin(handle, &iter);
+
+  while (magic_elf_note_next(handle, &iter, &note) == 0)
+  {
+    if (note.type != NT_PRSTATUS || strcmp(note.name, "CORE") != 0)
+    {
+      continue;
+    }
+
+    // The general purpose registers follow the prstatus header.
+    Cursor cursor(handle->elf, note.desc - handle->elf->buffer);
+    PRStatus prstatus;
+
+    handle->elf->read_core_prstatus(cursor, prstatus);
+
+    const uint64_t end = (note.desc - handle->elf->buffer) + note.descsz;
+
+    Thread thread = { prstatus.pid, cursor.offset, end };
+
+    handle->threads.push_back(thread);
+  }
+}
+
+// A truncated or short prstatus note may not hold every register.
+static bool is_register(magic_elf_t *handle, int thread, uint64_t offset)
+{
+  const uint64_t end = offset + handle->elf->bitwidth / 8;
+
+  return end <= handle->threads[thread].end &&
+         end <= (uint64_t)handle->elf->buffer_len;
+}
+
+static void copy_symbol(
+  magic_elf_t *handle,
+  uint64_t index,
+  struct magic_elf_symbol *symbol)
+{
+  const Symbols &symbols = handle->symbols;
+
+  symbol->name = symbols.get_name(index);
+  symbol->value = symbols.st_value[index];
+  symbol->size = symbols.st_size[index];
+  symbol->type = symbols.st_info[index] & 0xf;
+  symbol->binding = symbols.st_info[index] >> 4;
+  symbol->shndx = symbols.st_shndx[index];
+}
+
+magic_elf_t *magic_elf_open(const char *filename)
+{
+  Elf *elf = Elf::open_elf(filename);
+
+  if (elf == nullptr) { return nullptr; }
+
+  magic_elf_t *handle = new magic_elf();
+  handle->elf = elf;
+
+  return handle;
+}
+
+magic_elf_t *magic_elf_open_writable(const char *filename)
+{
+  Elf *elf = Elf::open_elf(filename, true);
+
+  if (elf == nullptr) { return nullptr; }
+
+  magic_elf_t *handle = new magic_elf();
+  handle->elf = elf;
+
+  return handle;
+}
+
+magic_elf_t *magic_elf_open_mem(const void *data, uint64_t length)
+{
+  Elf *elf = Elf::open_elf_from_mem((void *)data, length);
+
+  if (elf == nullptr) { return nullptr; }
+
+  magic_elf_t *handle = new magic_elf();
+  handle->elf = elf;
+
+  return handle;
+}
+
+void magic_elf_close(magic_elf_t *handle)
+{
+  delete handle;
+}
+
+void magic_elf_load_indexes(magic_elf_t *handle)
+{
+  load_sections(handle);
+  load_symbols(handle);
+  load_notes(handle);
+  load_threads(handle);
+}
+
+int magic_elf_is_compressed(magic_elf_t *handle)
+{
+  return handle->elf->compressed != nullptr;
+}
+
+int magic_elf_get_class(magic_elf_t *handle)
+{
+  return handle->elf->header.ei_class;
+}
+
+int magic_elf_get_type(magic_elf_t *handle)
+{
+  return handle->elf->header.e_type;
+}
+
+int magic_elf_get_machine(magic_elf_t *handle)
+{
+  return handle->elf->header.e_machine;
+}
+
+uint64_t magic_elf_get_entry(magic_elf_t *handle)
+{
+  return handle->elf->header.e_entry;
+}
+
+const uint8_t *magic_elf_get_data(
+  magic_elf_t *handle,
+  uint64_t offset,
+  uint64_t length)
+{
+  if (offset + length < offset ||
+      offset + length > (uint64_t)handle->elf->buffer_len)
+  {
+    return nullptr;
+  }
+
+  return handle->elf->get_data(offset, length);
+}
+
+int magic_elf_get_section_count(magic_elf_t *handle)
+{
+  return handle->elf->get_section_count();
+}
+
+int magic_elf_get_section(
+  magic_elf_t *handle,
+  int index,
+  struct magic_elf_section *section)
+{
+  load_sections(handle);
+
+  if (index < 0 || index >= (int)handle->sections.size()) { return -1; }
+
+  const Section &s = handle->sections[index];
+
+  section->name = handle->section_names[index].c_str();
+  section->type = s.sh_type;
+  section->flags = s.sh_flags;
+  section->addr = s.sh_addr;
+  section->offset = s.sh_offset;
+  section->size = s.sh_size;
+  section->link = s.sh_link;
+  section->info = s.sh_info;
+  section->addralign = s.sh_addralign;
+  section->entsize = s.sh_entsize;
+
+  return 0;
+}
+
+int magic_elf_find_section(
+  magic_elf_t *handle,
+  const char *name,
+  struct magic_elf_section *section)
+{
+  load_sections(handle);
+
+  for (int n = 0; n < (int)handle->section_names.size(); n++)
+  {
+    if (handle->section_names[n] == name)
+    {
+      return magic_elf_get_section(handle, n, section);
+    }
+  }
+
+  return -1;
+}
+
+int magic_elf_get_segment_count(magic_elf_t *handle)
+{
+  return handle->elf->get_program_count();
+}
+
+int magic_elf_get_segment(
+  magic_elf_t *handle,
+  int index,
+  struct magic_elf_segment *segment)
+{
+  if (index < 0 || index >= handle->elf->get_program_count()) { return -1; }
+
+  Program program;
+  handle->elf->get_program(index, program);
+
+  segment->type = program.p_type;
+  segment->flags = program.p_flags;
+  segment->offset = program.p_offset;
+  segment->vaddr = program.p_vaddr;
+  segment->paddr = program.p_paddr;
+  segment->filesz = program.p_filesz;
+  segment->memsz = program.p_memsz;
+  segment->align = program.p_align;
+
+  return 0;
+}
+
+int64_t magic_elf_get_symbol_count(magic_elf_t *handle)
+{
+  load_symbols(handle);
+
+  return handle->symbols.size();
+}
+
+int magic_elf_get_symbol(
+  magic_elf_t *handle,
+  uint64_t index,
+  struct magic_elf_symbol *symbol)
+{
+  load_symbols(handle);
+
+  if (index >= handle->symbols.size()) { return -1; }
+
+  copy_symbol(handle, index, symbol);
+
+  return 0;
+}
+
+int magic_elf_find_symbol(
+  magic_elf_t *handle,
+  const char *name,
+  struct magic_elf_symbol *symbol)
+{
+  load_symbols(handle);
+
+  auto iter = handle->by_name.find(name);
+
+  if (iter != handle->by_name.end())
+  {
+    copy_symbol(handle, iter->second, symbol);
+    return 0;
+  }
+
+  // Not in the table that was loaded, try the dynamic hash table.
+  Symbol dynamic;
+
+  if (handle->elf->find_dynamic_symbol(name, dynamic) < 0 ||
+      dynamic.st_shndx == 0)
+  {
+    return -1;
+  }
+
+  symbol->name = handle->elf->get_dynamic_string(dynamic.st_name);
+  symbol->value = dynamic.st_value;
+  symbol->size = dynamic.st_size;
+  symbol->type = dynamic.st_info & 0xf;
+  symbol->binding = dynamic.st_info >> 4;
+  symbol->shndx = dynamic.st_shndx;
+
+  return 0;
+}
+
+int magic_elf_find_address(
+  magic_elf_t *handle,
+  uint64_t address,
+  struct magic_elf_symbol *symbol,
+  uint64_t *offset)
+{
+  load_symbols(handle);
+
+  const Symbols &symbols = handle->symbols;
+  const std::vector<uint64_t> &by_address = handle->by_address;
+
+  // Last symbol starting at or before address.
+  auto iter = std::upper_bound(by_address.begin(), by_address.end(), address,
+    [&symbols](uint64_t address, uint64_t index)
+    {
+      return address < symbols.st_value[index];
+    });
+
+  // Symbols can nest (an object inside a bigger one), so look back a
+  // few entries for one that actually contains the address.
+  for (int n = 0; n < 8 && iter != by_address.begin(); n++)
+  {
+    iter--;
+
+    const uint64_t index = *iter;
+
+    if (address < symbols.st_value[index] + symbols.st_size[index])
+    {
+      copy_symbol(handle, index, symbol);
+      if (offset != nullptr) { *offset = address - symbols.st_value[index]; }
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+int64_t magic_elf_address_to_offset(magic_elf_t *handle, uint64_t address)
+{
+  uint64_t offset = handle->elf->program_address_to_offset(address);
+
+  if (offset == 0) { offset = handle->elf->address_to_offset(address); }
+
+  return offset == 0 ? -1 : (int64_t)offset;
+}
+
+const uint8_t *magic_elf_get_memory(
+  magic_elf_t *handle,
+  uint64_t address,
+  uint64_t length)
+{
+  Elf *elf = handle->elf;
+
+  for (int n = 0; n < elf->get_program_count(); n++)
+  {
+    Program program;
+    elf->get_program(n, program);
+
+    if (program.p_type != PT_LOAD) { continue; }
+
+    if (address < program.p_vaddr ||
+        address + length > program.p_vaddr + program.p_filesz ||
+        address + length < address)
+    {
+      continue;
+    }
+
+    const uint64_t offset = program.p_offset + (address - program.p_vaddr);
+
+    if (offset + length > (uint64_t)elf->buffer_len) { return nullptr; }
+
+    return elf->get_data(offset, length);
+  }
+
+  return nullptr;
+}
+
+void magic_elf_note_begin(magic_elf_t *handle, struct magic_elf_note_iter *iter)
+{
+  load_notes(handle);
+
+  iter->area = 0;
+  iter->offset = 0;
+}
+
+int magic_elf_note_next(
+  magic_elf_t *handle,
+  struct magic_elf_note_iter *iter,
+  struct magic_elf_note *note)
+{
+  Elf *elf = handle->elf;
+
+  while (iter->area < (int)handle->note_areas.size())
+  {
+    const NoteArea &area = handle->note_areas[iter->area];
+    const uint64_t align = area.align == 8 ? 8 : 4;
+
+    if (iter->offset + 12 > area.size ||
+        area.offset + area.size > (uint64_t)elf->buffer_len)
+    {
+      iter->area++;
+      iter->offset = 0;
+      continue;
+    }
+
+    const uint64_t offset = area.offset + iter->offset;
+    const uint32_t namesz = elf->read_int32(offset);
+    const uint32_t descsz = elf->read_int32(offset + 4);
+    const uint64_t name_offset = offset + 12;
+
+    // Name and desc both start on an align boundary from the area start.
+    const uint64_t desc = (iter->offset + 12 + namesz + align - 1) & ~(align - 1);
+    const uint64_t desc_offset = area.offset + desc;
+    const uint64_t next = (desc + descsz + align - 1) & ~(align - 1);
+
+    if (desc + descsz > area.size)
+    {
+      iter->area++;
+      iter->offset = 0;
+      continue;
+    }
+
+    note->type = elf->read_int32(offset + 8);
+    note->name = namesz == 0 ? "" : elf->get_cstring(name_offset);
+    note->desc = elf->get_data(desc_offset, descsz);
+
+    if (note->desc == nullptr) { return -1; }
+    note->descsz = descsz;
+
+    iter->offset = next;
+
+    return 0;
+  }
+
+  return -1;
+}
+
+int magic_elf_get_thread_count(magic_elf_t *handle)
+{
+  load_threads(handle);
+
+  return handle->threads.size();
+}
+
+int magic_elf_get_thread_pid(magic_elf_t *handle, int thread)
+{
+  load_threads(handle);
+
+  if (thread < 0 || thread >= (int)handle->threads.size()) { return -1; }
+
+  return handle->threads[thread].pid;
+}
+
+int magic_elf_get_register(
+  magic_elf_t *handle,
+  int thread,
+  const char *name,
+  uint64_t *value)
+{
+  load_threads(handle);
+
+  if (thread < 0 || thread >= (int)handle->threads.size()) { return -1; }
+
+  uint64_t offset;
+
+  if (handle->elf->get_register_index(name, offset) < 0) { return -1; }
+
+  offset += handle->threads[thread].registers;
+
+  if (!is_register(handle, thread, offset)) { return -1; }
+
+  *value = handle->elf->read_reg(offset);
+
+  return 0;
+}
+
+int magic_elf_set_registers(
+  magic_elf_t *handle,
+  int thread,
+  const char **names,
+  const uint64_t *values,
+  int count)
+{
+  load_threads(handle);
+
+  if (thread < 0 || thread >= (int)handle->threads.size()) { return -1; }
+
+  Elf *elf = handle->elf;
+  std::vector<uint64_t> offsets(count);
+
+  for (int n = 0; n < count; n++)
+  {
+    if (elf->get_register_index(names[n], offsets[n]) < 0) { return -1; }
+
+    offsets[n] += handle->threads[thread].registers;
+
+    if (!is_register(handle, thread, offsets[n])) { return -1; }
+  }
+
+  if (elf->fd <= 0 || elf->set_writable() != 0) { return -1; }
+
+  for (int n = 0; n < count; n++)
+  {
+    elf->write_reg(offsets[n], values[n]);
+  }
+
+  elf->set_readonly();
+
+  return 0;
+}
+
@@ -0,0 +1,184 @@
+/*
+
+  magic_elf - The ELF file format analyzer.
+
+  Copyright 2009-2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the BSD license.
+
+*/
+
+#ifndef MAGIC_ELF_LIB_H
+#define MAGIC_ELF_LIB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+  C API for libmagic_elf.so / libmagic_elf.a.
+
+  Every function works on a handle returned by magic_elf_open() or
+  magic_elf_open_mem() and there is no global state, so any number of
+  handles can be open at once and different handles can be used from
+  different threads. A single handle must not be used by two threads
+  at the same time unless magic_elf_load_indexes() was called first.
+
+  Strings and data pointers returned point into the file mapping and
+  stay valid until magic_elf_close() (see magic_elf_is_compressed() for
+  gzip files). Functions returning int return 0 (or a count) on success
+  and -1 on error.
+*/
+
+typedef struct magic_elf magic_elf_t;
+
+struct magic_elf_section
+{
+  const char *name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t addr;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint32_t info;
+  uint64_t addralign;
+  uint64_t entsize;
+};
+
+struct magic_elf_segment
+{
+  uint32_t type;
+  uint32_t flags;
+  uint64_t offset;
+  uint64_t vaddr;
+  uint64_t paddr;
+  uint64_t filesz;
+  uint64_t memsz;
+  uint64_t align;
+};
+
+struct magic_elf_symbol
+{
+  const char *name;
+  uint64_t value;
+  uint64_t size;
+  uint8_t type;
+  uint8_t binding;
+  uint16_t shndx;
+};
+
+struct magic_elf_note
+{
+  const char *name;
+  uint32_t type;
+  const uint8_t *desc;
+  uint32_t descsz;
+};
+
+struct magic_elf_note_iter
+{
+  int area;
+  uint64_t offset;
+};
+
+magic_elf_t *magic_elf_open(const char *filename);
+
+/* Same as magic_elf_open() but registers can be changed in place. */
+magic_elf_t *magic_elf_open_writable(const char *filename);
+
+/* The memory must stay valid (and unchanged) until magic_elf_close(). */
+magic_elf_t *magic_elf_open_mem(const void *data, uint64_t length);
+
+void magic_elf_close(magic_elf_t *elf);
+
+/*
+  Indexes (symbol names, addresses, notes, threads) are built on first
+  use. This builds them all now. After it returns the query functions
+  only read from the handle, so one handle can be shared by threads.
+*/
+void magic_elf_load_indexes(magic_elf_t *elf);
+
+/*
+  Gzip compressed files are inflated in pieces that can be dropped
+  again, so data pointers and note names are only good until the next
+  call on the handle from any thread. Symbol table names are copied and
+  stay valid. The lookups themselves are still safe to share between
+  threads after magic_elf_load_indexes().
+*/
+int magic_elf_is_compressed(magic_elf_t *elf);
+
+int magic_elf_get_class(magic_elf_t *elf);
+int magic_elf_get_type(magic_elf_t *elf);
+int magic_elf_get_machine(magic_elf_t *elf);
+uint64_t magic_elf_get_entry(magic_elf_t *elf);
+const uint8_t *magic_elf_get_data(magic_elf_t *elf, uint64_t offset, uint64_t length);
+
+int magic_elf_get_section_count(magic_elf_t *elf);
+int magic_elf_get_section(magic_elf_t *elf, int index, struct magic_elf_section *section);
+int magic_elf_find_section(magic_elf_t *elf, const char *name, struct magic_elf_section *section);
+
+int magic_elf_get_segment_count(magic_elf_t *elf);
+int magic_elf_get_segment(magic_elf_t *elf, int index, struct magic_elf_segment *segment);
+
+/* Symbols come from .symtab, or .dynsym if the file is stripped. */
+int64_t magic_elf_get_symbol_count(magic_elf_t *elf);
+int magic_elf_get_symbol(magic_elf_t *elf, uint64_t index, struct magic_elf_symbol *symbol);
+int magic_elf_find_symbol(magic_elf_t *elf, const char *name, struct magic_elf_symbol *symbol);
+
+/* Symbol containing address. offset (if not NULL) is address - value. */
+int magic_elf_find_address(
+  magic_elf_t *elf,
+  uint64_t address,
+  struct magic_elf_symbol *symbol,
+  uint64_t *offset);
+
+/* File offset of a virtual address, or -1 if it isn't in the file. */
+int64_t magic_elf_address_to_offset(magic_elf_t *elf, uint64_t address);
+
+/*
+  Contents of memory at a virtual address (core files or anything else
+  with PT_LOAD segments). NULL unless all of it is in one segment's
+  file data.
+*/
+const uint8_t *magic_elf_get_memory(
+  magic_elf_t *elf,
+  uint64_t address,
+  uint64_t length);
+
+/* Notes from PT_NOTE segments (or SHT_NOTE sections if there are none). */
+void magic_elf_note_begin(magic_elf_t *elf, struct magic_elf_note_iter *iter);
+int magic_elf_note_next(
+  magic_elf_t *elf,
+  struct magic_elf_note_iter *iter,
+  struct magic_elf_note *note);
+
+/* Core files: one thread per NT_PRSTATUS note. */
+int magic_elf_get_thread_count(magic_elf_t *elf);
+int magic_elf_get_thread_pid(magic_elf_t *elf, int thread);
+int magic_elf_get_register(
+  magic_elf_t *elf,
+  int thread,
+  const char *name,
+  uint64_t *value);
+
+/*
+  Write count registers of a thread in a file opened with
+  magic_elf_open_writable(). Nothing is written if any name is unknown.
+*/
+int magic_elf_set_registers(
+  magic_elf_t *elf,
+  int thread,
+  const char **names,
+  const uint64_t *values,
+  int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+